@@ -0,0 +1,628 @@
+// Host benchmark for the firmware's storage, audio and upload paths.
+//
+//   pio run -e native && .pio/build/native/program [options]
+//
+// Options:
+//   --items N         manifests on the simulated card (default 10000)
+//   --audio FILE      replay 16 kHz mono s16le PCM instead of the synthetic trace
+//   --captures FILE   replay "ms,photo|audio,bytes" lines instead of the synthetic day
+//   --json            print one JSON object (for diffing between versions)
+//
+// Host times measure CPU cost on this machine; "sim" times come from the
+// SimCard cost model and the link model below. Compare them across firmware
+// versions rather than reading them as device numbers.
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "config.h"
+#include "ima_adpcm.h"
+#include "manifest_index.h"
+#include "manifest_journal.h"
+#include "sd_write_buffer.h"
+#include "sim_card.h"
+#include "speech_detector.h"
+#include "vad_kernel.h"
+#include "wifi_scheduler.h"
+
+namespace {
+
+constexpr size_t kFrameSamples = AUDIO_SAMPLE_RATE * AUDIO_FRAME_MS / 1000;
+constexpr uint32_t kEpochBase = 1790000000;  // trace start, seconds
+constexpr uint64_t kCardBytes = 64ULL * 1024 * 1024 * 1024;
+constexpr const char* kJournalPath = "/manifests/journal.bin";
+constexpr const char* kJournalTmpPath = "/manifests/journal.tmp";
+
+struct Options {
+    size_t items = 10000;
+    const char* audio_path = nullptr;
+    const char* captures_path = nullptr;
+    bool json = false;
+};
+
+struct Metric {
+    std::string name;
+    double value;
+    const char* unit;
+};
+
+std::vector<Metric> metrics;
+// Results feed this so the timed loops are not optimized away.
+volatile double sink = 0;
+
+void report(const std::string& name, double value, const char* unit) {
+    metrics.push_back({name, value, unit});
+}
+
+class Stopwatch {
+public:
+    Stopwatch() : start_(std::chrono::steady_clock::now()) {}
+    double elapsed_us() const {
+        return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start_).count();
+    }
+
+private:
+    std::chrono::steady_clock::time_point start_;
+};
+
+// Deterministic so runs are comparable.
+class Lcg {
+public:
+    explicit Lcg(uint32_t seed) : state_(seed) {}
+    uint32_t next() {
+        state_ = state_ * 1664525u + 1013904223u;
+        return state_ >> 8;
+    }
+    uint32_t range(uint32_t lo, uint32_t hi) { return lo + next() % (hi - lo + 1); }
+
+private:
+    uint32_t state_;
+};
+
+// ---- Trace -----------------------------------------------------------------
+
+struct CaptureEvent {
+    uint32_t ms;
+    ManifestItemType type;
+    uint32_t bytes;
+};
+
+// Alternating silence and speech-like bursts (harmonic stack with a
+// syllable-rate envelope) over a low noise floor.
+std::vector<int16_t> synthetic_audio(uint32_t seconds) {
+    Lcg rng(7);
+    std::vector<int16_t> samples(static_cast<size_t>(seconds) * AUDIO_SAMPLE_RATE);
+    size_t i = 0;
+    bool speech = false;
+    while (i < samples.size()) {
+        size_t run = static_cast<size_t>(rng.range(speech ? 1 : 2, speech ? 6 : 12)) * AUDIO_SAMPLE_RATE;
+        float pitch = static_cast<float>(rng.range(100, 220));
+        for (size_t n = 0; n < run && i < samples.size(); n++, i++) {
+            float t = static_cast<float>(n) / AUDIO_SAMPLE_RATE;
+            float noise = static_cast<float>(static_cast<int32_t>(rng.next() & 0xff) - 128);
+            float value = noise;
+            if (speech) {
+                float envelope = 0.5f + 0.5f * sinf(2.0f * 3.14159f * 4.0f * t);
+                for (int h = 1; h <= 4; h++) {
+                    value += envelope * (3000.0f / h) * sinf(2.0f * 3.14159f * pitch * h * t);
+                }
+            }
+            samples[i] = static_cast<int16_t>(std::max(-32768.0f, std::min(32767.0f, value)));
+        }
+        speech = !speech;
+    }
+    return samples;
+}
+
+bool load_audio(const char* path, std::vector<int16_t>& out) {
+    FILE* f = fopen(path, "rb");
+    if (!f) return false;
+    int16_t buf[4096];
+    size_t got = 0;
+    while ((got = fread(buf, sizeof(int16_t), 4096, f)) > 0) {
+        out.insert(out.end(), buf, buf + got);
+    }
+    fclose(f);
+    return !out.empty();
+}
+
+// One day: a photo every CAPTURE_INTERVAL_MS, plus clips during the waking
+// hours at the rate a talkative wearer produces them.
+std::vector<CaptureEvent> synthetic_captures() {
+    Lcg rng(11);
+    std::vector<CaptureEvent> events;
+    const uint32_t day_ms = 24UL * 60 * 60 * 1000;
+    for (uint32_t ms = 0; ms < day_ms; ms += CAPTURE_INTERVAL_MS) {
+        events.push_back({ms, ManifestItemType::Photo, rng.range(40 * 1024, 90 * 1024)});
+    }
+    for (uint32_t ms = 7UL * 3600 * 1000; ms < 23UL * 3600 * 1000; ms += rng.range(60, 600) * 1000) {
+        uint32_t seconds = rng.range(3, 45);
+        // IMA-ADPCM: 4 bits per sample.
+        events.push_back({ms, ManifestItemType::Audio, seconds * AUDIO_SAMPLE_RATE / 2 + 60});
+    }
+    std::sort(events.begin(), events.end(), [](const CaptureEvent& a, const CaptureEvent& b) { return a.ms < b.ms; });
+    return events;
+}
+
+bool load_captures(const char* path, std::vector<CaptureEvent>& out) {
+    FILE* f = fopen(path, "r");
+    if (!f) return false;
+    char line[128];
+    while (fgets(line, sizeof(line), f)) {
+        unsigned long ms = 0;
+        unsigned long bytes = 0;
+        char kind[16] = {};
+        if (sscanf(line, "%lu,%15[^,],%lu", &ms, kind, &bytes) != 3) continue;
+        ManifestItemType type = strcmp(kind, "audio") == 0 ? ManifestItemType::Audio : ManifestItemType::Photo;
+        out.push_back({static_cast<uint32_t>(ms), type, static_cast<uint32_t>(bytes)});
+    }
+    fclose(f);
+    return !out.empty();
+}
+
+// ---- Manifests ---------------------------------------------------------------
+
+struct ManifestFixture {
+    SimCard card{kCardBytes};
+    ManifestJournal journal;
+    ManifestIndex index;
+};
+
+std::string item_path(uint32_t seq, ManifestItemType type) {
+    char path[48];
+    snprintf(path, sizeof(path), "/%s/%08lu.%s", type == ManifestItemType::Audio ? "audio" : "photos",
+             static_cast<unsigned long>(seq), type == ManifestItemType::Audio ? "wav" : "jpg");
+    return path;
+}
+
+ManifestRecord make_record(uint32_t seq, uint32_t epoch, ManifestStatus status, ManifestItemType type,
+                           uint32_t size) {
+    ManifestRecord record;
+    memset(&record, 0, sizeof(record));
+    record.seq = seq;
+    record.captured_epoch = epoch;
+    record.status = static_cast<uint8_t>(status);
+    record.item_type = static_cast<uint8_t>(type);
+    record.size_bytes = size;
+    snprintf(record.filepath, sizeof(record.filepath), "%s", item_path(seq, type).c_str());
+    return record;
+}
+
+// Mirrors index_record() in main.cpp.
+void index_record(ManifestIndex& index, const ManifestRecord& record, uint32_t offset, bool bulk_load) {
+    if (record.status == kManifestRecordRemoved) {
+        index.remove(record.seq, record.captured_epoch);
+        return;
+    }
+    ManifestIndexEntry entry;
+    entry.seq = record.seq;
+    entry.captured_epoch = record.captured_epoch;
+    entry.last_attempt_epoch = record.last_attempt_epoch;
+    entry.journal_offset = offset;
+    entry.size_bytes = record.size_bytes;
+    entry.status = static_cast<ManifestStatus>(record.status);
+    entry.item_type = static_cast<ManifestItemType>(record.item_type);
+    entry.upload_attempts = record.upload_attempts;
+    if (bulk_load) {
+        index.load(entry);
+    } else {
+        index.upsert(entry);
+    }
+}
+
+// `items` captures 30 s apart; each was written PENDING and the older 70%
+// were later rewritten UPLOADED, as on a card that has been in use a while.
+void build_fixture(ManifestFixture& f, size_t items) {
+    f.journal.begin(f.card, kJournalPath, kJournalTmpPath);
+    Lcg rng(3);
+    size_t uploaded = items * 7 / 10;
+    for (size_t i = 0; i < items; i++) {
+        uint32_t seq = static_cast<uint32_t>(i + 1);
+        ManifestItemType type = i % 4 == 3 ? ManifestItemType::Audio : ManifestItemType::Photo;
+        uint32_t size = type == ManifestItemType::Audio ? rng.range(24 * 1024, 360 * 1024)
+                                                        : rng.range(40 * 1024, 90 * 1024);
+        uint32_t epoch = kEpochBase + static_cast<uint32_t>(i) * 30;
+        f.card.preload(item_path(seq, type), size);
+        ManifestRecord record = make_record(seq, epoch, ManifestStatus::Pending, type, size);
+        f.journal.append(record);
+        if (i < uploaded) {
+            record.status = static_cast<uint8_t>(ManifestStatus::Uploaded);
+            f.journal.append(record);
+        }
+    }
+    f.card.reset_stats();
+}
+
+void rebuild_index(ManifestFixture& f) {
+    f.index.clear();
+    ManifestIndex& index = f.index;
+    f.journal.replay([&index](const ManifestRecord& record, uint32_t offset) {
+        index_record(index, record, offset, false);
+    });
+    f.index.finish_load();
+}
+
+void bench_manifests(const Options& options) {
+    ManifestFixture f;
+    build_fixture(f, options.items);
+    report("manifest.items", static_cast<double>(options.items), "items");
+    report("manifest.journal_records", f.journal.record_count(), "records");
+
+    {
+        f.card.reset_stats();
+        Stopwatch watch;
+        rebuild_index(f);
+        report("manifest.boot_replay_host", watch.elapsed_us() / 1000.0, "ms");
+        report("manifest.boot_replay_sim", f.card.stats().sim_us / 1000.0, "ms");
+        report("manifest.days", static_cast<double>(f.index.shard_count()), "days");
+    }
+
+    const int lookups = 2000;
+    uint32_t now = kEpochBase + static_cast<uint32_t>(options.items) * 30;
+    auto accept = [now](const ManifestIndexEntry& entry) {
+        return entry.upload_attempts == 0 || now - entry.last_attempt_epoch > 60;
+    };
+    {
+        Stopwatch watch;
+        for (int i = 0; i < lookups; i++) sink = sink + (f.index.oldest_where(ManifestStatus::Pending, accept) != nullptr);
+        report("manifest.oldest_pending", watch.elapsed_us() * 1000.0 / lookups, "ns/op");
+    }
+    {
+        Stopwatch watch;
+        for (int i = 0; i < lookups; i++) sink = sink + (f.index.newest_where(ManifestStatus::Pending, accept) != nullptr);
+        report("manifest.newest_pending", watch.elapsed_us() * 1000.0 / lookups, "ns/op");
+    }
+    {
+        Stopwatch watch;
+        for (int i = 0; i < lookups; i++) sink = sink + (f.index.smallest_where(ManifestStatus::Pending, accept) != nullptr);
+        report("manifest.smallest_pending", watch.elapsed_us() * 1000.0 / lookups, "ns/op");
+    }
+    {
+        Lcg rng(5);
+        Stopwatch watch;
+        for (int i = 0; i < lookups; i++) {
+            uint32_t epoch = kEpochBase + rng.range(0, static_cast<uint32_t>(options.items)) * 30;
+            sink = sink + (f.index.nearest_where(ManifestStatus::Pending, epoch, UPLOAD_PAIR_WINDOW_SEC, accept) != nullptr);
+        }
+        report("manifest.nearest_pending", watch.elapsed_us() * 1000.0 / lookups, "ns/op");
+    }
+
+    // Upload completions: read the record back, append UPLOADED, upsert.
+    {
+        f.card.reset_stats();
+        const int updates = 500;
+        Stopwatch watch;
+        for (int i = 0; i < updates; i++) {
+            const ManifestIndexEntry* entry = f.index.oldest(ManifestStatus::Pending);
+            if (!entry) break;
+            ManifestRecord record;
+            if (!f.journal.read(entry->journal_offset, record)) break;
+            record.status = static_cast<uint8_t>(ManifestStatus::Uploaded);
+            uint32_t offset = 0;
+            f.journal.append(record, &offset);
+            index_record(f.index, record, offset, false);
+        }
+        report("manifest.status_update_host", watch.elapsed_us() / updates, "us/op");
+        report("manifest.status_update_sim", static_cast<double>(f.card.stats().sim_us) / updates, "us/op");
+    }
+
+    // One retention pass from 10% below the start threshold up to the target.
+    {
+        uint64_t item_bytes = 0;
+        for (size_t s = 0; s < kManifestStatusCount; s++) item_bytes += f.index.bytes(static_cast<ManifestStatus>(s));
+        uint64_t target_free = kCardBytes * SD_RETENTION_TARGET_FREE_PERCENT / 100;
+        uint64_t to_free = target_free - kCardBytes * (SD_RETENTION_START_FREE_PERCENT - 10) / 100;
+        to_free = std::min<uint64_t>(to_free, item_bytes / 2);
+
+        f.card.reset_stats();
+        Stopwatch watch;
+        uint64_t freed = 0;
+        size_t deleted = 0;
+        while (freed < to_free) {
+            const ManifestIndexEntry* entry = f.index.oldest(ManifestStatus::Uploaded);
+            if (!entry) break;
+            ManifestRecord record;
+            if (!f.journal.read(entry->journal_offset, record)) break;
+            f.card.remove(record.filepath);
+            freed += record.size_bytes;
+            record.status = kManifestRecordRemoved;
+            uint32_t offset = 0;
+            f.journal.append(record, &offset);
+            index_record(f.index, record, offset, false);
+            deleted++;
+        }
+        report("retention.deleted", static_cast<double>(deleted), "items");
+        report("retention.pass_host", watch.elapsed_us() / 1000.0, "ms");
+        report("retention.pass_sim", f.card.stats().sim_us / 1000.0, "ms");
+        report("retention.per_item_sim", deleted ? static_cast<double>(f.card.stats().sim_us) / deleted : 0, "us/item");
+    }
+
+    {
+        f.card.reset_stats();
+        uint32_t before = f.journal.record_count();
+        ManifestIndex& index = f.index;
+        Stopwatch watch;
+        f.journal.compact(
+            [&index](const ManifestRecord& record, uint32_t offset) {
+                const ManifestIndexEntry* entry = index.find(record.seq, record.captured_epoch);
+                return entry != nullptr && entry->journal_offset == offset;
+            },
+            [&index](const ManifestRecord& record, uint32_t offset) {
+                index_record(index, record, offset, false);
+            });
+        report("manifest.compact_host", watch.elapsed_us() / 1000.0, "ms");
+        report("manifest.compact_sim", f.card.stats().sim_us / 1000.0, "ms");
+        report("manifest.compact_records_dropped", before - f.journal.record_count(), "records");
+    }
+}
+
+// ---- Audio -------------------------------------------------------------------
+
+void bench_audio(const std::vector<int16_t>& audio) {
+    size_t frames = audio.size() / kFrameSamples;
+    if (frames == 0) return;
+    report("audio.frames", static_cast<double>(frames), "frames");
+
+    // Host numbers only rank the two feature paths against each other: the
+    // 64-bit multiplies and sqrtf the kernel avoids are cheap on a desktop
+    // CPU. Device cycles/frame come from AUDIO_VAD_BENCHMARK on hardware.
+    double kernel_ns = 0;
+    {
+        VadFeatures features;
+        Stopwatch watch;
+        for (size_t i = 0; i < frames; i++) {
+            vad_compute_features(&audio[i * kFrameSamples], kFrameSamples, features);
+            sink = sink + features.rms;
+        }
+        kernel_ns = watch.elapsed_us() * 1000.0 / frames;
+        report("audio.vad_kernel", kernel_ns, "ns/frame");
+    }
+    {
+        VadFeatures features;
+        Stopwatch watch;
+        for (size_t i = 0; i < frames; i++) {
+            vad_reference_features(&audio[i * kFrameSamples], kFrameSamples, features);
+            sink = sink + features.rms;
+        }
+        double reference_ns = watch.elapsed_us() * 1000.0 / frames;
+        report("audio.vad_reference", reference_ns, "ns/frame");
+        report("audio.vad_kernel_speedup", kernel_ns > 0 ? reference_ns / kernel_ns : 0, "x");
+    }
+    {
+        Stopwatch watch;
+        for (size_t i = 0; i < frames; i++) sink = sink + vad_reference_rms(&audio[i * kFrameSamples], kFrameSamples);
+        report("audio.vad_reference_rms_only", watch.elapsed_us() * 1000.0 / frames, "ns/frame");
+    }
+    {
+        // VAD clips over the trace as the capture task would open them, and
+        // how much of their audio the false-start filter keeps off the card.
+        SpeechDetector detector({static_cast<uint16_t>(kFrameSamples), AUDIO_VAD_START_FRAMES, AUDIO_VAD_STOP_FRAMES,
+                                 AUDIO_RMS_START_MULT, AUDIO_RMS_START_MULT_MIN, AUDIO_RMS_START_MULT_MAX,
+                                 AUDIO_RMS_STOP_MULT / AUDIO_RMS_START_MULT, AUDIO_NOISE_EMA_ALPHA,
+                                 AUDIO_NOISE_UPDATE_MAX_MULT, AUDIO_VAD_MIN_CONFIDENCE});
+        size_t clips = 0;
+        size_t clip_frames = 0;
+        size_t rejected_frames = 0;
+        size_t current = 0;
+        bool in_clip = false;
+        VadFeatures features;
+        Stopwatch watch;
+        for (size_t i = 0; i < frames; i++) {
+            vad_compute_features(&audio[i * kFrameSamples], kFrameSamples, features);
+            if (!in_clip) {
+                if (detector.speech_started(features)) {
+                    detector.begin_clip(true);
+                    in_clip = true;
+                    current = AUDIO_VAD_START_FRAMES;
+                }
+                continue;
+            }
+            current++;
+            if (detector.speech_ended(features) || current * AUDIO_FRAME_MS >= AUDIO_MAX_SEC * 1000UL) {
+                SpeechClipResult clip = detector.end_clip();
+                clips++;
+                clip_frames += current;
+                if (clip.false_start) rejected_frames += current;
+                in_clip = false;
+            }
+        }
+        report("audio.speech_detector", watch.elapsed_us() * 1000.0 / frames, "ns/frame");
+        report("audio.vad_clips", static_cast<double>(clips), "clips");
+        report("audio.vad_false_starts", static_cast<double>(detector.false_starts()), "clips");
+        report("audio.vad_discarded", clip_frames ? 100.0 * rejected_frames / clip_frames : 0.0, "% of clip audio");
+        report("audio.vad_start_mult", detector.start_mult(), "x noise");
+    }
+
+    // Encode and write the whole trace as one clip, buffered as on the device
+    // and with the 20 ms frame writes it replaced.
+    for (int buffered = 0; buffered < 2; buffered++) {
+        SimCard card(kCardBytes);
+        File file = card.open("/audio/clip.wav", FILE_WRITE);
+        SdWriteBuffer buffer;
+        if (buffered) buffer.begin(AUDIO_WRITE_BUFFER_BYTES);
+        buffer.attach(file);
+        ImaAdpcmEncoder encoder(AUDIO_ADPCM_BLOCK_BYTES);
+        encoder.reset();
+        Stopwatch watch;
+        for (size_t i = 0; i < frames; i++) {
+            const int16_t* frame = &audio[i * kFrameSamples];
+            if (AUDIO_CODEC_ADPCM) {
+                for (size_t n = 0; n < kFrameSamples; n++) {
+                    if (encoder.add(frame[n])) buffer.write(encoder.block(), encoder.block_bytes());
+                }
+            } else {
+                buffer.write(reinterpret_cast<const uint8_t*>(frame), kFrameSamples * sizeof(int16_t));
+            }
+        }
+        buffer.flush();
+        buffer.detach();
+        file.close();
+        double audio_s = static_cast<double>(frames) * AUDIO_FRAME_MS / 1000.0;
+        const char* name = buffered ? "audio.write_buffered" : "audio.write_direct";
+        report(std::string(name) + "_host", watch.elapsed_us() / audio_s, "us/audio_s");
+        report(std::string(name) + "_sim", card.stats().sim_us / audio_s, "us/audio_s");
+        report(std::string(name) + "_writes", card.stats().writes / audio_s, "writes/audio_s");
+    }
+}
+
+// ---- Upload windows ------------------------------------------------------------
+
+// Link model for the uplink: association time, steady throughput and a
+// fixed per-item cost for the upload-url/ingest round trips.
+struct LinkModel {
+    uint32_t connect_ms = 1200;
+    uint32_t bytes_per_s = 180 * 1024;
+    uint32_t per_item_ms = 250;
+    int rssi = -62;
+};
+
+void bench_upload(const std::vector<CaptureEvent>& captures) {
+    WifiScheduler scheduler({
+        WIFI_DUTY_CYCLE_INTERVAL_MS,
+        WIFI_DUTY_CYCLE_COOLDOWN_MS,
+        WIFI_DUTY_CYCLE_WINDOW_MS,
+        WIFI_DUTY_CYCLE_MAX_WINDOW_MS,
+        WIFI_SCHED_CONNECT_BUDGET_MS,
+        WIFI_SCHED_MIN_BATCH_BYTES,
+        WIFI_SCHED_STALL_SAMPLE_MS,
+        WIFI_SCHED_STALL_MIN_BPS,
+        WIFI_SCHED_WEAK_RSSI,
+        WIFI_SCHED_DEFAULT_BPS,
+        WIFI_SCHED_JITTER_MS,
+    });
+    LinkModel link;
+
+    struct Pending {
+        uint32_t captured_ms;
+        uint32_t bytes;
+        uint32_t sent = 0;
+    };
+    std::vector<Pending> queue;
+    std::vector<uint32_t> latencies_s;
+    size_t next_capture = 0;
+    uint64_t backlog = 0;
+    uint32_t uploaded_bytes = 0;
+    uint32_t uploaded_items = 0;
+    uint64_t radio_on_ms = 0;
+    uint32_t connect_at = 0;
+    uint32_t item_wait_until = 0;
+
+    const uint32_t step_ms = 100;
+    uint32_t end_ms = captures.empty() ? 0 : captures.back().ms + WIFI_DUTY_CYCLE_INTERVAL_MS;
+    Stopwatch watch;
+    for (uint32_t now = step_ms; now <= end_ms; now += step_ms) {
+        while (next_capture < captures.size() && captures[next_capture].ms <= now) {
+            queue.push_back({captures[next_capture].ms, captures[next_capture].bytes});
+            backlog += captures[next_capture].bytes;
+            next_capture++;
+        }
+
+        if (!scheduler.active()) {
+            if (scheduler.should_open(now, backlog)) {
+                scheduler.open(now, backlog, uploaded_bytes, uploaded_items);
+                connect_at = now + link.connect_ms;
+            }
+            continue;
+        }
+
+        radio_on_ms += step_ms;
+        if (now >= connect_at) {
+            scheduler.on_connected(now, link.rssi);
+            if (!queue.empty() && now >= item_wait_until) {
+                Pending& item = queue.front();
+                uint32_t chunk = std::min<uint32_t>(item.bytes - item.sent, link.bytes_per_s * step_ms / 1000);
+                if (item.sent == 0) item_wait_until = now + link.per_item_ms;
+                item.sent += chunk;
+                uploaded_bytes += chunk;
+                backlog -= chunk;
+                if (item.sent >= item.bytes) {
+                    latencies_s.push_back((now - item.captured_ms) / 1000);
+                    uploaded_items++;
+                    queue.erase(queue.begin());
+                }
+            }
+        }
+        WifiCloseReason reason = scheduler.poll(now, backlog, uploaded_bytes, uploaded_items);
+        if (reason != WifiCloseReason::None) {
+            scheduler.close(now, reason);
+        }
+    }
+
+    std::sort(latencies_s.begin(), latencies_s.end());
+    auto percentile = [&latencies_s](double p) {
+        if (latencies_s.empty()) return 0.0;
+        return static_cast<double>(latencies_s[static_cast<size_t>(p * (latencies_s.size() - 1))]);
+    };
+    double hours = end_ms / 3600000.0;
+    report("upload.items", uploaded_items, "items");
+    report("upload.windows_per_day", hours > 0 ? scheduler.windows() * 24.0 / hours : 0, "windows");
+    report("upload.radio_on_per_day", hours > 0 ? radio_on_ms / 1000.0 * 24.0 / hours : 0, "s");
+    report("upload.bytes_per_window", scheduler.windows() ? uploaded_bytes / static_cast<double>(scheduler.windows()) : 0,
+           "bytes");
+    report("upload.effective_bps", radio_on_ms ? uploaded_bytes * 1000.0 / radio_on_ms : 0, "B/s");
+    report("upload.latency_p50", percentile(0.5), "s");
+    report("upload.latency_p95", percentile(0.95), "s");
+    report("upload.left_in_backlog", static_cast<double>(queue.size()), "items");
+    report("upload.sim_host", watch.elapsed_us() / 1000.0, "ms");
+}
+
+void print_metrics(bool json) {
+    if (json) {
+        printf("{");
+        for (size_t i = 0; i < metrics.size(); i++) {
+            printf("%s\"%s\": %.3f", i ? ", " : "", metrics[i].name.c_str(), metrics[i].value);
+        }
+        printf("}\n");
+        return;
+    }
+    for (const Metric& metric : metrics) {
+        printf("%-36s %14.3f %s\n", metric.name.c_str(), metric.value, metric.unit);
+    }
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--items") == 0 && i + 1 < argc) {
+            options.items = static_cast<size_t>(strtoul(argv[++i], nullptr, 10));
+        } else if (strcmp(argv[i], "--audio") == 0 && i + 1 < argc) {
+            options.audio_path = argv[++i];
+        } else if (strcmp(argv[i], "--captures") == 0 && i + 1 < argc) {
+            options.captures_path = argv[++i];
+        } else if (strcmp(argv[i], "--json") == 0) {
+            options.json = true;
+        } else {
+            fprintf(stderr, "usage: %s [--items N] [--audio FILE] [--captures FILE] [--json]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    std::vector<int16_t> audio;
+    if (options.audio_path && !load_audio(options.audio_path, audio)) {
+        fprintf(stderr, "cannot read audio trace %s\n", options.audio_path);
+        return 1;
+    }
+    if (audio.empty()) audio = synthetic_audio(120);
+
+    std::vector<CaptureEvent> captures;
+    if (options.captures_path && !load_captures(options.captures_path, captures)) {
+        fprintf(stderr, "cannot read capture trace %s\n", options.captures_path);
+        return 1;
+    }
+    if (captures.empty()) captures = synthetic_captures();
+
+    bench_manifests(options);
+    bench_audio(audio);
+    bench_upload(captures);
+    print_metrics(options.json);
+    return 0;
+}
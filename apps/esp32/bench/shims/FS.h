@@ -0,0 +1,66 @@
+#pragma once
+
+// Host stand-in for the Arduino FS/File API used by the storage modules
+// (manifest_journal, sd_write_buffer). Files live in memory on a SimCard,
+// which also charges every operation to a simulated SD_MMC clock; see
+// sim_card.h for the cost model.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <memory>
+#include <string>
+
+#define FILE_READ "r"
+#define FILE_WRITE "w"
+#define FILE_APPEND "a"
+
+class SimCard;
+struct SimNode;
+
+namespace fs {
+
+enum SeekMode { SeekSet = 0, SeekCur = 1, SeekEnd = 2 };
+
+class File {
+public:
+    File() = default;
+    File(SimCard* card, std::shared_ptr<SimNode> node, bool writable, size_t position);
+
+    explicit operator bool() const { return node_ != nullptr; }
+    size_t write(const uint8_t* data, size_t len);
+    size_t write(uint8_t byte) { return write(&byte, 1); }
+    size_t read(uint8_t* data, size_t len);
+    int read();
+    int available() const;
+    bool seek(uint32_t position, SeekMode mode = SeekSet);
+    size_t position() const { return position_; }
+    size_t size() const;
+    void flush();
+    void close();
+
+private:
+    SimCard* card_ = nullptr;
+    std::shared_ptr<SimNode> node_;
+    bool writable_ = false;
+    bool dirty_ = false;
+    size_t position_ = 0;
+};
+
+class FS {
+public:
+    virtual ~FS() = default;
+    virtual File open(const char* path, const char* mode = FILE_READ, bool create = false) = 0;
+    virtual bool exists(const char* path) = 0;
+    virtual bool remove(const char* path) = 0;
+    virtual bool rename(const char* from, const char* to) = 0;
+    virtual bool mkdir(const char* path) = 0;
+
+    File open(const std::string& path, const char* mode = FILE_READ) { return open(path.c_str(), mode); }
+    bool exists(const std::string& path) { return exists(path.c_str()); }
+    bool remove(const std::string& path) { return remove(path.c_str()); }
+};
+
+}  // namespace fs
+
+using fs::File;
+using fs::FS;
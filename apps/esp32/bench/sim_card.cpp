@@ -0,0 +1,162 @@
+#include "sim_card.h"
+
+#include <string.h>
+
+namespace {
+
+constexpr size_t kSectorBytes = 512;
+
+uint64_t transfer_us(size_t len, uint32_t bytes_per_s) {
+    return static_cast<uint64_t>(len) * 1000000ULL / bytes_per_s;
+}
+
+}  // namespace
+
+namespace fs {
+
+File::File(SimCard* card, std::shared_ptr<SimNode> node, bool writable, size_t position)
+    : card_(card), node_(std::move(node)), writable_(writable), position_(position) {}
+
+size_t File::write(const uint8_t* data, size_t len) {
+    if (!node_ || !writable_) return 0;
+    std::vector<uint8_t>& bytes = node_->data;
+    if (position_ + len > bytes.size()) bytes.resize(position_ + len);
+    memcpy(bytes.data() + position_, data, len);
+    card_->charge_write(position_, len);
+    position_ += len;
+    dirty_ = true;
+    return len;
+}
+
+size_t File::read(uint8_t* data, size_t len) {
+    if (!node_) return 0;
+    const std::vector<uint8_t>& bytes = node_->data;
+    size_t left = position_ < bytes.size() ? bytes.size() - position_ : 0;
+    if (len > left) len = left;
+    if (len == 0) return 0;
+    memcpy(data, bytes.data() + position_, len);
+    card_->charge_read(position_, len);
+    position_ += len;
+    return len;
+}
+
+int File::read() {
+    uint8_t byte = 0;
+    return read(&byte, 1) == 1 ? byte : -1;
+}
+
+int File::available() const {
+    if (!node_ || position_ >= node_->data.size()) return 0;
+    return static_cast<int>(node_->data.size() - position_);
+}
+
+bool File::seek(uint32_t position, SeekMode mode) {
+    if (!node_) return false;
+    size_t base = mode == SeekCur ? position_ : mode == SeekEnd ? node_->data.size() : 0;
+    position_ = base + position;
+    // FAT extends the file when seeking past its end on a writable handle.
+    if (position_ > node_->data.size()) {
+        if (!writable_) return false;
+        node_->data.resize(position_);
+    }
+    return true;
+}
+
+size_t File::size() const {
+    return node_ ? node_->data.size() : 0;
+}
+
+void File::flush() {
+    if (!node_ || !dirty_) return;
+    card_->charge_flush();
+    dirty_ = false;
+}
+
+void File::close() {
+    flush();
+    node_.reset();
+    card_ = nullptr;
+}
+
+}  // namespace fs
+
+SimCard::SimCard(uint64_t capacity_bytes, const SimCardTiming& timing)
+    : capacity_(capacity_bytes), timing_(timing) {}
+
+File SimCard::open(const char* path, const char* mode, bool create) {
+    stats_.opens++;
+    stats_.sim_us += timing_.open_us;
+    auto it = files_.find(path);
+    bool truncate = strcmp(mode, FILE_WRITE) == 0;
+    bool append = strcmp(mode, FILE_APPEND) == 0;
+    bool update = strchr(mode, '+') != nullptr;
+    if (it == files_.end()) {
+        if (!truncate && !append && !create) return File();
+        it = files_.emplace(path, std::make_shared<SimNode>()).first;
+    } else if (truncate) {
+        it->second->data.clear();
+    }
+    bool writable = truncate || append || update;
+    size_t position = append ? it->second->data.size() : 0;
+    return File(this, it->second, writable, position);
+}
+
+bool SimCard::exists(const char* path) {
+    stats_.sim_us += timing_.open_us;
+    return files_.count(path) > 0;
+}
+
+bool SimCard::remove(const char* path) {
+    auto it = files_.find(path);
+    if (it == files_.end()) return false;
+    stats_.removes++;
+    stats_.sim_us += timing_.remove_us + clusters(it->second->data.size()) * timing_.remove_per_cluster_us;
+    files_.erase(it);
+    return true;
+}
+
+bool SimCard::rename(const char* from, const char* to) {
+    auto it = files_.find(from);
+    if (it == files_.end() || files_.count(to)) return false;
+    stats_.sim_us += timing_.flush_us;
+    files_[to] = it->second;
+    files_.erase(it);
+    return true;
+}
+
+void SimCard::preload(const std::string& path, size_t size) {
+    auto node = std::make_shared<SimNode>();
+    node->data.resize(size);
+    files_[path] = node;
+}
+
+uint64_t SimCard::clusters(size_t bytes) const {
+    return (bytes + timing_.cluster_bytes - 1) / timing_.cluster_bytes;
+}
+
+uint64_t SimCard::used_bytes() const {
+    uint64_t used = 0;
+    for (const auto& file : files_) {
+        used += clusters(file.second->data.size()) * timing_.cluster_bytes;
+    }
+    return used;
+}
+
+void SimCard::charge_read(size_t, size_t len) {
+    stats_.reads++;
+    stats_.bytes_read += len;
+    stats_.sim_us += timing_.command_us + transfer_us(len, timing_.read_bytes_per_s);
+}
+
+void SimCard::charge_write(size_t position, size_t len) {
+    stats_.writes++;
+    stats_.bytes_written += len;
+    stats_.sim_us += timing_.command_us + transfer_us(len, timing_.write_bytes_per_s);
+    if (position % kSectorBytes != 0) stats_.sim_us += timing_.partial_sector_us;
+    if ((position + len) % kSectorBytes != 0) stats_.sim_us += timing_.partial_sector_us;
+}
+
+void SimCard::charge_flush() {
+    stats_.flushes++;
+    stats_.sim_us += timing_.flush_us;
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <FS.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+struct SimNode {
+    std::vector<uint8_t> data;
+};
+
+// Cost model for an SD card behind SD_MMC in 1-bit mode. The defaults are
+// rough figures for a class-10 card, not measurements of one: use the
+// simulated time to compare firmware versions, not to predict a device.
+struct SimCardTiming {
+    uint32_t command_us = 150;             // per read or write call
+    uint32_t read_bytes_per_s = 3000000;
+    uint32_t write_bytes_per_s = 1500000;
+    uint32_t partial_sector_us = 400;      // read-modify-write of an unaligned edge
+    uint32_t flush_us = 1500;              // FAT + directory entry update
+    uint32_t open_us = 800;                // path lookup
+    uint32_t remove_us = 2500;             // directory update + FAT chain walk
+    uint32_t remove_per_cluster_us = 15;
+    uint32_t cluster_bytes = 32 * 1024;
+};
+
+struct SimCardStats {
+    uint64_t sim_us = 0;
+    uint64_t reads = 0;
+    uint64_t writes = 0;
+    uint64_t flushes = 0;
+    uint64_t opens = 0;
+    uint64_t removes = 0;
+    uint64_t bytes_read = 0;
+    uint64_t bytes_written = 0;
+};
+
+class SimCard : public fs::FS {
+public:
+    explicit SimCard(uint64_t capacity_bytes, const SimCardTiming& timing = SimCardTiming());
+
+    File open(const char* path, const char* mode = FILE_READ, bool create = false) override;
+    bool exists(const char* path) override;
+    bool remove(const char* path) override;
+    bool rename(const char* from, const char* to) override;
+    bool mkdir(const char*) override { return true; }
+
+    // Creates a file of `size` bytes without charging the clock (fixtures).
+    void preload(const std::string& path, size_t size);
+
+    uint64_t capacity() const { return capacity_; }
+    // Allocated bytes, rounded up to whole clusters per file.
+    uint64_t used_bytes() const;
+    size_t file_count() const { return files_.size(); }
+
+    const SimCardStats& stats() const { return stats_; }
+    void reset_stats() { stats_ = SimCardStats(); }
+
+    // Called by File.
+    void charge_read(size_t position, size_t len);
+    void charge_write(size_t position, size_t len);
+    void charge_flush();
+
+private:
+    uint64_t clusters(size_t bytes) const;
+
+    uint64_t capacity_;
+    SimCardTiming timing_;
+    SimCardStats stats_;
+    std::map<std::string, std::shared_ptr<SimNode>> files_;
+};
@@ -16,12 +16,50 @@
 #define DEVICES_ACTIVATE_PATH "/devices/activate"
 #define DEVICES_UPLOAD_URL_PATH "/devices/upload-url"
 #define DEVICES_INGEST_PATH "/devices/ingest"
+#define DEVICES_UPLOAD_URL_BATCH_PATH "/devices/upload-url/batch"
+#define DEVICES_INGEST_BATCH_PATH "/devices/ingest/batch"
+#define DEVICES_UPLOAD_PARTS_PATH "/devices/upload-parts"
+#define DEVICES_UPLOAD_PARTS_COMPLETE_PATH "/devices/upload-parts/complete"
+#define DEVICES_CONFIG_PATH "/devices/config"
+#define DEVICES_TELEMETRY_PATH "/devices/telemetry"
 
 // ESP32 upload settings
 #define UPLOAD_CHUNK_BYTES 8192
+// Read-ahead streaming: UPLOAD_STREAM_BUFFERS chunks (PSRAM) are filled by a
+// reader task while the previous chunk is on the wire. UPLOAD_CHUNK_BYTES is
+// only used when the reader cannot be started.
+#define UPLOAD_STREAM_CHUNK_BYTES (16 * 1024)
+#define UPLOAD_STREAM_BUFFERS 3
+#define UPLOAD_PREFETCH_TASK_CORE 0
+#define UPLOAD_PREFETCH_TASK_PRIORITY 4
 
 // Capture settings
+// Seqs reserved per NVS write; up to this many are skipped on reboot.
+#define SEQ_BLOCK_SIZE 256
 #define CAPTURE_INTERVAL_MS 30000
+// The camera task grabs frames; the photo writer task saves them to SD.
+#define CAMERA_TASK_CORE 1
+#define CAMERA_TASK_PRIORITY 5
+#define CAMERA_WRITER_TASK_CORE 0
+#define CAMERA_WRITER_TASK_PRIORITY 2
+// Scene-change capture: frames are compared by a 64-bit perceptual hash of a
+// 1/8-scale decode; distances are in differing bits.
+#define CAPTURE_DEDUP_ENABLED 1
+#define CAPTURE_DEDUP_DISTANCE 6
+#define CAPTURE_DEDUP_KEEPALIVE_MS (10UL * 60UL * 1000UL)
+#define CAPTURE_PROBE_INTERVAL_MS 5000
+#define CAPTURE_MOTION_DISTANCE 12
+#define CAPTURE_BURST_FRAMES 4
+#define CAPTURE_BURST_INTERVAL_MS 1500
+#define CAPTURE_BURST_ON_VAD 1
+// Thumbnail tier: every saved photo also gets a 1/4-scale JPEG linked to it
+// in the manifest. While the pending backlog is more than the link moves in
+// UPLOAD_TIER_HORIZON_SEC of radio time (at the measured throughput),
+// thumbnails upload first and full frames backfill afterwards. Otherwise
+// full frames go first and their pending thumbnails are dropped.
+#define CAPTURE_THUMBNAIL_ENABLED 1
+#define CAPTURE_THUMBNAIL_QUALITY 40  // fmt2jpg scale, 1..100 (higher = better)
+#define UPLOAD_TIER_HORIZON_SEC (30UL * 60UL)
 
 // Upload retry settings
 #define UPLOAD_MAX_ATTEMPTS 3
@@ -29,20 +67,94 @@
 #define UPLOAD_BACKOFF_SEC_2 300
 #define UPLOAD_BACKOFF_SEC_3 1800
 #define UPLOAD_INTERVAL_MS 15000
-#define UPLOAD_BATCH_SIZE 5
+#define UPLOAD_BATCH_SIZE 8
+// Upload work runs in slices on the loop task: after this long a batch stops
+// claiming new items, finishes what is in flight and yields so capture,
+// retention and telemetry get their turn; the next slice starts right away
+// when more is pending. Loop time spent elsewhere while connected is not
+// counted against the Wi-Fi window's plan.
+#define UPLOAD_SLICE_MS 2000
+// Ingest requests carry per-item stage durations (capture -> card -> upload
+// start -> ingest) for the end-to-end latency breakdown; ~60 bytes per item.
+#define PIPELINE_TIMING_ENABLED 1
+// Items in flight at once (upload-url / PUT / ingest overlap). API requests
+// are HTTP/1.1-pipelined; set to 1 behind proxies that do not support it.
+#define UPLOAD_PIPELINE_DEPTH 8
+// Items per batch upload-url / ingest request (falls back to per-item
+// requests when the server lacks the batch endpoints).
+#define UPLOAD_API_BATCH_MAX 4
+// Resumable uploads: files at least this large are sent in parts whose
+// progress is kept in the manifest. Parts must be 64 KB..4 MB (server limits).
+#define UPLOAD_RESUMABLE_MIN_BYTES (512UL * 1024UL)
+#define UPLOAD_PART_BYTES (256UL * 1024UL)
+#define UPLOAD_MAX_PARTS 16
+// Per-slot scratch for presigned hosts, paths and object keys, allocated
+// once at boot (PSRAM when present). Resumable uploads need room for
+// UPLOAD_MAX_PARTS paths; slots with less fall back to a single PUT.
+#define UPLOAD_SLOT_ARENA_BYTES (1024UL + UPLOAD_MAX_PARTS * 768UL)
+// Pending-queue order until the server's /devices/config says otherwise:
+// 0 = oldest, 1 = newest, 2 = smallest, 3 = paired photo + clip.
+#define UPLOAD_ORDER_DEFAULT 0
+#define UPLOAD_PAIR_WINDOW_SEC 15
+#define DEVICE_CONFIG_INTERVAL_MS (6UL * 60UL * 60UL * 1000UL)
+#define HTTP_TIMEOUT_MS 5000
+// Reconnect instead of reusing a socket idle this long (uvicorn closes at 5s).
+#define HTTP_KEEPALIVE_IDLE_MS 4000
 
 // Wi-Fi duty cycle (power savings)
+// Fast reconnect: associate straight to the cached BSSID/channel (and reuse
+// the last DHCP lease when STATIC_IP is set), falling back to a full scan
+// after FAST_CONNECT_TIMEOUT. One attempt may span several calls for up to
+// WIFI_CONNECT_ATTEMPT_MS before it is restarted.
+#define WIFI_FAST_CONNECT_ENABLED 1
+#define WIFI_FAST_CONNECT_STATIC_IP 1
+#define WIFI_FAST_CONNECT_TIMEOUT_MS 1500
+#define WIFI_CONNECT_ATTEMPT_MS 10000
 #define WIFI_DUTY_CYCLE_ENABLED 1
 #define WIFI_DUTY_CYCLE_INTERVAL_MS (60UL * 60UL * 1000UL)
 #define WIFI_DUTY_CYCLE_WINDOW_MS (2UL * 60UL * 1000UL)
 #define WIFI_DUTY_CYCLE_MAX_WINDOW_MS (30UL * 60UL * 1000UL)
 #define WIFI_DUTY_CYCLE_COOLDOWN_MS (10UL * 60UL * 1000UL)
+// Window scheduler: INTERVAL bounds upload latency, COOLDOWN is the minimum
+// gap, WINDOW/MAX_WINDOW clamp the window planned from backlog bytes and
+// measured throughput. Windows close early when throughput stays below
+// STALL_MIN_BPS for two STALL_SAMPLE_MS samples; weak RSSI or a failed window
+// doubles the cooldown (up to INTERVAL). JITTER_MS spreads window starts per
+// device (seeded from the chip MAC) so a fleet does not hit the API at once.
+#define WIFI_SCHED_CONNECT_BUDGET_MS 30000
+#define WIFI_SCHED_MIN_BATCH_BYTES (512UL * 1024UL)
+#define WIFI_SCHED_STALL_SAMPLE_MS 10000
+#define WIFI_SCHED_STALL_MIN_BPS 2048
+#define WIFI_SCHED_WEAK_RSSI -80
+#define WIFI_SCHED_DEFAULT_BPS (64UL * 1024UL)
+#define WIFI_SCHED_JITTER_MS (5UL * 60UL * 1000UL)
+
+// Manifest journal (/manifests/journal.bin): compact once superseded records
+// outnumber live items by this ratio
+#define MANIFEST_JOURNAL_COMPACT_MIN_RECORDS 1024
+#define MANIFEST_JOURNAL_COMPACT_RATIO 2
 
 // Retention + telemetry
 #define SD_MIN_FREE_PERCENT 15
 #define SD_EMERGENCY_FREE_PERCENT 5
-#define RETENTION_CHECK_INTERVAL_MS (60UL * 60UL * 1000UL)
+// Background retention starts below START and deletes batches until TARGET.
+#define SD_RETENTION_START_FREE_PERCENT 20
+#define SD_RETENTION_TARGET_FREE_PERCENT 25
+#define RETENTION_BATCH_ITEMS 16
+#define RETENTION_STEP_INTERVAL_MS 2000
+#define RETENTION_CHECK_INTERVAL_MS (60UL * 1000UL)
+// Free space is tracked from the manifest index between FAT walks.
+#define SD_USAGE_RESYNC_INTERVAL_MS (24UL * 60UL * 60UL * 1000UL)
+#define SD_ALLOC_UNIT_BYTES (32UL * 1024UL)
 #define TELEMETRY_INTERVAL_MS (60UL * 60UL * 1000UL)
+// Health samples go into a PSRAM ring every SAMPLE_INTERVAL whether or not
+// Wi-Fi is up (RING_SAMPLES = one day at 1/min, ~23 KB; oldest overwritten)
+// and are uploaded on the API connection in batches of BATCH_SAMPLES while a
+// window is open, or after FLUSH_INTERVAL if fewer are waiting.
+#define TELEMETRY_SAMPLE_INTERVAL_MS (60UL * 1000UL)
+#define TELEMETRY_RING_SAMPLES 1440
+#define TELEMETRY_BATCH_SAMPLES 24
+#define TELEMETRY_FLUSH_INTERVAL_MS (10UL * 60UL * 1000UL)
 
 #define FIRMWARE_VERSION "0.1.0"
 
@@ -57,14 +169,61 @@
 #define AUDIO_PREROLL_MS 1000
 #define AUDIO_MIN_SEC 1
 #define AUDIO_MAX_SEC 60
+// 1 = IMA-ADPCM WAV (format 0x11, ~4:1, decoded by ffmpeg server-side),
+// 0 = 16-bit PCM WAV. Blocks of AUDIO_ADPCM_BLOCK_BYTES hold 1017 samples.
+#define AUDIO_CODEC_ADPCM 1
+#define AUDIO_ADPCM_BLOCK_BYTES 512
+// Audio reaches the card in AUDIO_WRITE_BUFFER_BYTES blocks (whole sectors);
+// VAD clips preallocate AUDIO_PREALLOC_SEC and are trimmed when they end.
+#define AUDIO_WRITE_BUFFER_BYTES (16 * 1024)
+#define AUDIO_PREALLOC_SEC 20
 #define AUDIO_VAD_START_FRAMES 4
 #define AUDIO_VAD_STOP_FRAMES 50
 #define AUDIO_RMS_START_MULT 3.0f
 #define AUDIO_RMS_STOP_MULT 1.8f
 #define AUDIO_NOISE_EMA_ALPHA 0.01f
 #define AUDIO_NOISE_UPDATE_MAX_MULT 1.5f
+// Speech detector (speech_detector.h): frames must also score as speech to
+// start a clip. AUDIO_RMS_START_MULT is only the initial start threshold; it
+// is learned per device within MIN..MAX and kept in NVS ("vad_mult"), with the
+// stop threshold staying at the same STOP/START ratio. VAD clips whose speech
+// confidence (0..100) ends below AUDIO_VAD_MIN_CONFIDENCE are false starts:
+// counted, used to raise the threshold and, with DISCARD, never saved.
+#define AUDIO_RMS_START_MULT_MIN 1.6f
+#define AUDIO_RMS_START_MULT_MAX 8.0f
+#define AUDIO_VAD_MIN_CONFIDENCE 15
+#define AUDIO_VAD_DISCARD_FALSE_STARTS 1
+#define AUDIO_VAD_PERSIST_INTERVAL_MS (10UL * 60UL * 1000UL)
+// 1 = log cycles/frame of the VAD feature kernel vs the same features computed
+// by scalar passes (and vs the old RMS-only path) at boot.
+#define AUDIO_VAD_BENCHMARK 0
 #define AUDIO_PHOTO_CLIP_ENABLED 1
 #define AUDIO_PHOTO_CLIP_POST_MS 9000
 #define AUDIO_HEARTBEAT_ENABLED 1
 #define AUDIO_HEARTBEAT_INTERVAL_MS (5UL * 60UL * 1000UL)
 #define AUDIO_HEARTBEAT_DURATION_MS 3000
+// Capture/writer task split: the ring absorbs SD stalls of up to
+// AUDIO_RING_MS (PSRAM builds; internal-RAM builds hold the preroll + slack).
+#define AUDIO_RING_MS 4000
+#define AUDIO_CAPTURE_TASK_CORE 1
+#define AUDIO_CAPTURE_TASK_PRIORITY 20
+#define AUDIO_WRITER_TASK_CORE 0
+#define AUDIO_WRITER_TASK_PRIORITY 3
+
+// Fast boot: I2S starts first so the preroll fills while the camera is
+// probed on BOOT_INIT_TASK_CORE and the card is mounted here. The manifest
+// index build and SD usage walk move to a background task; retention and
+// telemetry wait for it. 0 = the old sequential setup.
+#define BOOT_FAST_ENABLED 1
+#define BOOT_INIT_TASK_CORE 0
+#define BOOT_INIT_TASK_PRIORITY 2
+#define BOOT_INDEX_TASK_PRIORITY 1
+
+// Power management (needs CONFIG_PM_ENABLE in the IDF build; otherwise the
+// firmware logs it and runs at full clock). LOOP_IDLE_MAX_MS caps how long
+// loop() sleeps between deadline checks when the radio is off.
+#define POWER_MANAGEMENT_ENABLED 1
+#define PM_MAX_FREQ_MHZ 240
+#define PM_MIN_FREQ_MHZ 80
+#define PM_LIGHT_SLEEP_ENABLED 1
+#define LOOP_IDLE_MAX_MS 1000
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Perceptual difference hash (dHash) of a small RGB565 image, as produced
+// by jpg2rgb565() at 1/8 scale (big-endian pixels). The image is box-averaged
+// down to a 9x8 luminance grid and each bit records whether a cell is
+// brighter than its right neighbour, so exposure drift and JPEG noise barely
+// move the hash while a changed scene flips many bits.
+uint64_t frame_dhash_rgb565(const uint8_t* pixels, size_t width, size_t height);
+
+// Number of differing bits (0..64).
+uint8_t frame_hash_distance(uint64_t a, uint64_t b);
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <Arduino.h>
+#include <WiFiClient.h>
+#include <WiFiClientSecure.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Host/port/prefix split of a base URL such as "https://api.example.com/v1".
+struct HttpEndpoint {
+    char host[64] = "";
+    uint16_t port = 80;
+    bool tls = false;
+    char prefix[64] = "";
+};
+
+bool parse_http_endpoint(const char* url, HttpEndpoint& out);
+
+// The body lands in a caller-owned buffer so reading a response never
+// touches the heap. Leave `body` null to drain and drop it.
+struct HttpResponse {
+    int status = -1;
+    char* body = nullptr;
+    size_t body_cap = 0;
+    size_t body_len = 0;
+    bool truncated = false;
+};
+
+// One persistent HTTP/1.1 connection. Requests are written without waiting
+// for earlier responses, so callers may pipeline several requests and read
+// the responses back in order with read_response(). The socket is reused
+// until the server asks to close, an I/O error occurs, or it has been idle
+// longer than the server's keep-alive window.
+class KeepAliveConnection {
+public:
+    KeepAliveConnection(uint32_t timeout_ms, uint32_t idle_ms);
+    KeepAliveConnection(const KeepAliveConnection&) = delete;
+    KeepAliveConnection& operator=(const KeepAliveConnection&) = delete;
+
+    // Connects, or keeps the current socket if it already points at host:port
+    // and still looks usable. Must not be called with responses outstanding
+    // on a different host.
+    bool ensure(const char* host, uint16_t port, bool tls);
+    void stop();
+    bool connected();
+
+    // Writes a complete request with a small in-memory body.
+    bool send(const char* method, const char* path, const char* content_type,
+              const char* extra_header, const char* body, size_t body_len);
+
+    // Writes only the request head; the caller streams content_length bytes
+    // through write() afterwards.
+    bool begin(const char* method, const char* path, const char* content_type,
+               size_t content_length);
+    bool write(const uint8_t* data, size_t len);
+
+    // Reads the next response. Bodies that do not fit out.body_cap - 1 bytes
+    // are drained, kept NUL-terminated up to the cap and flagged truncated.
+    // Returns false (and closes the socket) on a malformed or cut-off response.
+    bool read_response(HttpResponse& out);
+
+    // Streaming alternative to read_response(): read_head() reads the status
+    // line and headers, body() then yields the de-chunked body (e.g. straight
+    // into deserializeJson), and finish_response() drains whatever was left
+    // unread. finish_response() must follow every successful read_head().
+    bool read_head(HttpResponse& out);
+    Stream& body() { return body_; }
+    bool finish_response();
+
+    uint32_t connects() const { return connects_; }
+    uint32_t reuses() const { return reuses_; }
+
+private:
+    enum class BodyFraming : uint8_t {
+        None,
+        Length,
+        Chunked,
+        UntilClose,
+    };
+
+    // Stream view of the current response body. Reads block on the socket
+    // (up to the connection timeout), so the Stream timeout is zero.
+    class BodyStream : public Stream {
+    public:
+        explicit BodyStream(KeepAliveConnection& conn) : conn_(conn) { setTimeout(0); }
+        int available() override;
+        int read() override;
+        int peek() override;
+        size_t write(uint8_t) override { return 0; }
+        void flush() override {}
+        void reset() { pos_ = 0; len_ = 0; }
+
+    private:
+        bool fill();
+
+        KeepAliveConnection& conn_;
+        char buf_[128];
+        size_t pos_ = 0;
+        size_t len_ = 0;
+    };
+
+    bool write_head(const char* method, const char* path, const char* content_type,
+                    const char* extra_header, size_t content_length);
+    bool read_line(char* line, size_t cap);
+    size_t read_body(char* buf, size_t cap);
+    void keep_body(HttpResponse& out, const char* data, size_t len);
+
+    WiFiClient plain_;
+    WiFiClientSecure secure_;
+    WiFiClient* client_ = nullptr;
+    char host_[sizeof(HttpEndpoint::host)] = "";
+    uint16_t port_ = 0;
+    bool tls_ = false;
+    bool close_after_ = false;
+    unsigned long last_used_ = 0;
+    uint32_t timeout_ms_;
+    uint32_t idle_ms_;
+    uint32_t connects_ = 0;
+    uint32_t reuses_ = 0;
+    BodyFraming framing_ = BodyFraming::None;
+    size_t body_left_ = 0;  // Length: bytes left; Chunked: left in this chunk
+    bool body_error_ = false;
+    BodyStream body_{*this};
+};
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Mono IMA-ADPCM encoder producing WAV-style blocks (WAVE_FORMAT_IMA_ADPCM,
+// 0x11). Each block starts with a 4-byte header (first sample, step index)
+// followed by 4-bit codes, low nibble first, so a block of B bytes holds
+// (B - 4) * 2 + 1 samples. 16-bit PCM shrinks to roughly a quarter.
+class ImaAdpcmEncoder {
+public:
+    static constexpr size_t kHeaderBytes = 4;
+    static constexpr size_t kMaxBlockBytes = 2048;
+
+    explicit ImaAdpcmEncoder(size_t block_bytes);
+
+    static constexpr size_t samples_per_block(size_t block_bytes) {
+        return (block_bytes - kHeaderBytes) * 2 + 1;
+    }
+
+    size_t block_bytes() const { return block_bytes_; }
+    const uint8_t* block() const { return block_; }
+
+    // Starts a fresh stream. The predictor carries across blocks within a
+    // stream, so call this once per file.
+    void reset();
+
+    // Adds one sample; returns true when block() holds a complete block.
+    bool add(int16_t sample);
+
+    // Completes a partially filled block by repeating the last sample.
+    // Returns false if there was nothing pending.
+    bool pad();
+
+private:
+    uint8_t encode(int16_t sample);
+
+    size_t block_bytes_;
+    size_t filled_ = 0;  // samples in the current block
+    int32_t predictor_ = 0;
+    int8_t index_ = 0;
+    int16_t last_ = 0;
+    uint8_t block_[kMaxBlockBytes];
+};
@@ -0,0 +1,257 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include "psram_allocator.h"
+
+enum class ManifestStatus : uint8_t {
+    Pending = 0,
+    Uploaded = 1,
+    Failed = 2,
+};
+
+constexpr size_t kManifestStatusCount = 3;
+
+enum class ManifestItemType : uint8_t {
+    Photo = 0,
+    Audio = 1,
+    Thumbnail = 2,  // reduced tier of a photo, linked to it by seq
+};
+
+// Upload tiers: thumbnails, and the full-size items (photos, audio) they
+// stand in for. Any = both, i.e. the plain per-status queue.
+enum class ManifestTier : uint8_t {
+    Full = 0,
+    Thumbnail = 1,
+    Any = 2,
+};
+
+constexpr size_t kManifestTierCount = 2;
+
+inline ManifestTier manifest_tier(ManifestItemType type) {
+    return type == ManifestItemType::Thumbnail ? ManifestTier::Thumbnail : ManifestTier::Full;
+}
+
+// Compact per-item state mirrored from the SD manifests so queue queries
+// ("oldest pending", "oldest uploaded", backlog count) never touch the card.
+// journal_offset points at the item's latest record in the manifest journal.
+struct ManifestIndexEntry {
+    uint32_t seq = 0;
+    uint32_t captured_epoch = 0;
+    uint32_t last_attempt_epoch = 0;
+    uint32_t journal_offset = 0;
+    uint32_t size_bytes = 0;
+    ManifestStatus status = ManifestStatus::Pending;
+    ManifestItemType item_type = ManifestItemType::Photo;
+    uint8_t upload_attempts = 0;
+    uint8_t reserved = 0;
+};
+
+// Summary of one capture day (UTC, the same days as the /YYYYMMDD capture
+// folders). Entries are sorted by capture time, so a day is one contiguous
+// run [begin, begin + size); items without a capture time share the last
+// shard. Scans use the counts to skip whole days, e.g. fully uploaded ones.
+struct ManifestShard {
+    uint32_t day = 0;
+    uint32_t begin = 0;
+    uint32_t size = 0;
+    uint32_t counts[kManifestStatusCount] = {};
+    uint32_t tier_counts[kManifestStatusCount][kManifestTierCount] = {};
+    uint64_t bytes[kManifestStatusCount] = {};
+};
+
+constexpr uint32_t kManifestUnsyncedDay = 0xffffffffu;
+
+// Entries are kept sorted by capture time (items without a capture time sort
+// last, ties broken by seq), matching the order the old directory scans used.
+// Each status keeps a scan hint: the lowest position that can hold an entry
+// with that status, and so does each (status, tier) pair. Retention and uploads consume the queue from the front, so
+// oldest-* lookups are amortized O(1) and point lookups are O(log n).
+class ManifestIndex {
+public:
+    void clear();
+    void reserve(size_t count);
+
+    // Bulk load during the boot scan; call finish_load() once afterwards.
+    void load(const ManifestIndexEntry& entry);
+    void finish_load();
+
+    // Inserts a new entry or replaces the state of an existing one.
+    void upsert(const ManifestIndexEntry& entry);
+    bool remove(uint32_t seq, uint32_t captured_epoch);
+    const ManifestIndexEntry* find(uint32_t seq, uint32_t captured_epoch) const;
+
+    size_t size() const { return entries_.size(); }
+    // Highest seq present (0 when empty); linear, for boot-time recovery.
+    uint32_t max_seq() const;
+    size_t count(ManifestStatus status) const { return counts_[static_cast<size_t>(status)]; }
+    size_t count(ManifestStatus status, ManifestTier tier) const { return lane_count(static_cast<size_t>(status), tier); }
+    size_t shard_count() const { return shards_.size(); }
+    const ManifestShard& shard(size_t i) const { return shards_[i]; }
+    static uint32_t shard_day(uint32_t captured_epoch) {
+        return captured_epoch == 0 ? kManifestUnsyncedDay : captured_epoch / 86400;
+    }
+    uint64_t bytes(ManifestStatus status) const { return bytes_[static_cast<size_t>(status)]; }
+
+    const ManifestIndexEntry* oldest(ManifestStatus status);
+
+    // Returns the oldest entry with `status` for which accept(entry) is true.
+    // Rejected entries are skipped but keep the scan hint in place, so the
+    // predicate should only reject a handful of entries (e.g. retry backoff).
+    // The tier overloads consider only entries of that tier, using their own
+    // counts and hint, so a whole tier never has to be rejected one by one.
+    template <typename Accept>
+    const ManifestIndexEntry* oldest_where(ManifestStatus status, Accept accept) {
+        return oldest_where(status, ManifestTier::Any, accept);
+    }
+
+    template <typename Accept>
+    const ManifestIndexEntry* oldest_where(ManifestStatus status, ManifestTier tier, Accept accept) {
+        size_t s = static_cast<size_t>(status);
+        if (lane_count(s, tier) == 0) return nullptr;
+        size_t& hint = lane_hint(s, tier);
+        bool prefix = true;
+        for (size_t sh = shard_at(hint); sh < shards_.size(); sh++) {
+            const ManifestShard& shard = shards_[sh];
+            size_t end = shard.begin + shard.size;
+            if (shard_lane_count(shard, s, tier) == 0) {
+                if (prefix) hint = end;
+                continue;
+            }
+            for (size_t i = hint > shard.begin ? hint : shard.begin; i < end; i++) {
+                const ManifestIndexEntry& entry = entries_[i];
+                if (!in_lane(entry, status, tier)) {
+                    if (prefix) hint = i + 1;
+                    continue;
+                }
+                prefix = false;
+                if (accept(entry)) {
+                    return &entry;
+                }
+            }
+        }
+        return nullptr;
+    }
+
+    // Newest accepted entry with `status`; scans back from the end.
+    template <typename Accept>
+    const ManifestIndexEntry* newest_where(ManifestStatus status, Accept accept) const {
+        return newest_where(status, ManifestTier::Any, accept);
+    }
+
+    template <typename Accept>
+    const ManifestIndexEntry* newest_where(ManifestStatus status, ManifestTier tier, Accept accept) const {
+        size_t s = static_cast<size_t>(status);
+        if (lane_count(s, tier) == 0) return nullptr;
+        size_t hint = lane_hint(s, tier);
+        for (size_t sh = shards_.size(); sh > 0; sh--) {
+            const ManifestShard& shard = shards_[sh - 1];
+            if (shard.begin + shard.size <= hint) break;
+            if (shard_lane_count(shard, s, tier) == 0) continue;
+            size_t first = hint > shard.begin ? hint : shard.begin;
+            for (size_t i = shard.begin + shard.size; i > first; i--) {
+                const ManifestIndexEntry& entry = entries_[i - 1];
+                if (in_lane(entry, status, tier) && accept(entry)) {
+                    return &entry;
+                }
+            }
+        }
+        return nullptr;
+    }
+
+    // Smallest accepted entry with `status` (oldest on ties); linear.
+    template <typename Accept>
+    const ManifestIndexEntry* smallest_where(ManifestStatus status, Accept accept) const {
+        return smallest_where(status, ManifestTier::Any, accept);
+    }
+
+    template <typename Accept>
+    const ManifestIndexEntry* smallest_where(ManifestStatus status, ManifestTier tier, Accept accept) const {
+        size_t s = static_cast<size_t>(status);
+        if (lane_count(s, tier) == 0) return nullptr;
+        size_t hint = lane_hint(s, tier);
+        const ManifestIndexEntry* best = nullptr;
+        for (size_t sh = shard_at(hint); sh < shards_.size(); sh++) {
+            const ManifestShard& shard = shards_[sh];
+            if (shard_lane_count(shard, s, tier) == 0) continue;
+            size_t end = shard.begin + shard.size;
+            for (size_t i = hint > shard.begin ? hint : shard.begin; i < end; i++) {
+                const ManifestIndexEntry& entry = entries_[i];
+                if (!in_lane(entry, status, tier) || (best && entry.size_bytes >= best->size_bytes)) continue;
+                if (accept(entry)) {
+                    best = &entry;
+                }
+            }
+        }
+        return best;
+    }
+
+    // Accepted entry with `status` captured closest to `captured_epoch`,
+    // within `window_sec` either side. Entries without a capture time never
+    // match. O(log n) plus the entries inside the window.
+    template <typename Accept>
+    const ManifestIndexEntry* nearest_where(ManifestStatus status, uint32_t captured_epoch, uint32_t window_sec,
+                                            Accept accept) const {
+        return nearest_where(status, ManifestTier::Any, captured_epoch, window_sec, accept);
+    }
+
+    template <typename Accept>
+    const ManifestIndexEntry* nearest_where(ManifestStatus status, ManifestTier tier, uint32_t captured_epoch,
+                                            uint32_t window_sec, Accept accept) const {
+        if (captured_epoch == 0 || lane_count(static_cast<size_t>(status), tier) == 0) return nullptr;
+        uint32_t from = captured_epoch > window_sec ? captured_epoch - window_sec : 1;
+        uint32_t to = captured_epoch + window_sec;
+        const ManifestIndexEntry* best = nullptr;
+        uint32_t best_gap = 0;
+        for (size_t i = lower_bound(0, from); i < entries_.size(); i++) {
+            const ManifestIndexEntry& entry = entries_[i];
+            if (entry.captured_epoch == 0 || entry.captured_epoch > to) break;
+            if (!in_lane(entry, status, tier) || !accept(entry)) continue;
+            uint32_t gap = entry.captured_epoch > captured_epoch ? entry.captured_epoch - captured_epoch
+                                                                 : captured_epoch - entry.captured_epoch;
+            if (!best || gap < best_gap) {
+                best = &entry;
+                best_gap = gap;
+            }
+        }
+        return best;
+    }
+
+private:
+    using EntryVector = std::vector<ManifestIndexEntry, PsramAllocator<ManifestIndexEntry>>;
+
+    static bool before(const ManifestIndexEntry& a, uint32_t captured_epoch, uint32_t seq);
+    size_t lower_bound(uint32_t seq, uint32_t captured_epoch) const;
+    // Index of the shard holding position `pos` (shard_count() past the end).
+    size_t shard_at(size_t pos) const;
+    size_t find_shard(uint32_t day) const;
+    void shift_shards(size_t after, bool grow);
+    void recount();
+    void count_entry(const ManifestIndexEntry& entry, ManifestShard& shard, bool add);
+
+    static bool in_lane(const ManifestIndexEntry& entry, ManifestStatus status, ManifestTier tier) {
+        return entry.status == status && (tier == ManifestTier::Any || manifest_tier(entry.item_type) == tier);
+    }
+    static uint32_t shard_lane_count(const ManifestShard& shard, size_t s, ManifestTier tier) {
+        return tier == ManifestTier::Any ? shard.counts[s] : shard.tier_counts[s][static_cast<size_t>(tier)];
+    }
+    size_t lane_count(size_t s, ManifestTier tier) const {
+        return tier == ManifestTier::Any ? counts_[s] : tier_counts_[s][static_cast<size_t>(tier)];
+    }
+    size_t lane_hint(size_t s, ManifestTier tier) const {
+        return tier == ManifestTier::Any ? hints_[s] : tier_hints_[s][static_cast<size_t>(tier)];
+    }
+    size_t& lane_hint(size_t s, ManifestTier tier) {
+        return tier == ManifestTier::Any ? hints_[s] : tier_hints_[s][static_cast<size_t>(tier)];
+    }
+
+    EntryVector entries_;
+    std::vector<ManifestShard> shards_;
+    size_t counts_[kManifestStatusCount] = {};
+    uint64_t bytes_[kManifestStatusCount] = {};
+    size_t hints_[kManifestStatusCount] = {};
+    size_t tier_counts_[kManifestStatusCount][kManifestTierCount] = {};
+    size_t tier_hints_[kManifestStatusCount][kManifestTierCount] = {};
+};
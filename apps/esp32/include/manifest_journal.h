@@ -0,0 +1,89 @@
+#pragma once
+
+#include <FS.h>
+#include <functional>
+#include <stddef.h>
+#include <stdint.h>
+
+// Status byte used for retention tombstones; never stored in the index.
+constexpr uint8_t kManifestRecordRemoved = 0xFF;
+
+// `flags` bits.
+constexpr uint8_t kManifestFlagLinked = 0x01;         // linked_seq is set
+constexpr uint8_t kManifestFlagSpeechScored = 0x02;  // speech_confidence is set
+constexpr uint8_t kManifestFlagTimed = 0x04;          // queue_ms / queued_epoch are set
+
+// One fixed-size, CRC-protected journal record. The latest record for a seq
+// wins on replay. Layout is little-endian and written as raw bytes, so fields
+// may only be added by carving them out of `reserved` (new fields must treat
+// zero as "unset").
+struct ManifestRecord {
+    uint32_t seq;
+    uint32_t captured_epoch;
+    uint32_t last_attempt_epoch;
+    uint8_t status;
+    uint8_t item_type;
+    uint8_t upload_attempts;
+    uint8_t flags;
+    char filepath[48];
+    uint16_t parts_done;  // resumable upload progress, in UPLOAD_PART_BYTES parts
+    uint8_t reserved0[2];
+    uint32_t size_bytes;  // file size when known, 0 otherwise
+    uint32_t linked_seq;  // other tier of the same capture (kManifestFlagLinked)
+    uint8_t speech_confidence;  // audio clips: 0..100 (kManifestFlagSpeechScored)
+    uint8_t reserved1[3];
+    // kManifestFlagTimed: ms from the capture event (frame grab, clip end) to
+    // the first record, and the epoch of that record.
+    uint32_t queue_ms;
+    uint32_t queued_epoch;
+    uint8_t reserved[4];
+    uint32_t crc;
+};
+
+static_assert(sizeof(ManifestRecord) == 96, "ManifestRecord layout is part of the on-card format");
+
+struct ManifestJournalStats {
+    uint32_t records = 0;
+    uint32_t corrupt = 0;
+    bool torn_tail = false;
+};
+
+// Append-only manifest log on the SD card. A status change is a single
+// record append plus flush instead of a tmp-file write, remove and rename.
+// Compaction rewrites only live records into a temp file and swaps it in;
+// begin() finishes or discards an interrupted swap.
+class ManifestJournal {
+public:
+    using Visitor = std::function<void(const ManifestRecord& record, uint32_t offset)>;
+    using LivePredicate = std::function<bool(const ManifestRecord& record, uint32_t offset)>;
+
+    bool begin(fs::FS& fs, const char* path, const char* tmp_path);
+    void end();
+    bool ready() const { return fs_ != nullptr && static_cast<bool>(file_); }
+
+    // Visits every valid record in file order. Corrupt records are skipped;
+    // a partial record at the end (power loss mid-append) is ignored and
+    // overwritten by the next append.
+    bool replay(const Visitor& visit, ManifestJournalStats* stats = nullptr);
+    bool append(ManifestRecord& record, uint32_t* offset_out = nullptr);
+    bool read(uint32_t offset, ManifestRecord& out);
+
+    // Keeps records for which is_live() is true, then reports their new
+    // offsets through relocated().
+    bool compact(const LivePredicate& is_live, const Visitor& relocated);
+
+    uint32_t record_count() const;
+
+    static void seal(ManifestRecord& record);
+    static bool valid(const ManifestRecord& record);
+
+private:
+    bool create_empty(const char* path);
+    bool check_header();
+
+    fs::FS* fs_ = nullptr;
+    const char* path_ = nullptr;
+    const char* tmp_path_ = nullptr;
+    File file_;
+    uint32_t end_offset_ = 0;
+};
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Timed sections. Durations are wall-clock microseconds (esp_timer), not CPU
+// cycles: with DFS the cycle rate changes under the measurement.
+enum class PerfOp : uint8_t {
+    AudioFrame,    // audio_process_frame: VAD + ring enqueue
+    SdWrite,       // one buffered audio flush to the card
+    PhotoSave,     // save_photo: JPEG file + manifest
+    ManifestIo,    // one journal append or record read
+    StreamUpload,  // stream_upload: every PUT for one item
+    WifiConnect,   // connect_wifi_best_effort, successful or not
+    Count,
+};
+
+enum class PerfEvent : uint8_t {
+    I2sOverrun,         // I2S DMA queue overflowed; samples were lost
+    AudioDropped,       // audio ring full; frame discarded
+    PhotoDropped,       // photo writer busy; frame discarded
+    VadFalseStart,      // VAD clip that did not score as speech
+    VadDiscardedBytes,  // audio bytes of false starts that were not kept
+    Count,
+};
+
+constexpr size_t kPerfOpCount = static_cast<size_t>(PerfOp::Count);
+constexpr size_t kPerfEventCount = static_cast<size_t>(PerfEvent::Count);
+// Decade buckets: <100 us, <1 ms, <10 ms, <100 ms, <1 s, >=1 s.
+constexpr size_t kPerfBuckets = 6;
+
+struct PerfOpStats {
+    uint32_t count;
+    uint32_t max_us;
+    uint64_t total_us;
+    uint32_t hist[kPerfBuckets];
+};
+
+struct PerfSnapshot {
+    PerfOpStats ops[kPerfOpCount];
+    uint32_t events[kPerfEventCount];
+};
+
+const char* perf_op_name(PerfOp op);
+const char* perf_event_name(PerfEvent event);
+
+uint64_t perf_now_us();
+// Both are safe from any task (short critical section), not from ISRs.
+void perf_record(PerfOp op, uint32_t elapsed_us);
+void perf_count(PerfEvent event, uint32_t n = 1);
+
+// Moves everything recorded since the last take into `out`, so telemetry
+// ships deltas. perf_restore() adds a snapshot back when the send failed.
+void perf_take(PerfSnapshot& out);
+void perf_restore(const PerfSnapshot& snapshot);
+
+class PerfTimer {
+public:
+    explicit PerfTimer(PerfOp op) : op_(op), start_(perf_now_us()) {}
+    ~PerfTimer() { perf_record(op_, static_cast<uint32_t>(perf_now_us() - start_)); }
+    PerfTimer(const PerfTimer&) = delete;
+    PerfTimer& operator=(const PerfTimer&) = delete;
+
+private:
+    PerfOp op_;
+    uint64_t start_;
+};
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <stdint.h>
+
+// Power management: DFS between PM_MIN_FREQ_MHZ and PM_MAX_FREQ_MHZ plus
+// automatic light sleep when no driver or PowerLock holds the system awake.
+// Drivers guard themselves (I2S and SDMMC hold APB locks while active), so
+// the firmware only marks CPU-heavy sections and peripherals the IDF does
+// not track. Everything degrades to no-ops when the IDF build has PM
+// disabled.
+enum class PowerLockKind : uint8_t {
+    CpuMax,        // full clock (TLS, JPEG decode, journal compaction)
+    NoLightSleep,  // peripheral streaming outside IDF PM tracking (camera, Wi-Fi)
+};
+
+// Returns true when esp_pm_configure accepted the settings.
+bool power_init(uint32_t max_mhz, uint32_t min_mhz, bool light_sleep);
+bool power_managed();
+
+void power_acquire(PowerLockKind kind);
+void power_release(PowerLockKind kind);
+
+// Scoped hold of a power lock; locks are counted, so guards nest.
+class PowerGuard {
+public:
+    explicit PowerGuard(PowerLockKind kind) : kind_(kind) { power_acquire(kind_); }
+    ~PowerGuard() { power_release(kind_); }
+    PowerGuard(const PowerGuard&) = delete;
+    PowerGuard& operator=(const PowerGuard&) = delete;
+
+private:
+    PowerLockKind kind_;
+};
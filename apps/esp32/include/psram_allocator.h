@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+#if defined(ESP_PLATFORM)
+#include "esp_heap_caps.h"
+#endif
+
+// STL allocator that prefers PSRAM for large, long-lived containers (manifest
+// index, ring buffers) so they do not compete with Wi-Fi/TLS for internal RAM.
+// Falls back to the regular heap when PSRAM is absent or exhausted.
+template <typename T>
+struct PsramAllocator {
+    using value_type = T;
+
+    PsramAllocator() = default;
+    template <typename U>
+    PsramAllocator(const PsramAllocator<U>&) {}
+
+    // Returns nullptr on exhaustion; for buffers sized once at init.
+    static T* try_allocate(size_t n) {
+        size_t bytes = n * sizeof(T);
+        void* p = nullptr;
+#if defined(ESP_PLATFORM) && defined(BOARD_HAS_PSRAM)
+        p = heap_caps_malloc(bytes, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+#endif
+        if (!p) {
+            p = malloc(bytes);
+        }
+        return static_cast<T*>(p);
+    }
+
+    T* allocate(size_t n) {
+        T* p = try_allocate(n);
+        if (!p) {
+            throw std::bad_alloc();
+        }
+        return p;
+    }
+
+    void deallocate(T* p, size_t) {
+        free(p);
+    }
+};
+
+template <typename T, typename U>
+bool operator==(const PsramAllocator<T>&, const PsramAllocator<U>&) { return true; }
+
+template <typename T, typename U>
+bool operator!=(const PsramAllocator<T>&, const PsramAllocator<U>&) { return false; }
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <FS.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+
+// Read-ahead for streaming a file from SD to a socket. A reader task fills
+// up to `buffers` chunks ahead of the consumer, so the SD read of chunk n+1
+// overlaps the network write of chunk n. Buffers live in PSRAM when present.
+class SdPrefetchReader {
+public:
+    SdPrefetchReader() = default;
+    SdPrefetchReader(const SdPrefetchReader&) = delete;
+    SdPrefetchReader& operator=(const SdPrefetchReader&) = delete;
+
+    // Allocates the buffers and starts the reader task. Returns false if
+    // either fails; callers then stream with a plain read/write loop.
+    bool begin(size_t chunk_bytes, size_t buffers, int core, unsigned priority);
+    bool ready() const { return task_ != nullptr; }
+    size_t chunk_bytes() const { return chunk_bytes_; }
+
+    // Starts reading up to `limit` bytes of `file` from its current
+    // position. The file must stay open until finish() returns.
+    bool start(File& file, size_t limit = SIZE_MAX);
+
+    // Blocks for the next chunk. Returns false at end of file or on a read
+    // error (see failed()). Each chunk must be handed back with release().
+    bool next(const uint8_t*& data, size_t& len);
+    void release();
+
+    // Stops the reader (if still running) and waits until it has let go of
+    // the file. Safe to call after next() returned false.
+    void finish();
+    bool failed() const { return failed_; }
+
+private:
+    struct Chunk {
+        uint8_t index;
+        uint32_t len;
+        bool end;
+        bool error;
+    };
+
+    static void task_entry(void* arg);
+    void run();
+
+    uint8_t* storage_ = nullptr;
+    size_t chunk_bytes_ = 0;
+    size_t buffers_ = 0;
+    TaskHandle_t task_ = nullptr;
+    QueueHandle_t free_q_ = nullptr;
+    QueueHandle_t full_q_ = nullptr;
+    SemaphoreHandle_t idle_ = nullptr;
+    File* file_ = nullptr;
+    size_t remaining_ = 0;
+    std::atomic<bool> abort_{false};
+    bool active_ = false;
+    bool ended_ = false;
+    bool failed_ = false;
+    int held_ = -1;
+};
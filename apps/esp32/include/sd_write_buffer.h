@@ -0,0 +1,37 @@
+#pragma once
+
+#include <FS.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Coalesces small appends into large block writes. SD_MMC/FAT handles a few
+// big sector-aligned writes far better than a 640-byte write every 20 ms:
+// fewer FAT updates, no read-modify-write of partial sectors and longer idle
+// gaps for the card. The buffer is attached at file offset 0 and its size
+// is a multiple of 512, so every flush except the last starts and ends on a
+// sector boundary. Without a buffer (allocation failed) writes pass through.
+class SdWriteBuffer {
+public:
+    SdWriteBuffer() = default;
+    SdWriteBuffer(const SdWriteBuffer&) = delete;
+    SdWriteBuffer& operator=(const SdWriteBuffer&) = delete;
+
+    // Allocates `capacity` bytes (rounded down to whole sectors) of
+    // DMA-capable RAM so the SD driver can write straight from it.
+    bool begin(size_t capacity);
+
+    // `file` must be positioned at offset 0 and stay open until detach().
+    void attach(File& file);
+    bool write(const uint8_t* data, size_t len);
+    bool flush();
+    void detach();
+
+    size_t flushes() const { return flushes_; }
+
+private:
+    uint8_t* buf_ = nullptr;
+    size_t capacity_ = 0;
+    size_t used_ = 0;
+    size_t flushes_ = 0;
+    File* file_ = nullptr;
+};
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "vad_kernel.h"
+
+struct SpeechDetectorConfig {
+    uint16_t frame_samples;       // samples per frame passed in
+    uint16_t start_frames;        // speech-like frames in a row that open a clip
+    uint16_t stop_frames;         // quiet or non-speech frames in a row that close it
+    float start_mult;             // initial start threshold over the noise floor
+    float min_start_mult;         // bounds for the learned start threshold
+    float max_start_mult;
+    float stop_ratio;             // stop threshold = start threshold * stop_ratio
+    float noise_alpha;            // noise floor EMA weight
+    float noise_update_max_mult;  // frames louder than floor * this do not move it
+    uint8_t min_confidence;       // VAD clips below this are false starts
+};
+
+struct SpeechClipResult {
+    uint8_t confidence = 0;  // 0..100
+    bool false_start = false;
+};
+
+// Frame-level speech detector on top of the VAD kernel features. Each frame
+// gets a 0..255 score from a tiny fixed-point linear model over four inputs:
+// level over the noise floor, how far the zero-crossing count is from the
+// voiced-speech band, how far the first-difference/level ratio is from the
+// speech range, and short-term level modulation (syllables vs. fans/hum).
+// The RMS hysteresis of the old VAD still applies, but a frame only counts
+// towards a start if it also scores as speech.
+//
+// The start threshold is learned per device: a VAD clip whose confidence
+// (share of its non-tail frames that scored as speech) ends below
+// min_confidence is a false start and raises it; a confident clip lowers it
+// slightly, so quiet rooms drift towards min_start_mult.
+//
+// Not thread-safe; owned by the audio capture task.
+class SpeechDetector {
+public:
+    explicit SpeechDetector(const SpeechDetectorConfig& config);
+
+    // Forgets the noise floor and any clip in progress.
+    void reset();
+
+    // Idle frame: tracks the noise floor and returns true once start_frames
+    // speech frames in a row cleared the start threshold. Keeps returning
+    // true until begin_clip() is called.
+    bool speech_started(const VadFeatures& features);
+
+    // `vad`: the clip was opened by speech_started() (and may end on its own
+    // and adapt the threshold) rather than forced by the caller.
+    void begin_clip(bool vad);
+
+    // Frame inside a clip: collects confidence and, for VAD clips, returns
+    // true once stop_frames quiet or non-speech frames in a row were seen.
+    bool speech_ended(const VadFeatures& features);
+
+    // Closes the clip and, for VAD clips, adapts the start threshold.
+    SpeechClipResult end_clip();
+
+    float start_mult() const { return start_mult_; }
+    // Restores a learned threshold (clamped to the configured bounds).
+    void set_start_mult(float mult);
+    float noise_floor() const { return noise_rms_; }
+    uint8_t last_score() const { return last_score_; }
+    uint32_t false_starts() const { return false_starts_; }
+
+private:
+    uint8_t score_frame(const VadFeatures& features);
+
+    SpeechDetectorConfig config_;
+    float start_mult_;
+    float noise_rms_ = 0.0f;
+    float level_ema_ = 0.0f;  // ~100 ms level average for the modulation input
+    uint8_t last_score_ = 0;
+    uint16_t over_count_ = 0;
+    uint16_t under_count_ = 0;
+    bool in_clip_ = false;
+    bool clip_vad_ = false;
+    uint32_t clip_frames_ = 0;
+    uint32_t clip_speech_frames_ = 0;
+    uint32_t false_starts_ = 0;
+};
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "psram_allocator.h"
+
+// Single-producer/single-consumer ring of fixed-size slots. The producer
+// fills producer_slot() in place and publishes it with producer_commit();
+// the consumer reads consumer_slot() and hands it back with
+// consumer_release(). Indices increase monotonically and wrap modulo
+// capacity, so no slot is wasted and no lock is taken on either side.
+// Capacity is rounded up to a power of two so the modulo survives the
+// 32-bit index wrap.
+template <typename T>
+class SpscRing {
+public:
+    SpscRing() = default;
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    bool init(size_t capacity) {
+        if (slots_ || capacity == 0) return false;
+        size_t rounded = 1;
+        while (rounded < capacity) rounded <<= 1;
+        capacity = rounded;
+        slots_ = PsramAllocator<T>::try_allocate(capacity);
+        if (!slots_) return false;
+        capacity_ = capacity;
+        head_.store(0);
+        tail_.store(0);
+        return true;
+    }
+
+    size_t capacity() const { return capacity_; }
+
+    size_t size() const {
+        return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire);
+    }
+
+    size_t free_slots() const {
+        return capacity_ - size();
+    }
+
+    T* producer_slot() {
+        uint32_t head = head_.load(std::memory_order_relaxed);
+        if (head - tail_.load(std::memory_order_acquire) >= capacity_) return nullptr;
+        return &slots_[head % capacity_];
+    }
+
+    void producer_commit() {
+        head_.store(head_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    T* consumer_slot() {
+        uint32_t tail = tail_.load(std::memory_order_relaxed);
+        if (head_.load(std::memory_order_acquire) == tail) return nullptr;
+        return &slots_[tail % capacity_];
+    }
+
+    void consumer_release() {
+        tail_.store(tail_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+private:
+    T* slots_ = nullptr;
+    size_t capacity_ = 0;
+    std::atomic<uint32_t> head_{0};
+    std::atomic<uint32_t> tail_{0};
+};
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <stddef.h>
+#include <string.h>
+
+// Bump allocator for the short-lived strings of one operation (presigned
+// host/path/key of an upload). Storage is allocated once, from PSRAM when
+// present, and reset() reclaims everything at once, so steady-state use
+// never touches the heap.
+class StringArena {
+public:
+    StringArena() = default;
+    StringArena(const StringArena&) = delete;
+    StringArena& operator=(const StringArena&) = delete;
+
+    bool begin(size_t capacity);
+    void reset() { used_ = 0; }
+
+    // Copies `len` bytes plus a terminator. Returns nullptr when full.
+    const char* copy(const char* s, size_t len);
+    const char* copy(const char* s) { return copy(s, strlen(s)); }
+
+    size_t capacity() const { return capacity_; }
+    size_t used() const { return used_; }
+
+private:
+    char* data_ = nullptr;
+    size_t capacity_ = 0;
+    size_t used_ = 0;
+};
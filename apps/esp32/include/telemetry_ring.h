@@ -0,0 +1,64 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Sample flags.
+constexpr uint8_t kTelemetryWifiOn = 0x01;
+constexpr uint8_t kTelemetryRecording = 0x02;
+constexpr uint8_t kTelemetryCapturePaused = 0x04;
+constexpr uint8_t kTelemetryRetention = 0x08;
+
+// One periodic health sample; every counter comes from in-memory state (the
+// manifest index, tracked SD usage), never from a card scan.
+struct TelemetrySample {
+    uint32_t uptime_s;
+    uint32_t epoch;          // 0 before the first NTP sync
+    uint32_t backlog_count;
+    uint32_t backlog_kb;
+    uint32_t sd_free_mb;
+    uint16_t heap_free_kb;
+    int8_t rssi;             // 0 while the radio is off
+    uint8_t flags;
+};
+
+// Fixed ring of samples taken while the radio is mostly off, uploaded in
+// batches during the next Wi-Fi window. Storage is allocated once, from
+// PSRAM when present. When full, the oldest sample is overwritten and
+// counted in dropped().
+//
+// Samples are numbered from 0 since boot. A batch in flight remembers the
+// number just past its last sample and acks up to it, so samples overwritten
+// while a request was outstanding are never acked twice.
+//
+// Not thread-safe; owned by the loop task.
+class TelemetryRing {
+public:
+    TelemetryRing() = default;
+    TelemetryRing(const TelemetryRing&) = delete;
+    TelemetryRing& operator=(const TelemetryRing&) = delete;
+
+    bool begin(size_t capacity);
+
+    void push(const TelemetrySample& sample);
+
+    // Unacked samples, oldest first; at(0) has number first_seq().
+    size_t size() const { return count_; }
+    const TelemetrySample& at(size_t i) const { return data_[(head_ + i) % capacity_]; }
+    uint32_t first_seq() const { return first_seq_; }
+
+    // Drops every sample numbered below `end_seq`.
+    void ack(uint32_t end_seq);
+
+    // Oldest samples overwritten before they were acked, since boot.
+    uint32_t dropped() const { return dropped_; }
+    size_t capacity() const { return capacity_; }
+
+private:
+    TelemetrySample* data_ = nullptr;
+    size_t capacity_ = 0;
+    size_t head_ = 0;
+    size_t count_ = 0;
+    uint32_t first_seq_ = 0;
+    uint32_t dropped_ = 0;
+};
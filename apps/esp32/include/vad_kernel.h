@@ -0,0 +1,26 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Per-frame VAD features, all computed in one pass with 32-bit multiplies.
+struct VadFeatures {
+    uint16_t rms = 0;             // RMS of the samples
+    uint16_t hf_rms = 0;          // RMS of the first difference (crude >fs/4 band energy)
+    uint16_t zero_crossings = 0;  // sign changes within the frame
+};
+
+// Squares are paired into a 32-bit partial sum (two |s|^2 <= 2^31) before
+// widening, so the loop needs no 64-bit multiply; the square root is an
+// integer bit-by-bit sqrt instead of a float divide + sqrtf.
+void vad_compute_features(const int16_t* samples, size_t count, VadFeatures& out);
+
+// Integer floor(sqrt(value)).
+uint32_t vad_isqrt(uint64_t value);
+
+// The original scalar RMS (64-bit MAC + sqrtf), kept for the benchmark.
+float vad_reference_rms(const int16_t* samples, size_t count);
+
+// The same three features the straightforward way, one pass each with 64-bit
+// MACs and sqrtf: the like-for-like baseline for vad_compute_features().
+void vad_reference_features(const int16_t* samples, size_t count, VadFeatures& out);
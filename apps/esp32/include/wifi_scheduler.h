@@ -0,0 +1,111 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+enum class WifiCloseReason : uint8_t {
+    None,
+    Drained,      // backlog empty
+    Planned,      // planned duration reached
+    MaxWindow,    // hard cap (WIFI_DUTY_CYCLE_MAX_WINDOW_MS)
+    Stalled,      // throughput collapsed
+    NoLink,       // never connected within the connect budget
+};
+
+const char* wifi_close_reason_name(WifiCloseReason reason);
+
+struct WifiWindowStats {
+    uint32_t connect_ms = 0;     // 0 if the window never connected
+    uint32_t duration_ms = 0;    // radio-on time
+    uint32_t busy_ms = 0;        // connected time spent on other work, not uploads
+    uint32_t planned_ms = 0;
+    uint32_t bytes = 0;          // bytes uploaded in the window
+    uint32_t items = 0;
+    uint32_t throughput_bps = 0; // bytes/s while connected
+    int8_t rssi = 0;
+    WifiCloseReason reason = WifiCloseReason::None;
+};
+
+struct WifiSchedulerConfig {
+    uint32_t interval_ms;        // open at least this often (latency bound)
+    uint32_t cooldown_ms;        // minimum gap between windows
+    uint32_t min_window_ms;
+    uint32_t max_window_ms;
+    uint32_t connect_budget_ms;  // give up on a window without a link after this
+    uint32_t min_batch_bytes;    // backlog worth an early window
+    uint32_t stall_sample_ms;    // throughput sampling period
+    uint32_t stall_min_bps;      // below this for two samples = stalled
+    int8_t weak_rssi;            // at or below: back off between windows
+    uint32_t default_bps;        // throughput guess before the first window
+    uint32_t jitter_ms;          // per-device spread of window start times
+};
+
+// Decides when the radio is worth turning on and for how long. It opens a
+// window when the backlog is big enough to amortize the connect cost (or the
+// interval bound expires), and sizes it from the EWMA upload throughput and
+// connect latency. It closes the window when the backlog drains, the plan
+// runs out, or throughput collapses. A weak or failing link doubles the
+// cooldown (up to the interval) instead of retrying at full rate.
+//
+// Time the uploader cannot use while connected (the loop running retention,
+// compaction or telemetry between upload slices) is reported through
+// note_busy(). Plans, stall samples and the throughput estimate are measured
+// in the remaining available time; the max-window cap stays on radio time.
+//
+// Units that boot together or share the interval phase would otherwise all
+// open at once. Each window start gets an offset in [0, jitter_ms) drawn from
+// the device seed: the first window waits that long after boot, and later
+// interval-bound windows open that much before the interval expires.
+class WifiScheduler {
+public:
+    explicit WifiScheduler(const WifiSchedulerConfig& config);
+
+    bool active() const { return active_; }
+    bool connected() const { return connected_; }
+
+    // Seeds the start-time jitter; call once with a per-device value.
+    void set_jitter_seed(uint32_t seed);
+
+    bool should_open(uint32_t now_ms, uint64_t backlog_bytes) const;
+    void open(uint32_t now_ms, uint64_t backlog_bytes, uint32_t uploaded_total, uint32_t items_total);
+    void on_connected(uint32_t now_ms, int rssi);
+
+    // Feed the running total of uploaded bytes/items; returns a reason when the
+    // window should close.
+    WifiCloseReason poll(uint32_t now_ms, uint64_t backlog_bytes, uint32_t uploaded_total, uint32_t items_total);
+    // Connected time that was not available for uploads. Ignored while the
+    // window is not connected.
+    void note_busy(uint32_t ms);
+    void close(uint32_t now_ms, WifiCloseReason reason);
+
+    const WifiWindowStats& last_window() const { return last_; }
+    uint32_t throughput_bps() const { return ewma_bps_; }
+    uint32_t connect_ms() const { return ewma_connect_ms_; }
+    uint32_t windows() const { return windows_; }
+
+private:
+    uint32_t plan_ms(uint64_t backlog_bytes) const;
+    void draw_jitter();
+
+    WifiSchedulerConfig config_;
+    bool active_ = false;
+    bool connected_ = false;
+    uint32_t opened_ms_ = 0;
+    uint32_t connected_ms_ = 0;
+    uint32_t last_close_ms_ = 0;
+    bool have_closed_ = false;
+    uint32_t cooldown_ms_;
+    uint32_t ewma_bps_;
+    uint32_t ewma_connect_ms_ = 3000;
+    uint32_t bytes_base_ = 0;
+    uint32_t items_base_ = 0;
+    uint32_t sample_ms_ = 0;
+    uint32_t sample_bytes_ = 0;
+    uint32_t sample_busy_ms_ = 0;
+    uint8_t slow_samples_ = 0;
+    uint32_t windows_ = 0;
+    uint32_t jitter_seed_ = 0;
+    uint32_t jitter_offset_ms_ = 0;
+    WifiWindowStats current_;
+    WifiWindowStats last_;
+};
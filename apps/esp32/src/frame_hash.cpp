@@ -0,0 +1,49 @@
+#include "frame_hash.h"
+
+namespace {
+
+constexpr size_t kGridW = 9;
+constexpr size_t kGridH = 8;
+
+// Integer luma approximation (0..~255) from big-endian RGB565.
+inline uint32_t luma565(const uint8_t* px) {
+    uint16_t c = static_cast<uint16_t>((px[0] << 8) | px[1]);
+    uint32_t r = (c >> 11) & 0x1F;
+    uint32_t g = (c >> 5) & 0x3F;
+    uint32_t b = c & 0x1F;
+    // Scale to 8 bits and weight roughly 0.3/0.6/0.1.
+    return ((r << 3) * 77 + (g << 2) * 150 + (b << 3) * 29) >> 8;
+}
+
+}  // namespace
+
+uint64_t frame_dhash_rgb565(const uint8_t* pixels, size_t width, size_t height) {
+    if (!pixels || width < kGridW || height < kGridH) return 0;
+
+    uint32_t sums[kGridH][kGridW] = {};
+    uint32_t counts[kGridH][kGridW] = {};
+    for (size_t y = 0; y < height; y++) {
+        size_t gy = (y * kGridH) / height;
+        const uint8_t* row = pixels + y * width * 2;
+        for (size_t x = 0; x < width; x++) {
+            size_t gx = (x * kGridW) / width;
+            sums[gy][gx] += luma565(row + x * 2);
+            counts[gy][gx]++;
+        }
+    }
+
+    uint64_t hash = 0;
+    for (size_t gy = 0; gy < kGridH; gy++) {
+        for (size_t gx = 0; gx + 1 < kGridW; gx++) {
+            // Compare means without dividing: a/ca > b/cb <=> a*cb > b*ca.
+            uint64_t left = static_cast<uint64_t>(sums[gy][gx]) * counts[gy][gx + 1];
+            uint64_t right = static_cast<uint64_t>(sums[gy][gx + 1]) * counts[gy][gx];
+            hash = (hash << 1) | (left > right ? 1 : 0);
+        }
+    }
+    return hash;
+}
+
+uint8_t frame_hash_distance(uint64_t a, uint64_t b) {
+    return static_cast<uint8_t>(__builtin_popcountll(a ^ b));
+}
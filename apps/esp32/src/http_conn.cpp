@@ -0,0 +1,335 @@
+#include "http_conn.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include "config.h"
+
+namespace {
+
+constexpr size_t kHeadBytes = 640;
+constexpr size_t kLineBytes = 256;
+
+bool header_is(const char* line, const char* name, const char** value) {
+    size_t n = strlen(name);
+    if (strncasecmp(line, name, n) != 0 || line[n] != ':') return false;
+    const char* v = line + n + 1;
+    while (*v == ' ' || *v == '\t') v++;
+    *value = v;
+    return true;
+}
+
+}  // namespace
+
+bool parse_http_endpoint(const char* url, HttpEndpoint& out) {
+    const char* p = url;
+    if (strncmp(p, "https://", 8) == 0) {
+        out.tls = true;
+        out.port = 443;
+        p += 8;
+    } else if (strncmp(p, "http://", 7) == 0) {
+        out.tls = false;
+        out.port = 80;
+        p += 7;
+    } else {
+        return false;
+    }
+
+    const char* host_end = p;
+    while (*host_end && *host_end != ':' && *host_end != '/') host_end++;
+    if (host_end == p) return false;
+    size_t host_len = static_cast<size_t>(host_end - p);
+    if (host_len >= sizeof(out.host)) return false;
+    memcpy(out.host, p, host_len);
+    out.host[host_len] = 0;
+
+    p = host_end;
+    if (*p == ':') {
+        p++;
+        int port = atoi(p);
+        if (port <= 0 || port > 65535) return false;
+        out.port = static_cast<uint16_t>(port);
+        while (*p && *p != '/') p++;
+    }
+
+    size_t prefix_len = strlen(p);
+    if (prefix_len > 0 && p[prefix_len - 1] == '/') prefix_len--;
+    if (prefix_len >= sizeof(out.prefix)) return false;
+    memcpy(out.prefix, p, prefix_len);
+    out.prefix[prefix_len] = 0;
+    return true;
+}
+
+KeepAliveConnection::KeepAliveConnection(uint32_t timeout_ms, uint32_t idle_ms)
+    : timeout_ms_(timeout_ms), idle_ms_(idle_ms) {}
+
+bool KeepAliveConnection::connected() {
+    return client_ != nullptr && client_->connected();
+}
+
+void KeepAliveConnection::stop() {
+    if (client_) {
+        client_->stop();
+    }
+    client_ = nullptr;
+    close_after_ = false;
+}
+
+bool KeepAliveConnection::ensure(const char* host, uint16_t port, bool tls) {
+    if (strlen(host) >= sizeof(host_)) return false;
+    if (client_ && !close_after_ && strcmp(host_, host) == 0 && port_ == port && tls_ == tls) {
+        // Stray bytes on an idle socket mean the server already gave up on it.
+        bool idle_expired = millis() - last_used_ >= idle_ms_;
+        if (!idle_expired && client_->connected() && client_->available() == 0) {
+            reuses_++;
+            return true;
+        }
+    }
+
+    stop();
+    WiFiClient* client = &plain_;
+    if (tls) {
+#if ALLOW_INSECURE_TLS
+        secure_.setInsecure();
+#endif
+        client = &secure_;
+    }
+    client->setTimeout(timeout_ms_);
+    if (!client->connect(host, port)) {
+        return false;
+    }
+    client_ = client;
+    strcpy(host_, host);
+    port_ = port;
+    tls_ = tls;
+    last_used_ = millis();
+    connects_++;
+    return true;
+}
+
+bool KeepAliveConnection::write_head(const char* method, const char* path, const char* content_type,
+                                     const char* extra_header, size_t content_length) {
+    if (!client_) return false;
+    // One buffered write per head: println() per line costs a TLS record each.
+    char head[kHeadBytes];
+    int n = snprintf(
+        head, sizeof(head),
+        "%s %s HTTP/1.1\r\n"
+        "Host: %s\r\n"
+        "Connection: keep-alive\r\n"
+        "Content-Type: %s\r\n"
+        "Content-Length: %lu\r\n"
+        "%s"
+        "\r\n",
+        method,
+        path,
+        host_,
+        content_type,
+        static_cast<unsigned long>(content_length),
+        extra_header ? extra_header : "");
+    if (n <= 0 || static_cast<size_t>(n) >= sizeof(head)) return false;
+    return write(reinterpret_cast<const uint8_t*>(head), static_cast<size_t>(n));
+}
+
+bool KeepAliveConnection::send(const char* method, const char* path, const char* content_type,
+                               const char* extra_header, const char* body, size_t body_len) {
+    if (!write_head(method, path, content_type, extra_header, body_len)) return false;
+    return body_len == 0 || write(reinterpret_cast<const uint8_t*>(body), body_len);
+}
+
+bool KeepAliveConnection::begin(const char* method, const char* path, const char* content_type,
+                                size_t content_length) {
+    return write_head(method, path, content_type, nullptr, content_length);
+}
+
+bool KeepAliveConnection::write(const uint8_t* data, size_t len) {
+    if (!client_) return false;
+    if (client_->write(data, len) != len) {
+        stop();
+        return false;
+    }
+    last_used_ = millis();
+    return true;
+}
+
+bool KeepAliveConnection::read_line(char* line, size_t cap) {
+    // Lines end in CRLF, so even the blank line after the headers reads as
+    // one byte; zero bytes means the read timed out or the peer closed.
+    size_t n = client_->readBytesUntil('\n', line, cap - 1);
+    if (n == 0) return false;
+    if (n > 0 && line[n - 1] == '\r') n--;
+    line[n] = 0;
+    return true;
+}
+
+void KeepAliveConnection::keep_body(HttpResponse& out, const char* data, size_t len) {
+    if (!out.body || out.body_cap == 0) return;
+    size_t room = out.body_cap - 1 - out.body_len;
+    if (len > room) {
+        len = room;
+        out.truncated = true;
+    }
+    memcpy(out.body + out.body_len, data, len);
+    out.body_len += len;
+    out.body[out.body_len] = 0;
+}
+
+// Next piece of the current body, de-chunked. Returns 0 at the end of the
+// body or on an I/O error (body_error_).
+size_t KeepAliveConnection::read_body(char* buf, size_t cap) {
+    if (!client_ || body_error_) return 0;
+    char line[kLineBytes];
+    switch (framing_) {
+    case BodyFraming::None:
+        return 0;
+    case BodyFraming::UntilClose: {
+        size_t got = client_->readBytes(buf, cap);
+        if (got == 0) framing_ = BodyFraming::None;
+        return got;
+    }
+    case BodyFraming::Chunked:
+        if (body_left_ == 0) {
+            if (!read_line(line, sizeof(line))) {
+                body_error_ = true;
+                return 0;
+            }
+            body_left_ = strtoul(line, nullptr, 16);
+            if (body_left_ == 0) {
+                // Trailers end with an empty line.
+                do {
+                    if (!read_line(line, sizeof(line))) {
+                        body_error_ = true;
+                        return 0;
+                    }
+                } while (line[0] != 0);
+                framing_ = BodyFraming::None;
+                return 0;
+            }
+        }
+        break;
+    case BodyFraming::Length:
+        if (body_left_ == 0) {
+            framing_ = BodyFraming::None;
+            return 0;
+        }
+        break;
+    }
+
+    size_t want = body_left_ < cap ? body_left_ : cap;
+    size_t got = client_->readBytes(buf, want);
+    if (got == 0) {
+        body_error_ = true;
+        return 0;
+    }
+    body_left_ -= got;
+    if (framing_ == BodyFraming::Chunked && body_left_ == 0 && !read_line(line, sizeof(line))) {
+        body_error_ = true;
+    }
+    return got;
+}
+
+bool KeepAliveConnection::read_head(HttpResponse& out) {
+    out.status = -1;
+    out.body_len = 0;
+    out.truncated = false;
+    if (out.body && out.body_cap > 0) out.body[0] = 0;
+    framing_ = BodyFraming::None;
+    body_left_ = 0;
+    body_error_ = false;
+    body_.reset();
+    if (!client_) return false;
+
+    char line[kLineBytes];
+    if (!read_line(line, sizeof(line)) || strncmp(line, "HTTP/1.", 7) != 0) {
+        stop();
+        return false;
+    }
+    const char* p = strchr(line, ' ');
+    if (!p) {
+        stop();
+        return false;
+    }
+    out.status = atoi(p + 1);
+    close_after_ = line[7] == '0';
+
+    long content_length = -1;
+    bool chunked = false;
+    while (true) {
+        if (!read_line(line, sizeof(line))) {
+            stop();
+            return false;
+        }
+        if (line[0] == 0) break;
+        const char* value = nullptr;
+        if (header_is(line, "Content-Length", &value)) {
+            content_length = atol(value);
+        } else if (header_is(line, "Transfer-Encoding", &value)) {
+            chunked = strncasecmp(value, "chunked", 7) == 0;
+        } else if (header_is(line, "Connection", &value)) {
+            if (strncasecmp(value, "close", 5) == 0) close_after_ = true;
+        }
+    }
+
+    if (chunked) {
+        framing_ = BodyFraming::Chunked;
+    } else if (content_length >= 0) {
+        framing_ = BodyFraming::Length;
+        body_left_ = static_cast<size_t>(content_length);
+    } else if (out.status != 204 && out.status != 304) {
+        // No framing: the body runs to EOF and the socket cannot be reused.
+        close_after_ = true;
+        framing_ = BodyFraming::UntilClose;
+    }
+    return true;
+}
+
+bool KeepAliveConnection::finish_response() {
+    if (!client_) return false;
+    body_.reset();
+    char buf[128];
+    while (read_body(buf, sizeof(buf)) > 0) {
+    }
+
+    last_used_ = millis();
+    if (body_error_) {
+        stop();
+        return false;
+    }
+    if (close_after_) {
+        client_->stop();
+    }
+    return true;
+}
+
+bool KeepAliveConnection::read_response(HttpResponse& out) {
+    if (!read_head(out)) return false;
+    char buf[128];
+    size_t got;
+    while ((got = read_body(buf, sizeof(buf))) > 0) {
+        keep_body(out, buf, got);
+    }
+    return finish_response();
+}
+
+bool KeepAliveConnection::BodyStream::fill() {
+    if (pos_ < len_) return true;
+    pos_ = 0;
+    len_ = conn_.read_body(buf_, sizeof(buf_));
+    return len_ > 0;
+}
+
+int KeepAliveConnection::BodyStream::available() {
+    return static_cast<int>(len_ - pos_);
+}
+
+int KeepAliveConnection::BodyStream::read() {
+    if (!fill()) return -1;
+    return static_cast<unsigned char>(buf_[pos_++]);
+}
+
+int KeepAliveConnection::BodyStream::peek() {
+    if (!fill()) return -1;
+    return static_cast<unsigned char>(buf_[pos_]);
+}
@@ -0,0 +1,105 @@
+#include "ima_adpcm.h"
+
+#include <string.h>
+
+namespace {
+
+const int16_t kStepTable[89] = {
+    7,     8,     9,     10,    11,    12,    13,    14,    16,    17,    19,    21,    23,
+    25,    28,    31,    34,    37,    41,    45,    50,    55,    60,    66,    73,    80,
+    88,    97,    107,   118,   130,   143,   157,   173,   190,   209,   230,   253,   279,
+    307,   337,   371,   408,   449,   494,   544,   598,   658,   724,   796,   876,   963,
+    1060,  1166,  1282,  1411,  1552,  1707,  1878,  2066,  2272,  2499,  2749,  3024,  3327,
+    3660,  4026,  4428,  4871,  5358,  5894,  6484,  7132,  7845,  8630,  9493,  10442, 11487,
+    12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767,
+};
+
+const int8_t kIndexTable[8] = {-1, -1, -1, -1, 2, 4, 6, 8};
+
+}  // namespace
+
+ImaAdpcmEncoder::ImaAdpcmEncoder(size_t block_bytes)
+    : block_bytes_(block_bytes < kHeaderBytes + 1 ? kHeaderBytes + 1
+                   : block_bytes > kMaxBlockBytes ? kMaxBlockBytes
+                                                  : block_bytes) {
+    reset();
+}
+
+void ImaAdpcmEncoder::reset() {
+    filled_ = 0;
+    predictor_ = 0;
+    index_ = 0;
+    last_ = 0;
+}
+
+uint8_t ImaAdpcmEncoder::encode(int16_t sample) {
+    int32_t step = kStepTable[index_];
+    int32_t diff = static_cast<int32_t>(sample) - predictor_;
+    uint8_t code = 0;
+    if (diff < 0) {
+        code = 8;
+        diff = -diff;
+    }
+
+    // Same successive approximation the decoder inverts, so the encoder's
+    // predictor tracks the decoder's exactly.
+    int32_t delta = step >> 3;
+    if (diff >= step) {
+        code |= 4;
+        diff -= step;
+        delta += step;
+    }
+    step >>= 1;
+    if (diff >= step) {
+        code |= 2;
+        diff -= step;
+        delta += step;
+    }
+    step >>= 1;
+    if (diff >= step) {
+        code |= 1;
+        delta += step;
+    }
+
+    predictor_ += (code & 8) ? -delta : delta;
+    if (predictor_ > 32767) predictor_ = 32767;
+    if (predictor_ < -32768) predictor_ = -32768;
+
+    int index = index_ + kIndexTable[code & 7];
+    if (index < 0) index = 0;
+    if (index > 88) index = 88;
+    index_ = static_cast<int8_t>(index);
+    return code;
+}
+
+bool ImaAdpcmEncoder::add(int16_t sample) {
+    last_ = sample;
+    if (filled_ == 0) {
+        // The header sample is stored verbatim and seeds the predictor.
+        predictor_ = sample;
+        block_[0] = static_cast<uint8_t>(sample & 0xFF);
+        block_[1] = static_cast<uint8_t>((sample >> 8) & 0xFF);
+        block_[2] = static_cast<uint8_t>(index_);
+        block_[3] = 0;
+        memset(block_ + kHeaderBytes, 0, block_bytes_ - kHeaderBytes);
+        filled_ = 1;
+    } else {
+        size_t nibble = filled_ - 1;
+        uint8_t code = encode(sample);
+        block_[kHeaderBytes + nibble / 2] |= (nibble & 1) ? static_cast<uint8_t>(code << 4) : code;
+        filled_++;
+    }
+
+    if (filled_ == samples_per_block(block_bytes_)) {
+        filled_ = 0;
+        return true;
+    }
+    return false;
+}
+
+bool ImaAdpcmEncoder::pad() {
+    if (filled_ == 0) return false;
+    while (!add(last_)) {
+    }
+    return true;
+}
@@ -1,24 +1,65 @@
 #include <Arduino.h>
+#include <atomic>
 #include <cstring>
 #include "esp_camera.h"
+#include "esp_system.h"
 #include "FS.h"
 #include "SD_MMC.h"
 #include <Preferences.h>
 #include <time.h>
+#include <unistd.h>
 #include <WiFi.h>
 #include <HTTPClient.h>
 #include <WiFiClientSecure.h>
 #include <ArduinoJson.h>
 #include <math.h>
 #include "driver/i2s.h"
+#include "freertos/event_groups.h"
+#include "img_converters.h"
 
 #include "board_pins.h"
 #include "config.h"
+#include "frame_hash.h"
+#include "http_conn.h"
+#include "ima_adpcm.h"
+#include "manifest_index.h"
+#include "manifest_journal.h"
+#include "perf_counters.h"
+#include "power.h"
+#include "psram_allocator.h"
+#include "sd_prefetch.h"
+#include "sd_write_buffer.h"
+#include "speech_detector.h"
+#include "spsc_ring.h"
+#include "string_arena.h"
+#include "telemetry_ring.h"
+#include "vad_kernel.h"
+#include "wifi_scheduler.h"
 
 static camera_config_t camera_config;
+constexpr const char* kSdMountPoint = "/sdcard";
 constexpr size_t kAudioFrameSamples = (AUDIO_SAMPLE_RATE * AUDIO_FRAME_MS) / 1000;
 constexpr size_t kAudioPrerollSamples = (AUDIO_SAMPLE_RATE * AUDIO_PREROLL_MS) / 1000;
 
+// Capture task -> writer task handoff. Start/Stop/Discard bracket the frames
+// of one clip so the writer never has to look at VAD state.
+enum class AudioSlotKind : uint8_t {
+    Frame,
+    Start,
+    Stop,
+    Discard,
+};
+
+struct AudioSlot {
+    AudioSlotKind kind;
+    uint16_t count;
+    time_t epoch;
+    uint32_t expected_samples;  // Start only: clip length if known, else 0
+    uint8_t confidence;         // Stop/Discard: clip speech confidence, 0..100
+    uint32_t pushed_ms;         // millis() when enqueued (Stop: the clip end)
+    int16_t samples[kAudioFrameSamples];
+};
+
 static void init_camera_config() {
     memset(&camera_config, 0, sizeof(camera_config));
 
@@ -53,44 +94,161 @@ static void init_camera_config() {
 }
 
 static Preferences prefs;
-static bool sd_ok = false;
-static bool camera_ok = false;
-static bool ntp_synced = false;
+static std::atomic<bool> sd_ok{false};
+static std::atomic<bool> camera_ok{false};
+static std::atomic<bool> ntp_synced{false};
 static bool wifi_ok = false;
-static bool capture_paused = false;
+static std::atomic<bool> capture_paused{false};
 
 static unsigned long last_capture = 0;
+
+// Camera task -> photo writer task handoff. The frame buffer itself is passed
+// along and returned to the driver right after the SD write.
+struct PhotoFrame {
+    camera_fb_t* fb;
+    time_t captured_epoch;
+    uint32_t grabbed_ms;  // millis() at the grab
+};
+
+static QueueHandle_t photo_queue = nullptr;
+static TaskHandle_t camera_task_handle = nullptr;
+static TaskHandle_t photo_writer_task_handle = nullptr;
+static std::atomic<uint32_t> photo_dedup_skipped{0};
+// Set by the audio VAD (or anything else) to ask the camera for a burst.
+static std::atomic<bool> photo_burst_requested{false};
 static unsigned long last_upload = 0;
 static unsigned long last_wifi_attempt = 0;
 static unsigned long last_ntp_attempt = 0;
 static unsigned long last_retention_check = 0;
 static unsigned long last_telemetry = 0;
-static unsigned long wifi_window_start = 0;
-static unsigned long last_wifi_cycle = 0;
-static bool wifi_window_active = false;
-static bool wifi_backlog_window = false;
+// The hourly report is kept due until a Wi-Fi window can post it.
+static bool telemetry_report_due = false;
+static unsigned long last_perf_report = 0;
+static unsigned long last_telemetry_sample = 0;
+static unsigned long last_telemetry_flush = 0;
+static unsigned long last_config_fetch = 0;
+static bool device_config_fetched = false;
+
+// Boot milestones in ms since the app started (0 = not reached), logged at
+// the end of setup() and reported with telemetry.
+struct BootTimings {
+    uint32_t audio_ms = 0;  // I2S running, preroll filling
+    uint32_t camera_ms = 0;
+    uint32_t sd_ms = 0;
+    uint32_t setup_ms = 0;
+    std::atomic<uint32_t> first_frame_ms{0};
+    std::atomic<uint32_t> index_ms{0};
+};
+
+static BootTimings boot_timings;
+// Set once the boot-time index build and SD usage walk are done (inline or
+// in the background); retention and telemetry wait for it.
+static std::atomic<bool> boot_deferred_done{false};
 static uint8_t upload_buf[UPLOAD_CHUNK_BYTES];
+static KeepAliveConnection api_conn(HTTP_TIMEOUT_MS, HTTP_KEEPALIVE_IDLE_MS);
+static KeepAliveConnection store_conn(HTTP_TIMEOUT_MS, HTTP_KEEPALIVE_IDLE_MS);
+static SdPrefetchReader sd_prefetch;
+static HttpEndpoint api_endpoint;
+static bool api_endpoint_ok = false;
+static const char* const kDeviceTokenHeader = "X-Device-Token: " DEVICE_TOKEN "\r\n";
+
+// Cumulative per-stage upload timings since boot.
+struct UploadStats {
+    uint32_t items = 0;
+    uint32_t failures = 0;
+    uint64_t bytes = 0;
+    uint64_t target_ms = 0;
+    uint64_t put_ms = 0;
+    uint64_t ingest_ms = 0;
+};
+
+static UploadStats upload_stats;
 static bool audio_ok = false;
-static bool audio_recording = false;
-static File audio_file;
-static String audio_filepath;
-static time_t audio_start_epoch = 0;
-static uint32_t audio_seq = 0;
-static size_t audio_samples_written = 0;
-static float noise_rms = 0.0f;
-static int vad_over_count = 0;
-static int vad_under_count = 0;
-static bool audio_force_active = false;
-static size_t audio_force_stop_samples = 0;
-static bool audio_photo_clip_pending = false;
+static QueueHandle_t i2s_event_queue = nullptr;
+static std::atomic<bool> audio_recording{false};
+static std::atomic<bool> audio_photo_clip_pending{false};
 static time_t audio_photo_clip_epoch = 0;
-static bool audio_heartbeat_pending = false;
+static std::atomic<bool> audio_heartbeat_pending{false};
 static unsigned long last_audio_heartbeat = 0;
+static SpscRing<AudioSlot> audio_ring;
+static TaskHandle_t audio_capture_task_handle = nullptr;
+static TaskHandle_t audio_writer_task_handle = nullptr;
+
+// Audio capture task state (I2S reader + VAD).
+static SpeechDetector speech_detector({
+    static_cast<uint16_t>(kAudioFrameSamples),
+    AUDIO_VAD_START_FRAMES,
+    AUDIO_VAD_STOP_FRAMES,
+    AUDIO_RMS_START_MULT,
+    AUDIO_RMS_START_MULT_MIN,
+    AUDIO_RMS_START_MULT_MAX,
+    AUDIO_RMS_STOP_MULT / AUDIO_RMS_START_MULT,
+    AUDIO_NOISE_EMA_ALPHA,
+    AUDIO_NOISE_UPDATE_MAX_MULT,
+    AUDIO_VAD_MIN_CONFIDENCE,
+});
+// Learned start threshold, published for loop() to persist.
+static std::atomic<float> vad_start_mult{AUDIO_RMS_START_MULT};
+static float vad_start_mult_saved = 0.0f;
+static unsigned long last_vad_persist = 0;
+static bool audio_force_active = false;
+static size_t audio_force_stop_samples = 0;
+static size_t audio_clip_samples = 0;
 static int16_t* audio_preroll = nullptr;
 static size_t preroll_index = 0;
 static bool preroll_filled = false;
 static int16_t audio_frame[kAudioFrameSamples];
 
+// Audio writer task state (ring -> SD).
+static File audio_file;
+static char audio_filepath[sizeof(ManifestRecord::filepath)] = "";
+static time_t audio_start_epoch = 0;
+static uint32_t audio_seq = 0;
+static size_t audio_samples_written = 0;
+static size_t audio_data_bytes = 0;
+static bool audio_preallocated = false;
+static SdWriteBuffer audio_write_buffer;
+#if AUDIO_CODEC_ADPCM
+static ImaAdpcmEncoder audio_encoder(AUDIO_ADPCM_BLOCK_BYTES);
+#endif
+static ManifestIndex manifest_index;
+static ManifestJournal manifest_journal;
+static std::atomic<bool> manifest_index_ready{false};
+static uint64_t sd_total_bytes = 0;
+static uint64_t sd_untracked_bytes = 0;
+static bool sd_usage_synced = false;
+static unsigned long last_sd_usage_resync = 0;
+static bool retention_active = false;
+static unsigned long last_retention_step = 0;
+static uint32_t retention_deleted = 0;
+static const char* const kManifestJournalPath = "/manifests/journal.bin";
+static const char* const kManifestJournalTmpPath = "/manifests/journal.tmp";
+
+// Guards the manifest journal, the index and the NVS seq counter: the audio
+// writer task creates manifests while loop() uploads and retires them.
+static SemaphoreHandle_t manifest_mutex = nullptr;
+
+struct ManifestLock {
+    ManifestLock() {
+        if (manifest_mutex) xSemaphoreTakeRecursive(manifest_mutex, portMAX_DELAY);
+    }
+    ~ManifestLock() {
+        if (manifest_mutex) xSemaphoreGiveRecursive(manifest_mutex);
+    }
+};
+
+// Set once the boot-time index build has run, whether or not it succeeded.
+// With fast boot the capture writers start first and can reach the manifest
+// before the index task has taken the lock, so they wait on this bit instead.
+static EventGroupHandle_t boot_events = nullptr;
+static const EventBits_t kBootIndexBuilt = 0x01;
+
+// Callers must not hold the manifest lock before the index is built: the
+// build takes it.
+static void wait_manifest_index() {
+    if (boot_events) xEventGroupWaitBits(boot_events, kBootIndexBuilt, pdFALSE, pdTRUE, portMAX_DELAY);
+}
+
 static bool sync_time_best_effort(uint32_t timeout_ms = 8000) {
     configTime(0, 0, "pool.ntp.org", "time.nist.gov");
     unsigned long start = millis();
@@ -113,172 +271,460 @@ static time_t now_epoch() {
     return static_cast<time_t>(millis() / 1000);
 }
 
-static bool connect_wifi_best_effort(uint32_t timeout_ms = 10000) {
+// Last good association, kept in NVS ("wifi_fc") so the next window can
+// skip the scan (BSSID + channel) and, optionally, DHCP (cached lease).
+struct WifiFastConnectCache {
+    uint8_t version;
+    uint8_t channel;
+    uint8_t bssid[6];
+    uint32_t ssid_hash;
+    uint32_t ip;
+    uint32_t gateway;
+    uint32_t subnet;
+    uint32_t dns;
+};
+
+constexpr uint8_t kWifiFastConnectVersion = 1;
+constexpr size_t kWifiConnectBuckets = 6;
+constexpr uint32_t kWifiConnectBucketMs[kWifiConnectBuckets - 1] = {250, 500, 1000, 2000, 4000};
+
+// Connect-time histograms: [0] = fast path, [1] = full scan + DHCP. The last
+// bucket collects everything slower than 4 s.
+struct WifiConnectStats {
+    uint16_t hist[2][kWifiConnectBuckets] = {};
+    uint16_t failures = 0;
+    uint16_t fast_misses = 0;
+};
+
+static WifiFastConnectCache wifi_fc = {};
+static bool wifi_fc_loaded = false;
+static WifiConnectStats wifi_connect_stats;
+static unsigned long wifi_attempt_start = 0;
+static bool wifi_attempt_active = false;
+static bool wifi_attempt_fast = false;
+
+static uint32_t wifi_ssid_hash() {
+    uint32_t hash = 2166136261u;
+    for (const char* c = WIFI_SSID; *c; c++) {
+        hash = (hash ^ static_cast<uint8_t>(*c)) * 16777619u;
+    }
+    return hash;
+}
+
+static bool wifi_fc_valid() {
+    if (!wifi_fc_loaded) {
+        wifi_fc_loaded = true;
+        if (prefs.getBytes("wifi_fc", &wifi_fc, sizeof(wifi_fc)) != sizeof(wifi_fc)) {
+            memset(&wifi_fc, 0, sizeof(wifi_fc));
+        }
+    }
+    return WIFI_FAST_CONNECT_ENABLED && wifi_fc.version == kWifiFastConnectVersion &&
+           wifi_fc.ssid_hash == wifi_ssid_hash() && wifi_fc.channel != 0;
+}
+
+// Rewrites the NVS entry only when the association actually changed.
+static void wifi_fc_store() {
+    WifiFastConnectCache next = {};
+    next.version = kWifiFastConnectVersion;
+    next.channel = static_cast<uint8_t>(WiFi.channel());
+    memcpy(next.bssid, WiFi.BSSID(), sizeof(next.bssid));
+    next.ssid_hash = wifi_ssid_hash();
+    next.ip = static_cast<uint32_t>(WiFi.localIP());
+    next.gateway = static_cast<uint32_t>(WiFi.gatewayIP());
+    next.subnet = static_cast<uint32_t>(WiFi.subnetMask());
+    next.dns = static_cast<uint32_t>(WiFi.dnsIP());
+    if (memcmp(&next, &wifi_fc, sizeof(next)) == 0) return;
+    wifi_fc = next;
+    prefs.putBytes("wifi_fc", &wifi_fc, sizeof(wifi_fc));
+}
+
+static void record_wifi_connect(bool fast, uint32_t elapsed_ms) {
+    size_t bucket = 0;
+    while (bucket < kWifiConnectBuckets - 1 && elapsed_ms >= kWifiConnectBucketMs[bucket]) bucket++;
+    uint16_t& slot = wifi_connect_stats.hist[fast ? 0 : 1][bucket];
+    if (slot < UINT16_MAX) slot++;
+    perf_record(PerfOp::WifiConnect, elapsed_ms * 1000);
+    Serial.printf("WiFi associated in %lu ms (%s)\n", static_cast<unsigned long>(elapsed_ms), fast ? "fast" : "scan");
+}
+
+static void wifi_begin(bool fast) {
     WiFi.mode(WIFI_STA);
-    WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
+    if (fast) {
+        if (WIFI_FAST_CONNECT_STATIC_IP && wifi_fc.ip != 0) {
+            WiFi.config(IPAddress(wifi_fc.ip), IPAddress(wifi_fc.gateway), IPAddress(wifi_fc.subnet),
+                        IPAddress(wifi_fc.dns));
+        }
+        WiFi.begin(WIFI_SSID, WIFI_PASSWORD, wifi_fc.channel, wifi_fc.bssid);
+    } else {
+        // A zero address puts the interface back on DHCP.
+        WiFi.config(IPAddress(), IPAddress(), IPAddress());
+        WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
+    }
+    wifi_attempt_start = millis();
+    wifi_attempt_active = true;
+    wifi_attempt_fast = fast;
+}
+
+// Connects using the cached BSSID/channel/lease first and falls back to a
+// full scan + DHCP when that does not associate within
+// WIFI_FAST_CONNECT_TIMEOUT_MS. An attempt that is still in flight from an
+// earlier call is waited on instead of restarted, so short polling timeouts
+// from loop() no longer abort the association they are waiting for.
+static bool connect_wifi_best_effort(uint32_t timeout_ms = 10000) {
     unsigned long start = millis();
+    if (WiFi.status() == WL_CONNECTED && !wifi_attempt_active) return true;
+
+    if (!wifi_attempt_active || millis() - wifi_attempt_start >= WIFI_CONNECT_ATTEMPT_MS) {
+        wifi_begin(wifi_fc_valid());
+    }
+
     while (millis() - start < timeout_ms) {
         if (WiFi.status() == WL_CONNECTED) {
+            record_wifi_connect(wifi_attempt_fast, millis() - wifi_attempt_start);
+            wifi_attempt_active = false;
+            wifi_fc_store();
             return true;
         }
-        delay(250);
+        if (wifi_attempt_fast && millis() - wifi_attempt_start >= WIFI_FAST_CONNECT_TIMEOUT_MS) {
+            // AP moved channel, changed BSSID or the lease went stale.
+            wifi_connect_stats.fast_misses++;
+            WiFi.disconnect();
+            wifi_begin(false);
+        }
+        delay(50);
+    }
+    if (millis() - wifi_attempt_start >= WIFI_CONNECT_ATTEMPT_MS) {
+        wifi_connect_stats.failures++;
+        wifi_attempt_active = false;
     }
     return false;
 }
 
+// Seqs are handed out from RAM. NVS "seq" holds the end of the reserved
+// block, so it is written once per SEQ_BLOCK_SIZE items. After a reboot the
+// rest of the old block is skipped. The manifest index high-water mark
+// guards against an NVS key that was erased or lags the card.
+static uint32_t seq_next = 0;
+static uint32_t seq_block_end = 0;
+
+static void reserve_seq_block() {
+    seq_block_end = seq_next + SEQ_BLOCK_SIZE;
+    prefs.putUInt("seq", seq_block_end);
+}
+
+// Starts from the NVS block, or past the highest indexed seq if NVS fell
+// behind it. Called again once a deferred index build finishes, in case
+// seqs were handed out from NVS alone before that.
+static void init_seq_allocator() {
+    ManifestLock lock;
+    bool started = seq_block_end != 0;
+    uint32_t next = started ? seq_next : prefs.getUInt("seq", 0);
+    bool behind = manifest_index_ready && manifest_index.size() > 0 && manifest_index.max_seq() >= next;
+    if (behind) next = manifest_index.max_seq() + 1;
+    if (started && !behind) return;
+    seq_next = next;
+    reserve_seq_block();
+}
+
 static uint32_t get_next_seq() {
-    uint32_t seq = prefs.getUInt("seq", 0);
-    prefs.putUInt("seq", seq + 1);
-    return seq;
+    ManifestLock lock;
+    if (seq_next >= seq_block_end) {
+        if (seq_block_end == 0) {
+            init_seq_allocator();
+        } else {
+            reserve_seq_block();
+        }
+    }
+    return seq_next++;
 }
 
-static String build_date_folder() {
+// Path builders write into caller buffers (at least sizeof(ManifestRecord::
+// filepath)) so the capture paths never allocate.
+static void build_date_folder(char* out, size_t cap) {
     if (!ntp_synced) {
-        return "/unsynced";
+        snprintf(out, cap, "/unsynced");
+        return;
     }
     time_t now;
     struct tm timeinfo;
     time(&now);
     localtime_r(&now, &timeinfo);
-
-    char folder[16];
-    strftime(folder, sizeof(folder), "/%Y%m%d", &timeinfo);
-    return String(folder);
+    strftime(out, cap, "/%Y%m%d", &timeinfo);
 }
 
-static String build_filename(uint32_t seq) {
+static bool build_filename(char* out, size_t cap, const char* folder, uint32_t seq) {
+    int n;
     if (!ntp_synced) {
-        return String("/img_") + String(seq) + ".jpg";
+        n = snprintf(out, cap, "%s/img_%lu.jpg", folder, static_cast<unsigned long>(seq));
+    } else {
+        time_t now;
+        struct tm timeinfo;
+        time(&now);
+        localtime_r(&now, &timeinfo);
+        n = snprintf(out, cap, "%s/%02d%02d%02d_%06lu.jpg", folder,
+                     timeinfo.tm_hour, timeinfo.tm_min, timeinfo.tm_sec,
+                     static_cast<unsigned long>(seq));
     }
-    time_t now;
-    struct tm timeinfo;
-    time(&now);
-    localtime_r(&now, &timeinfo);
-
-    char filename[32];
-    snprintf(filename, sizeof(filename), "/%02d%02d%02d_%06lu.jpg",
-             timeinfo.tm_hour, timeinfo.tm_min, timeinfo.tm_sec,
-             static_cast<unsigned long>(seq));
-    return String(filename);
+    return n > 0 && static_cast<size_t>(n) < cap;
 }
 
-static String build_audio_folder() {
+static void build_audio_folder(char* out, size_t cap) {
     if (!ntp_synced) {
-        return "/unsynced_audio";
+        snprintf(out, cap, "/unsynced_audio");
+        return;
     }
     time_t now;
     struct tm timeinfo;
     time(&now);
     localtime_r(&now, &timeinfo);
-
-    char folder[20];
-    strftime(folder, sizeof(folder), "/audio/%Y%m%d", &timeinfo);
-    return String(folder);
+    strftime(out, cap, "/audio/%Y%m%d", &timeinfo);
 }
 
-static String build_audio_filename(uint32_t seq) {
+static bool build_audio_filename(char* out, size_t cap, const char* folder, uint32_t seq) {
+    int n;
     if (!ntp_synced) {
-        return String("/audio_") + String(seq) + ".wav";
+        n = snprintf(out, cap, "%s/audio_%lu.wav", folder, static_cast<unsigned long>(seq));
+    } else {
+        time_t now;
+        struct tm timeinfo;
+        time(&now);
+        localtime_r(&now, &timeinfo);
+        n = snprintf(out, cap, "%s/%02d%02d%02d_%06lu.wav", folder,
+                     timeinfo.tm_hour, timeinfo.tm_min, timeinfo.tm_sec,
+                     static_cast<unsigned long>(seq));
     }
-    time_t now;
-    struct tm timeinfo;
-    time(&now);
-    localtime_r(&now, &timeinfo);
-
-    char filename[32];
-    snprintf(filename, sizeof(filename), "/%02d%02d%02d_%06lu.wav",
-             timeinfo.tm_hour, timeinfo.tm_min, timeinfo.tm_sec,
-             static_cast<unsigned long>(seq));
-    return String(filename);
+    return n > 0 && static_cast<size_t>(n) < cap;
 }
 
-static bool ensure_audio_folder(const String& folder) {
+static bool ensure_audio_folder(const char* folder) {
     if (!sd_ok) return false;
-    if (folder == "/unsynced_audio") {
-        if (!SD_MMC.exists(folder.c_str())) {
-            return SD_MMC.mkdir(folder.c_str());
-        }
-        return true;
-    }
-    if (folder.startsWith("/audio/")) {
+    if (strncmp(folder, "/audio/", 7) == 0) {
         if (!SD_MMC.exists("/audio")) {
             if (!SD_MMC.mkdir("/audio")) {
                 return false;
             }
         }
-        if (!SD_MMC.exists(folder.c_str())) {
-            return SD_MMC.mkdir(folder.c_str());
-        }
-        return true;
     }
-    if (!SD_MMC.exists(folder.c_str())) {
-        return SD_MMC.mkdir(folder.c_str());
+    if (!SD_MMC.exists(folder)) {
+        return SD_MMC.mkdir(folder);
     }
     return true;
 }
 
-static bool write_manifest_atomic(
+static ManifestStatus parse_manifest_status(const char* status) {
+    if (strcmp(status, "UPLOADED") == 0) return ManifestStatus::Uploaded;
+    if (strcmp(status, "FAILED") == 0) return ManifestStatus::Failed;
+    return ManifestStatus::Pending;
+}
+
+static ManifestItemType parse_manifest_item_type(const char* item_type) {
+    if (strcmp(item_type, "audio") == 0) return ManifestItemType::Audio;
+    if (strcmp(item_type, "thumbnail") == 0) return ManifestItemType::Thumbnail;
+    return ManifestItemType::Photo;
+}
+
+static const char* manifest_item_type_name(ManifestItemType item_type) {
+    switch (item_type) {
+    case ManifestItemType::Audio:
+        return "audio";
+    case ManifestItemType::Thumbnail:
+        return "thumbnail";
+    case ManifestItemType::Photo:
+        break;
+    }
+    return "photo";
+}
+
+static const char* manifest_content_type(ManifestItemType item_type) {
+    return item_type == ManifestItemType::Audio ? "audio/wav" : "image/jpeg";
+}
+
+static void index_record(const ManifestRecord& record, uint32_t offset, bool bulk_load = false) {
+    if (record.status == kManifestRecordRemoved) {
+        manifest_index.remove(record.seq, record.captured_epoch);
+        return;
+    }
+    ManifestIndexEntry entry;
+    entry.seq = record.seq;
+    entry.captured_epoch = record.captured_epoch;
+    entry.last_attempt_epoch = record.last_attempt_epoch;
+    entry.journal_offset = offset;
+    entry.size_bytes = record.size_bytes;
+    entry.status = static_cast<ManifestStatus>(record.status);
+    entry.item_type = static_cast<ManifestItemType>(record.item_type);
+    entry.upload_attempts = record.upload_attempts;
+    if (bulk_load) {
+        manifest_index.load(entry);
+    } else {
+        manifest_index.upsert(entry);
+    }
+}
+
+static bool append_manifest_record(ManifestRecord& record, bool bulk_load = false) {
+    uint32_t offset = 0;
+    bool appended = false;
+    {
+        PerfTimer timer(PerfOp::ManifestIo);
+        appended = manifest_journal.append(record, &offset);
+    }
+    if (!appended) {
+        Serial.println("Manifest journal append failed");
+        return false;
+    }
+    index_record(record, offset, bulk_load);
+    return true;
+}
+
+// When an item reached the card, for the end-to-end latency breakdown.
+struct ManifestTiming {
+    uint32_t queue_ms = 0;      // capture event -> first manifest record
+    uint32_t queued_epoch = 0;  // now_epoch() at that record
+};
+
+// Stamps an item captured at `event_ms` (millis()) as queued now.
+static ManifestTiming manifest_timing_since(uint32_t event_ms) {
+    ManifestTiming timing;
+    timing.queue_ms = static_cast<uint32_t>(millis()) - event_ms;
+    timing.queued_epoch = static_cast<uint32_t>(now_epoch());
+    return timing;
+}
+
+static bool fill_manifest_record(
+    ManifestRecord& record,
     uint32_t seq,
-    const String& filepath,
+    const char* filepath,
     time_t captured_epoch,
     const char* status,
     const char* item_type,
-    const char* content_type,
     int upload_attempts,
-    time_t last_attempt_epoch
+    time_t last_attempt_epoch,
+    uint16_t parts_done = 0,
+    uint32_t size_bytes = 0,
+    const uint32_t* linked_seq = nullptr,
+    int speech_confidence = -1,
+    const ManifestTiming* timing = nullptr
 ) {
-    if (!sd_ok) return false;
-    if (!SD_MMC.exists("/manifests")) {
-        SD_MMC.mkdir("/manifests");
-    }
-
-    String final_path = String("/manifests/") + String(seq) + ".json";
-    String tmp_path = final_path + ".tmp";
-
-    File f = SD_MMC.open(tmp_path.c_str(), FILE_WRITE);
-    if (!f) return false;
-
-    String payload = "{";
-    payload += "\"filepath\":\"" + filepath + "\",";
-    payload += "\"seq\":" + String(seq) + ",";
-    payload += "\"captured_at_epoch\":" + String(static_cast<unsigned long>(captured_epoch)) + ",";
-    payload += "\"status\":\"" + String(status) + "\",";
-    payload += "\"item_type\":\"" + String(item_type) + "\",";
-    payload += "\"content_type\":\"" + String(content_type) + "\",";
-    payload += "\"upload_attempts\":" + String(upload_attempts) + ",";
-    payload += "\"last_attempt_epoch\":" + String(static_cast<unsigned long>(last_attempt_epoch));
-    payload += "}";
-
-    size_t written = f.print(payload);
-    f.flush();
-    f.close();
-    if (written == 0) {
-        SD_MMC.remove(tmp_path.c_str());
+    size_t filepath_len = strlen(filepath);
+    if (filepath_len >= sizeof(record.filepath)) {
+        Serial.printf("Manifest path too long: %s\n", filepath);
         return false;
     }
+    memset(&record, 0, sizeof(record));
+    record.seq = seq;
+    record.captured_epoch = static_cast<uint32_t>(captured_epoch);
+    record.last_attempt_epoch = static_cast<uint32_t>(last_attempt_epoch);
+    record.status = static_cast<uint8_t>(parse_manifest_status(status));
+    record.item_type = static_cast<uint8_t>(parse_manifest_item_type(item_type));
+    record.upload_attempts = static_cast<uint8_t>(upload_attempts > 255 ? 255 : upload_attempts);
+    record.parts_done = parts_done;
+    record.size_bytes = size_bytes;
+    if (linked_seq) {
+        record.flags |= kManifestFlagLinked;
+        record.linked_seq = *linked_seq;
+    }
+    if (speech_confidence >= 0) {
+        record.flags |= kManifestFlagSpeechScored;
+        record.speech_confidence = static_cast<uint8_t>(speech_confidence > 100 ? 100 : speech_confidence);
+    }
+    if (timing) {
+        record.flags |= kManifestFlagTimed;
+        record.queue_ms = timing->queue_ms;
+        record.queued_epoch = timing->queued_epoch;
+    }
+    memcpy(record.filepath, filepath, filepath_len);
+    return true;
+}
 
-    if (SD_MMC.exists(final_path.c_str())) {
-        SD_MMC.remove(final_path.c_str());
-    }
-    if (!SD_MMC.rename(tmp_path.c_str(), final_path.c_str())) {
-        SD_MMC.remove(tmp_path.c_str());
+// Appends one journal record; the record CRC makes the state change atomic.
+static bool write_manifest_atomic(
+    uint32_t seq,
+    const char* filepath,
+    time_t captured_epoch,
+    const char* status,
+    const char* item_type,
+    int upload_attempts,
+    time_t last_attempt_epoch,
+    uint16_t parts_done = 0,
+    uint32_t size_bytes = 0,
+    const uint32_t* linked_seq = nullptr,
+    int speech_confidence = -1,
+    const ManifestTiming* timing = nullptr
+) {
+    if (!sd_ok) return false;
+    wait_manifest_index();
+    ManifestLock lock;
+    ManifestRecord record;
+    if (!fill_manifest_record(record, seq, filepath, captured_epoch, status, item_type, upload_attempts,
+                              last_attempt_epoch, parts_done, size_bytes, linked_seq, speech_confidence, timing)) {
         return false;
     }
-    return true;
+    return append_manifest_record(record);
 }
 
+// Inline storage only: items are copied between the scanner and the upload
+// slots on every cycle, so they must not own heap memory.
 struct PendingItem {
-    String manifest_path;
-    String filepath;
-    String item_type;
-    String content_type;
+    char filepath[sizeof(ManifestRecord::filepath)] = "";
+    ManifestItemType type = ManifestItemType::Photo;
     uint32_t seq = 0;
     time_t captured_epoch = 0;
     int upload_attempts = 0;
     time_t last_attempt_epoch = 0;
+    uint16_t parts_done = 0;
+    uint32_t size_bytes = 0;
+    bool linked = false;  // linked_seq names the other tier of this capture
+    uint32_t linked_seq = 0;
+    int speech_confidence = -1;  // audio: 0..100, -1 if unscored
+    bool timed = false;
+    ManifestTiming timing;
+
+    const uint32_t* link() const { return linked ? &linked_seq : nullptr; }
+    const ManifestTiming* queue_timing() const { return timed ? &timing : nullptr; }
+    const char* item_type() const { return manifest_item_type_name(type); }
+    const char* content_type() const { return manifest_content_type(type); }
+    const char* filename() const {
+        const char* slash = strrchr(filepath, '/');
+        return slash ? slash + 1 : filepath;
+    }
 };
 
-static bool load_manifest(const String& manifest_path, PendingItem& out, String* status_out = nullptr) {
+static bool remove_manifest(const PendingItem& item) {
+    ManifestLock lock;
+    ManifestRecord record;
+    memset(&record, 0, sizeof(record));
+    record.seq = item.seq;
+    record.captured_epoch = static_cast<uint32_t>(item.captured_epoch);
+    record.status = kManifestRecordRemoved;
+    return append_manifest_record(record);
+}
+
+static bool load_manifest(const ManifestIndexEntry& entry, PendingItem& out) {
+    PerfTimer timer(PerfOp::ManifestIo);
+    ManifestRecord record;
+    if (!manifest_journal.read(entry.journal_offset, record) || record.seq != entry.seq) {
+        return false;
+    }
+    record.filepath[sizeof(record.filepath) - 1] = 0;
+
+    memcpy(out.filepath, record.filepath, sizeof(out.filepath));
+    out.type = static_cast<ManifestItemType>(record.item_type);
+    out.seq = record.seq;
+    out.captured_epoch = record.captured_epoch;
+    out.upload_attempts = record.upload_attempts;
+    out.last_attempt_epoch = record.last_attempt_epoch;
+    out.parts_done = record.parts_done;
+    out.size_bytes = record.size_bytes;
+    out.linked = (record.flags & kManifestFlagLinked) != 0;
+    out.linked_seq = out.linked ? record.linked_seq : 0;
+    out.speech_confidence = (record.flags & kManifestFlagSpeechScored) ? record.speech_confidence : -1;
+    out.timed = (record.flags & kManifestFlagTimed) != 0;
+    out.timing.queue_ms = out.timed ? record.queue_ms : 0;
+    out.timing.queued_epoch = out.timed ? record.queued_epoch : 0;
+    return true;
+}
+
+// Pre-journal firmware stored one JSON file per item under /manifests.
+static bool load_legacy_manifest(const String& manifest_path, ManifestRecord& out) {
     File file = SD_MMC.open(manifest_path.c_str());
     if (!file) return false;
 
@@ -287,35 +733,146 @@ static bool load_manifest(const String& manifest_path, PendingItem& out, String*
     file.close();
     if (err != DeserializationError::Ok) return false;
 
-    out.manifest_path = manifest_path;
-    out.filepath = doc["filepath"] | "";
-    out.item_type = doc["item_type"] | "";
-    out.content_type = doc["content_type"] | "";
-    out.seq = doc["seq"] | 0;
-    out.captured_epoch = doc["captured_at_epoch"] | 0;
-    out.upload_attempts = doc["upload_attempts"] | 0;
-    out.last_attempt_epoch = doc["last_attempt_epoch"] | 0;
-
-    if (out.item_type.isEmpty()) {
-        if (out.filepath.endsWith(".wav")) {
-            out.item_type = "audio";
-        } else {
-            out.item_type = "photo";
+    String filepath = doc["filepath"] | "";
+    String item_type = doc["item_type"] | "";
+    if (item_type.isEmpty()) {
+        item_type = filepath.endsWith(".wav") ? "audio" : "photo";
+    }
+    File data = SD_MMC.open(filepath.c_str());
+    uint32_t size_bytes = data ? static_cast<uint32_t>(data.size()) : 0;
+    if (data) data.close();
+    return fill_manifest_record(
+        out,
+        doc["seq"] | 0,
+        filepath.c_str(),
+        doc["captured_at_epoch"] | 0,
+        doc["status"] | "",
+        item_type.c_str(),
+        doc["upload_attempts"] | 0,
+        doc["last_attempt_epoch"] | 0,
+        0,
+        size_bytes
+    );
+}
+
+static size_t import_legacy_manifests() {
+    File root = SD_MMC.open("/manifests");
+    if (!root) return 0;
+
+    size_t imported = 0;
+    size_t legacy_files = 0;
+    while (File f = root.openNextFile()) {
+        if (f.isDirectory()) { f.close(); continue; }
+        String name = f.name();
+        f.close();
+        if (name.endsWith(".json.tmp")) {
+            legacy_files++;
+            continue;
+        }
+        if (!name.endsWith(".json")) continue;
+        legacy_files++;
+
+        ManifestRecord record;
+        if (!load_legacy_manifest(String("/manifests/") + name, record)) continue;
+        if (append_manifest_record(record, true)) {
+            imported++;
         }
     }
-    if (out.content_type.isEmpty()) {
-        if (out.item_type == "audio") {
-            out.content_type = "audio/wav";
-        } else {
-            out.content_type = "image/jpeg";
+    root.close();
+    if (legacy_files == 0) return 0;
+
+    // Delete in a second pass so a crash mid-import only re-imports duplicates.
+    root = SD_MMC.open("/manifests");
+    if (!root) return imported;
+    while (File f = root.openNextFile()) {
+        if (f.isDirectory()) { f.close(); continue; }
+        String name = f.name();
+        f.close();
+        if (name.endsWith(".json") || name.endsWith(".json.tmp")) {
+            SD_MMC.remove((String("/manifests/") + name).c_str());
         }
     }
+    root.close();
+    return imported;
+}
 
-    const char* status = doc["status"] | "";
-    if (status_out) {
-        *status_out = status;
+static bool manifest_journal_needs_compaction() {
+    ManifestLock lock;
+    uint32_t records = manifest_journal.record_count();
+    return records >= MANIFEST_JOURNAL_COMPACT_MIN_RECORDS &&
+           records > manifest_index.size() * MANIFEST_JOURNAL_COMPACT_RATIO;
+}
+
+static void rebuild_manifest_index(bool allow_compaction = true);
+
+static void compact_manifest_journal() {
+    ManifestLock lock;
+    PowerGuard busy(PowerLockKind::CpuMax);
+    unsigned long start = millis();
+    uint32_t before = manifest_journal.record_count();
+    bool ok = manifest_journal.compact(
+        [](const ManifestRecord& record, uint32_t offset) {
+            const ManifestIndexEntry* entry = manifest_index.find(record.seq, record.captured_epoch);
+            return entry != nullptr && entry->journal_offset == offset;
+        },
+        [](const ManifestRecord& record, uint32_t offset) {
+            index_record(record, offset);
+        });
+    if (!ok) {
+        // Offsets may no longer match whatever journal ended up on the card.
+        Serial.println("Manifest journal compaction failed, reloading");
+        rebuild_manifest_index(false);
+        return;
+    }
+    Serial.printf("Manifest journal compacted %lu -> %lu records (%lu ms)\n",
+                  static_cast<unsigned long>(before),
+                  static_cast<unsigned long>(manifest_journal.record_count()),
+                  millis() - start);
+}
+
+static void rebuild_manifest_index(bool allow_compaction) {
+    ManifestLock lock;
+    manifest_index.clear();
+    manifest_index_ready = false;
+    if (!sd_ok) return;
+    if (!SD_MMC.exists("/manifests")) {
+        SD_MMC.mkdir("/manifests");
+    }
+
+    unsigned long start = millis();
+    if (!manifest_journal.begin(SD_MMC, kManifestJournalPath, kManifestJournalTmpPath)) {
+        Serial.println("Manifest journal open failed");
+        return;
+    }
+
+    ManifestJournalStats stats;
+    manifest_journal.replay(
+        [](const ManifestRecord& record, uint32_t offset) {
+            index_record(record, offset);
+        },
+        &stats);
+    size_t imported = import_legacy_manifests();
+    manifest_index.finish_load();
+    manifest_index_ready = true;
+
+    size_t pending_days = 0;
+    for (size_t i = 0; i < manifest_index.shard_count(); i++) {
+        if (manifest_index.shard(i).counts[static_cast<size_t>(ManifestStatus::Pending)] > 0) pending_days++;
+    }
+    Serial.printf("Manifest index: %u items over %u days (%u with pending), %u pending, %lu records, "
+                  "%lu corrupt, %u imported (%lu ms)\n",
+                  static_cast<unsigned>(manifest_index.size()),
+                  static_cast<unsigned>(manifest_index.shard_count()),
+                  static_cast<unsigned>(pending_days),
+                  static_cast<unsigned>(manifest_index.count(ManifestStatus::Pending)),
+                  static_cast<unsigned long>(stats.records),
+                  static_cast<unsigned long>(stats.corrupt),
+                  static_cast<unsigned>(imported),
+                  millis() - start);
+
+    if (allow_compaction && (stats.corrupt > 0 || stats.torn_tail || manifest_journal_needs_compaction())) {
+        compact_manifest_journal();
     }
-    return true;
 }
 
 static bool audio_pins_ready() {
@@ -338,9 +895,39 @@ static void write_le32(uint8_t* out, uint32_t value) {
     out[3] = static_cast<uint8_t>((value >> 24) & 0xFF);
 }
 
-static void write_wav_header(File& file, uint32_t data_bytes) {
-    uint8_t header[44];
-    memset(header, 0, sizeof(header));
+#if AUDIO_CODEC_ADPCM
+// IMA-ADPCM needs the extended fmt chunk plus a fact chunk carrying the
+// real sample count (the last block is padded).
+constexpr size_t kWavHeaderBytes = 60;
+
+static void build_wav_header(uint8_t* header, uint32_t data_bytes, uint32_t sample_count) {
+    constexpr uint32_t kBlockAlign = AUDIO_ADPCM_BLOCK_BYTES;
+    constexpr uint32_t kSamplesPerBlock = ImaAdpcmEncoder::samples_per_block(kBlockAlign);
+    memset(header, 0, kWavHeaderBytes);
+    memcpy(header, "RIFF", 4);
+    write_le32(header + 4, 52 + data_bytes);
+    memcpy(header + 8, "WAVE", 4);
+    memcpy(header + 12, "fmt ", 4);
+    write_le32(header + 16, 20);
+    write_le16(header + 20, 0x11);
+    write_le16(header + 22, 1);
+    write_le32(header + 24, AUDIO_SAMPLE_RATE);
+    write_le32(header + 28, (AUDIO_SAMPLE_RATE * kBlockAlign) / kSamplesPerBlock);
+    write_le16(header + 32, kBlockAlign);
+    write_le16(header + 34, 4);
+    write_le16(header + 36, 2);
+    write_le16(header + 38, kSamplesPerBlock);
+    memcpy(header + 40, "fact", 4);
+    write_le32(header + 44, 4);
+    write_le32(header + 48, sample_count);
+    memcpy(header + 52, "data", 4);
+    write_le32(header + 56, data_bytes);
+}
+#else
+constexpr size_t kWavHeaderBytes = 44;
+
+static void build_wav_header(uint8_t* header, uint32_t data_bytes, uint32_t) {
+    memset(header, 0, kWavHeaderBytes);
     memcpy(header, "RIFF", 4);
     write_le32(header + 4, 36 + data_bytes);
     memcpy(header + 8, "WAVE", 4);
@@ -355,51 +942,140 @@ static void write_wav_header(File& file, uint32_t data_bytes) {
     write_le16(header + 34, 16);
     memcpy(header + 36, "data", 4);
     write_le32(header + 40, data_bytes);
-    file.write(header, sizeof(header));
 }
+#endif
 
 static void preroll_push(const int16_t* samples, size_t count) {
     if (!audio_preroll || kAudioPrerollSamples == 0) return;
-    for (size_t i = 0; i < count; i++) {
-        audio_preroll[preroll_index++] = samples[i];
-        if (preroll_index >= kAudioPrerollSamples) {
-            preroll_index = 0;
-            preroll_filled = true;
-        }
+    if (count >= kAudioPrerollSamples) {
+        // Only the newest window survives; store it unrotated.
+        memcpy(audio_preroll, samples + (count - kAudioPrerollSamples), kAudioPrerollSamples * sizeof(int16_t));
+        preroll_index = 0;
+        preroll_filled = true;
+        return;
+    }
+
+    // At most two copies: up to the end of the ring, then the wrapped rest.
+    size_t first = kAudioPrerollSamples - preroll_index;
+    if (first > count) first = count;
+    memcpy(audio_preroll + preroll_index, samples, first * sizeof(int16_t));
+    size_t rest = count - first;
+    if (rest > 0) {
+        memcpy(audio_preroll, samples + first, rest * sizeof(int16_t));
+    }
+    preroll_index += count;
+    if (preroll_index >= kAudioPrerollSamples) {
+        preroll_index -= kAudioPrerollSamples;
+        preroll_filled = true;
+    }
+}
+
+static bool audio_ring_push(AudioSlotKind kind, const int16_t* samples, size_t count, time_t epoch,
+                            size_t expected_samples = 0, uint8_t confidence = 0) {
+    // Frames leave one slot free so the Stop/Discard closing a clip always fits.
+    size_t reserve = kind == AudioSlotKind::Frame || kind == AudioSlotKind::Start ? 2 : 1;
+    if (audio_ring.free_slots() < reserve) {
+        perf_count(PerfEvent::AudioDropped);
+        return false;
+    }
+    AudioSlot* slot = audio_ring.producer_slot();
+    slot->kind = kind;
+    slot->count = static_cast<uint16_t>(count);
+    slot->epoch = epoch;
+    slot->expected_samples = static_cast<uint32_t>(expected_samples);
+    slot->confidence = confidence;
+    slot->pushed_ms = millis();
+    if (count > 0) {
+        memcpy(slot->samples, samples, count * sizeof(int16_t));
+    }
+    audio_ring.producer_commit();
+    return true;
+}
+
+static size_t preroll_enqueue_span(const int16_t* samples, size_t count) {
+    size_t queued = 0;
+    while (count > 0) {
+        size_t chunk = count < kAudioFrameSamples ? count : kAudioFrameSamples;
+        if (!audio_ring_push(AudioSlotKind::Frame, samples, chunk, 0)) break;
+        samples += chunk;
+        count -= chunk;
+        queued += chunk;
     }
+    return queued;
 }
 
-static size_t preroll_write(File& file) {
+static size_t preroll_enqueue() {
     if (!audio_preroll || kAudioPrerollSamples == 0) return 0;
     size_t available = preroll_filled ? kAudioPrerollSamples : preroll_index;
     if (available == 0) return 0;
 
     size_t start = preroll_filled ? preroll_index : 0;
     size_t first_len = preroll_filled ? (kAudioPrerollSamples - start) : available;
-    size_t written = 0;
+    size_t queued = 0;
     if (first_len > 0) {
-        written += file.write(reinterpret_cast<const uint8_t*>(audio_preroll + start), first_len * sizeof(int16_t));
+        queued += preroll_enqueue_span(audio_preroll + start, first_len);
     }
     if (preroll_filled && start > 0) {
-        written += file.write(reinterpret_cast<const uint8_t*>(audio_preroll), start * sizeof(int16_t));
+        queued += preroll_enqueue_span(audio_preroll, start);
     }
-    return written / sizeof(int16_t);
+    return queued;
 }
 
 static size_t ms_to_samples(uint32_t ms) {
     return static_cast<size_t>((static_cast<uint64_t>(AUDIO_SAMPLE_RATE) * ms) / 1000ULL);
 }
 
-static float compute_rms(const int16_t* samples, size_t count) {
-    if (count == 0) return 0.0f;
-    uint64_t sum = 0;
-    for (size_t i = 0; i < count; i++) {
-        int32_t s = samples[i];
-        sum += static_cast<uint64_t>(s) * static_cast<uint64_t>(s);
-    }
-    float mean = static_cast<float>(sum) / static_cast<float>(count);
-    return sqrtf(mean);
+#if AUDIO_VAD_BENCHMARK
+// Cycles per frame for the feature kernel vs the original scalar RMS, on a
+// synthetic frame (results do not depend on the signal).
+static void run_vad_benchmark() {
+    static int16_t frame[kAudioFrameSamples];
+    uint32_t seed = 12345;
+    for (size_t i = 0; i < kAudioFrameSamples; i++) {
+        seed = seed * 1103515245u + 12345u;
+        frame[i] = static_cast<int16_t>(seed >> 16);
+    }
+
+    constexpr int kRuns = 1000;
+    volatile float sink = 0.0f;
+    uint32_t start = ESP.getCycleCount();
+    for (int i = 0; i < kRuns; i++) {
+        sink = sink + vad_reference_rms(frame, kAudioFrameSamples);
+    }
+    uint32_t reference_rms = (ESP.getCycleCount() - start) / kRuns;
+
+    VadFeatures features;
+    start = ESP.getCycleCount();
+    for (int i = 0; i < kRuns; i++) {
+        vad_reference_features(frame, kAudioFrameSamples, features);
+        sink = sink + features.rms;
+    }
+    uint32_t reference = (ESP.getCycleCount() - start) / kRuns;
+
+    start = ESP.getCycleCount();
+    for (int i = 0; i < kRuns; i++) {
+        vad_compute_features(frame, kAudioFrameSamples, features);
+        sink = sink + features.rms;
+    }
+    uint32_t kernel = (ESP.getCycleCount() - start) / kRuns;
+
+    SpeechDetector detector(speech_detector);
+    start = ESP.getCycleCount();
+    for (int i = 0; i < kRuns; i++) {
+        sink = sink + detector.speech_started(features);
+    }
+    uint32_t scoring = (ESP.getCycleCount() - start) / kRuns;
+
+    Serial.printf("VAD bench (%u samples @ %lu MHz, cycles/frame): rms+hf+zcr reference %lu, kernel %lu; "
+                  "rms-only reference %lu; speech score %lu\n",
+                  static_cast<unsigned>(kAudioFrameSamples),
+                  static_cast<unsigned long>(ESP.getCpuFreqMHz()),
+                  static_cast<unsigned long>(reference),
+                  static_cast<unsigned long>(kernel),
+                  static_cast<unsigned long>(reference_rms),
+                  static_cast<unsigned long>(scoring));
 }
+#endif
 
 static time_t adjust_start_epoch(time_t epoch) {
     uint32_t preroll_sec = AUDIO_PREROLL_MS / 1000;
@@ -431,6 +1107,10 @@ static bool init_audio() {
         memset(audio_preroll, 0, bytes);
     }
 
+    if (!audio_write_buffer.begin(AUDIO_WRITE_BUFFER_BYTES)) {
+        Serial.println("Audio write buffer alloc failed; writing frames directly");
+    }
+
     i2s_config_t i2s_config = {};
     i2s_config.mode = static_cast<i2s_mode_t>(I2S_MODE_MASTER | I2S_MODE_RX
 #if AUDIO_USE_PDM
@@ -448,7 +1128,7 @@ static bool init_audio() {
     i2s_config.tx_desc_auto_clear = false;
     i2s_config.fixed_mclk = 0;
 
-    if (i2s_driver_install(I2S_NUM_0, &i2s_config, 0, nullptr) != ESP_OK) {
+    if (i2s_driver_install(I2S_NUM_0, &i2s_config, 4, &i2s_event_queue) != ESP_OK) {
         Serial.println("I2S install failed");
         return false;
     }
@@ -473,179 +1153,329 @@ static bool init_audio() {
 
     i2s_set_clk(I2S_NUM_0, AUDIO_SAMPLE_RATE, I2S_BITS_PER_SAMPLE_16BIT, I2S_CHANNEL_MONO);
     i2s_zero_dma_buffer(I2S_NUM_0);
-    noise_rms = 0.0f;
+    speech_detector.reset();
     return true;
 #else
     return false;
 #endif
 }
 
+// Bytes to reserve on the card when a clip opens. Forced clips know their
+// length; VAD clips reserve AUDIO_PREALLOC_SEC and are trimmed at finish.
+static size_t audio_expected_bytes(size_t samples) {
+    if (samples == 0) samples = ms_to_samples(static_cast<uint32_t>(AUDIO_PREALLOC_SEC) * 1000UL);
+#if AUDIO_CODEC_ADPCM
+    size_t per_block = ImaAdpcmEncoder::samples_per_block(AUDIO_ADPCM_BLOCK_BYTES);
+    size_t data = ((samples + per_block - 1) / per_block) * AUDIO_ADPCM_BLOCK_BYTES;
+#else
+    size_t data = samples * sizeof(int16_t);
+#endif
+    return kWavHeaderBytes + data;
+}
+
+#if AUDIO_CODEC_ADPCM
+static bool write_audio_block() {
+    size_t bytes = audio_encoder.block_bytes();
+    if (!audio_write_buffer.write(audio_encoder.block(), bytes)) {
+        return false;
+    }
+    audio_data_bytes += bytes;
+    return true;
+}
+#endif
+
 static bool write_audio_frame(const int16_t* samples, size_t count) {
     if (!audio_file) return false;
+#if AUDIO_CODEC_ADPCM
+    for (size_t i = 0; i < count; i++) {
+        if (audio_encoder.add(samples[i]) && !write_audio_block()) {
+            return false;
+        }
+    }
+#else
     size_t bytes = count * sizeof(int16_t);
-    size_t written = audio_file.write(reinterpret_cast<const uint8_t*>(samples), bytes);
-    if (written != bytes) {
+    if (!audio_write_buffer.write(reinterpret_cast<const uint8_t*>(samples), bytes)) {
         return false;
     }
+    audio_data_bytes += bytes;
+#endif
     audio_samples_written += count;
     return true;
 }
 
-static void finish_audio_recording(bool keep) {
-    if (!audio_recording) return;
+// Drops the unused part of the preallocation. On failure the file keeps
+// its tail; players and ffmpeg stop at the data chunk size anyway.
+static void trim_audio_file(size_t bytes) {
+    char path[16 + sizeof(audio_filepath)];
+    snprintf(path, sizeof(path), "%s%s", kSdMountPoint, audio_filepath);
+    if (truncate(path, static_cast<off_t>(bytes)) != 0) {
+        Serial.printf("Failed to trim %s\n", audio_filepath);
+    }
+}
+
+// `speech_confidence`: 0..100 from the speech detector, or -1 if unscored.
+// `ended_ms`: millis() when the capture task closed the clip.
+static void finish_audio_recording(bool keep, int speech_confidence = -1, uint32_t ended_ms = 0) {
+    if (audio_filepath[0] == 0) return;
 
     size_t min_samples = static_cast<size_t>(AUDIO_MIN_SEC) * AUDIO_SAMPLE_RATE;
     if (audio_samples_written < min_samples) {
         keep = false;
     }
 
-    uint32_t data_bytes = static_cast<uint32_t>(audio_samples_written * sizeof(int16_t));
+#if AUDIO_CODEC_ADPCM
+    if (audio_file && keep && audio_encoder.pad() && !write_audio_block()) {
+        keep = false;
+    }
+#endif
+    uint32_t data_bytes = static_cast<uint32_t>(audio_data_bytes);
     if (audio_file) {
-        audio_file.seek(0);
-        write_wav_header(audio_file, data_bytes);
+        if (keep) {
+            // Drain the tail, then patch the header once in place.
+            keep = audio_write_buffer.flush();
+            uint8_t header[kWavHeaderBytes];
+            build_wav_header(header, data_bytes, static_cast<uint32_t>(audio_samples_written));
+            keep = keep && audio_file.seek(0) && audio_file.write(header, sizeof(header)) == sizeof(header);
+        }
+        audio_write_buffer.detach();
         audio_file.flush();
         audio_file.close();
+        if (keep && audio_preallocated) {
+            trim_audio_file(kWavHeaderBytes + data_bytes);
+        }
     }
 
-    if (!keep || audio_filepath.isEmpty()) {
-        if (!audio_filepath.isEmpty() && SD_MMC.exists(audio_filepath.c_str())) {
-            SD_MMC.remove(audio_filepath.c_str());
+    if (!keep) {
+        if (SD_MMC.exists(audio_filepath)) {
+            SD_MMC.remove(audio_filepath);
         }
     } else {
-        write_manifest_atomic(audio_seq, audio_filepath, audio_start_epoch, "PENDING", "audio", "audio/wav", 0, 0);
-        Serial.printf("Saved %s (%lu bytes)\n", audio_filepath.c_str(), static_cast<unsigned long>(data_bytes));
+        ManifestTiming timing = manifest_timing_since(ended_ms);
+        write_manifest_atomic(audio_seq, audio_filepath, audio_start_epoch, "PENDING", "audio", 0, 0, 0,
+                              static_cast<uint32_t>(kWavHeaderBytes + data_bytes), nullptr, speech_confidence,
+                              &timing);
+        Serial.printf("Saved %s (%lu bytes, speech %d%%)\n", audio_filepath, static_cast<unsigned long>(data_bytes),
+                      speech_confidence);
     }
 
-    audio_recording = false;
-    audio_force_active = false;
-    audio_force_stop_samples = 0;
     audio_samples_written = 0;
-    audio_filepath = "";
-    vad_over_count = 0;
-    vad_under_count = 0;
+    audio_data_bytes = 0;
+    audio_preallocated = false;
+    audio_filepath[0] = 0;
 }
 
-static bool start_audio_recording(const int16_t* samples, size_t count, time_t start_epoch, size_t force_stop_samples) {
-    if (!sd_ok || capture_paused) return false;
-    if (audio_recording) return false;
+static bool start_audio_recording(time_t start_epoch, size_t expected_samples) {
+    if (audio_filepath[0] != 0) {
+        finish_audio_recording(false);
+    }
 
     audio_seq = get_next_seq();
-    time_t epoch = start_epoch > 0 ? start_epoch : now_epoch();
-    audio_start_epoch = adjust_start_epoch(epoch);
-    audio_force_stop_samples = force_stop_samples;
-    audio_force_active = force_stop_samples > 0;
+    audio_start_epoch = adjust_start_epoch(start_epoch);
 
-    String folder = build_audio_folder();
+    char folder[24];
+    build_audio_folder(folder, sizeof(folder));
     if (!ensure_audio_folder(folder)) {
         Serial.println("Failed to create audio folder");
         return false;
     }
 
-    audio_filepath = folder + build_audio_filename(audio_seq);
-    audio_file = SD_MMC.open(audio_filepath.c_str(), FILE_WRITE);
+    if (!build_audio_filename(audio_filepath, sizeof(audio_filepath), folder, audio_seq)) {
+        audio_filepath[0] = 0;
+        return false;
+    }
+    audio_file = SD_MMC.open(audio_filepath, FILE_WRITE);
     if (!audio_file) {
         Serial.println("Failed to open audio file");
-        audio_filepath = "";
+        audio_filepath[0] = 0;
         return false;
     }
 
-    write_wav_header(audio_file, 0);
+    // Seeking past EOF makes FAT allocate the cluster chain now, so the card
+    // is not searching for free clusters mid-clip.
+    size_t reserve = audio_expected_bytes(expected_samples);
+    audio_preallocated = audio_file.seek(reserve) && audio_file.seek(0);
+
+    // The placeholder header goes through the buffer so later flushes stay
+    // sector-aligned; finish_audio_recording() patches it.
+    uint8_t header[kWavHeaderBytes];
+    build_wav_header(header, 0, 0);
+    audio_write_buffer.attach(audio_file);
+    audio_write_buffer.write(header, sizeof(header));
     audio_samples_written = 0;
+    audio_data_bytes = 0;
+#if AUDIO_CODEC_ADPCM
+    audio_encoder.reset();
+#endif
+    Serial.printf("Audio start seq %lu\n", static_cast<unsigned long>(audio_seq));
+    return true;
+}
 
-    audio_samples_written += preroll_write(audio_file);
-    audio_recording = true;
-    vad_under_count = 0;
+// Drains the audio ring to SD so slow card writes never stall I2S reads.
+static void audio_writer_task(void*) {
+    while (true) {
+        AudioSlot* slot = audio_ring.consumer_slot();
+        if (!slot) {
+            ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(100));
+            continue;
+        }
 
-    if (!write_audio_frame(samples, count)) {
-        finish_audio_recording(false);
-        return false;
+        switch (slot->kind) {
+        case AudioSlotKind::Start:
+            start_audio_recording(slot->epoch, slot->expected_samples);
+            break;
+        case AudioSlotKind::Frame:
+            if (audio_file && !write_audio_frame(slot->samples, slot->count)) {
+                finish_audio_recording(false);
+            }
+            break;
+        case AudioSlotKind::Stop:
+            finish_audio_recording(true, slot->confidence, slot->pushed_ms);
+            break;
+        case AudioSlotKind::Discard:
+            // Only false starts are discarded; count what they would have cost.
+            if (audio_filepath[0] != 0) {
+                perf_count(PerfEvent::VadDiscardedBytes, static_cast<uint32_t>(kWavHeaderBytes + audio_data_bytes));
+            }
+            finish_audio_recording(false);
+            break;
+        }
+        audio_ring.consumer_release();
     }
-
-    Serial.printf("Audio start seq %lu\n", static_cast<unsigned long>(audio_seq));
-    return true;
 }
 
-static void audio_tick() {
-#if AUDIO_ENABLED
-    if (!audio_ok) return;
+static bool begin_audio_clip(const int16_t* samples, size_t count, time_t start_epoch, size_t force_stop_samples) {
+    if (!sd_ok || capture_paused) return false;
+    if (audio_recording) return false;
 
-    size_t bytes_read = 0;
-    if (i2s_read(I2S_NUM_0, audio_frame, sizeof(audio_frame), &bytes_read, portMAX_DELAY) != ESP_OK) {
-        return;
+    time_t epoch = start_epoch > 0 ? start_epoch : now_epoch();
+    if (!audio_ring_push(AudioSlotKind::Start, nullptr, 0, epoch, force_stop_samples)) {
+        return false;
     }
 
-    size_t sample_count = bytes_read / sizeof(int16_t);
-    if (sample_count == 0) return;
+    audio_force_stop_samples = force_stop_samples;
+    audio_force_active = force_stop_samples > 0;
+    audio_clip_samples = preroll_enqueue();
+    audio_recording = true;
+    speech_detector.begin_clip(!audio_force_active);
+
+    audio_ring_push(AudioSlotKind::Frame, samples, count, 0);
+    audio_clip_samples += count;
+    return true;
+}
+
+static void end_audio_clip() {
+    SpeechClipResult clip = speech_detector.end_clip();
+    bool keep = !(AUDIO_VAD_DISCARD_FALSE_STARTS && clip.false_start);
+    if (clip.false_start) perf_count(PerfEvent::VadFalseStart);
+    audio_ring_push(keep ? AudioSlotKind::Stop : AudioSlotKind::Discard, nullptr, 0, 0, 0, clip.confidence);
+    vad_start_mult = speech_detector.start_mult();
+    audio_recording = false;
+    audio_force_active = false;
+    audio_force_stop_samples = 0;
+    audio_clip_samples = 0;
+}
 
-    float rms = compute_rms(audio_frame, sample_count);
+static void audio_process_frame(const int16_t* samples, size_t sample_count) {
+    PerfTimer timer(PerfOp::AudioFrame);
+    VadFeatures features;
+    vad_compute_features(samples, sample_count, features);
 
     if (!audio_recording) {
         bool force_start = false;
         size_t force_samples = 0;
         time_t force_epoch = 0;
 
-        if (audio_photo_clip_pending) {
-            audio_photo_clip_pending = false;
+        if (audio_photo_clip_pending.exchange(false)) {
             force_samples = kAudioPrerollSamples + ms_to_samples(AUDIO_PHOTO_CLIP_POST_MS);
             force_epoch = audio_photo_clip_epoch;
             force_start = true;
-        } else if (audio_heartbeat_pending) {
-            audio_heartbeat_pending = false;
+        } else if (audio_heartbeat_pending.exchange(false)) {
             force_samples = kAudioPrerollSamples + ms_to_samples(AUDIO_HEARTBEAT_DURATION_MS);
             force_epoch = now_epoch();
             force_start = true;
         }
 
         if (force_start) {
-            start_audio_recording(audio_frame, sample_count, force_epoch, force_samples);
+            begin_audio_clip(samples, sample_count, force_epoch, force_samples);
             return;
         }
 
-        preroll_push(audio_frame, sample_count);
+        preroll_push(samples, sample_count);
 
-        if (noise_rms <= 1.0f) {
-            noise_rms = rms;
-        } else if (rms < noise_rms * AUDIO_NOISE_UPDATE_MAX_MULT) {
-            noise_rms = noise_rms * (1.0f - AUDIO_NOISE_EMA_ALPHA) + rms * AUDIO_NOISE_EMA_ALPHA;
-        }
-
-        if (rms > noise_rms * AUDIO_RMS_START_MULT) {
-            vad_over_count++;
-        } else {
-            vad_over_count = 0;
-        }
-
-        if (vad_over_count >= AUDIO_VAD_START_FRAMES) {
-            if (start_audio_recording(audio_frame, sample_count, now_epoch(), 0)) {
-                vad_over_count = 0;
+        if (speech_detector.speech_started(features)) {
+            if (begin_audio_clip(samples, sample_count, now_epoch(), 0)) {
+#if CAPTURE_DEDUP_ENABLED && CAPTURE_BURST_ON_VAD
+                if (camera_task_handle) {
+                    photo_burst_requested = true;
+                    xTaskNotifyGive(camera_task_handle);
+                }
+#endif
             }
         }
         return;
     }
 
-    if (!write_audio_frame(audio_frame, sample_count)) {
-        finish_audio_recording(false);
-        return;
-    }
+    audio_ring_push(AudioSlotKind::Frame, samples, sample_count, 0);
+    audio_clip_samples += sample_count;
+    bool speech_over = speech_detector.speech_ended(features);
 
     if (audio_force_active) {
-        if (audio_force_stop_samples > 0 && audio_samples_written >= audio_force_stop_samples) {
-            finish_audio_recording(true);
+        if (audio_force_stop_samples > 0 && audio_clip_samples >= audio_force_stop_samples) {
+            end_audio_clip();
         }
         return;
     }
 
-    if (rms < noise_rms * AUDIO_RMS_STOP_MULT) {
-        vad_under_count++;
-    } else {
-        vad_under_count = 0;
+    float duration_sec = static_cast<float>(audio_clip_samples) / static_cast<float>(AUDIO_SAMPLE_RATE);
+    if (speech_over || duration_sec >= AUDIO_MAX_SEC) {
+        end_audio_clip();
+    }
+}
+
+// Pinned, high-priority I2S reader: only reads, runs VAD and enqueues, so the
+// DMA buffers are serviced even while loop() is uploading or the card stalls.
+static void audio_capture_task(void*) {
+    while (true) {
+        size_t bytes_read = 0;
+        if (i2s_read(I2S_NUM_0, audio_frame, sizeof(audio_frame), &bytes_read, portMAX_DELAY) != ESP_OK) {
+            vTaskDelay(1);
+            continue;
+        }
+
+        i2s_event_t event;
+        while (i2s_event_queue && xQueueReceive(i2s_event_queue, &event, 0) == pdTRUE) {
+            if (event.type == I2S_EVENT_RX_Q_OVF) perf_count(PerfEvent::I2sOverrun);
+        }
+
+        size_t sample_count = bytes_read / sizeof(int16_t);
+        if (sample_count == 0) continue;
+
+        audio_process_frame(audio_frame, sample_count);
+        xTaskNotifyGive(audio_writer_task_handle);
     }
+}
 
-    float duration_sec = static_cast<float>(audio_samples_written) / static_cast<float>(AUDIO_SAMPLE_RATE);
-    if (vad_under_count >= AUDIO_VAD_STOP_FRAMES || duration_sec >= AUDIO_MAX_SEC) {
-        finish_audio_recording(true);
+static bool start_audio_tasks() {
+    size_t ring_frames = psramFound()
+        ? (AUDIO_RING_MS / AUDIO_FRAME_MS)
+        : (AUDIO_PREROLL_MS / AUDIO_FRAME_MS) + 16;
+    if (!audio_ring.init(ring_frames)) {
+        Serial.println("Audio ring alloc failed");
+        return false;
     }
-#endif
+    if (xTaskCreatePinnedToCore(audio_writer_task, "audio_sd", 6144, nullptr,
+                                AUDIO_WRITER_TASK_PRIORITY, &audio_writer_task_handle,
+                                AUDIO_WRITER_TASK_CORE) != pdPASS) {
+        Serial.println("Audio writer task create failed");
+        return false;
+    }
+    if (xTaskCreatePinnedToCore(audio_capture_task, "audio_i2s", 4096, nullptr,
+                                AUDIO_CAPTURE_TASK_PRIORITY, &audio_capture_task_handle,
+                                AUDIO_CAPTURE_TASK_CORE) != pdPASS) {
+        Serial.println("Audio capture task create failed");
+        return false;
+    }
+    return true;
 }
 
 static unsigned long backoff_seconds(int attempts) {
@@ -655,477 +1485,1785 @@ static unsigned long backoff_seconds(int attempts) {
     return UPLOAD_BACKOFF_SEC_3;
 }
 
-static bool find_oldest_pending(PendingItem& out) {
-    if (!sd_ok) return false;
-    File root = SD_MMC.open("/manifests");
-    if (!root) return false;
+static bool load_indexed_manifest(const ManifestIndexEntry& entry, PendingItem& out) {
+    if (load_manifest(entry, out)) {
+        return true;
+    }
+    // Manifest vanished or is unreadable; drop it so the queue cannot stall on it.
+    manifest_index.remove(entry.seq, entry.captured_epoch);
+    return false;
+}
 
-    bool found = false;
-    time_t best_epoch = 0;
-    uint32_t best_seq = 0;
-    time_t now = now_epoch();
+// Order the pending queue is drained in; set from GET /devices/config and
+// kept in NVS ("upload_order").
+enum class UploadOrder : uint8_t {
+    Oldest,
+    Newest,
+    Smallest,
+    // Oldest first, but a photo and the clip recorded with it (captured within
+    // UPLOAD_PAIR_WINDOW_SEC) are claimed back to back.
+    Paired,
+};
 
-    while (File f = root.openNextFile()) {
-        if (f.isDirectory()) { f.close(); continue; }
-        String name = f.name();
-        f.close();
-        if (!name.endsWith(".json")) continue;
+static UploadOrder upload_order = UploadOrder::Oldest;
+static ManifestIndexEntry upload_pair_anchor;
+static bool upload_pair_anchor_valid = false;
+
+static const char* upload_order_name(UploadOrder order) {
+    switch (order) {
+    case UploadOrder::Oldest: return "oldest";
+    case UploadOrder::Newest: return "newest";
+    case UploadOrder::Smallest: return "smallest";
+    case UploadOrder::Paired: return "paired";
+    }
+    return "oldest";
+}
+
+static bool parse_upload_order(const char* name, UploadOrder& out) {
+    if (!name) return false;
+    for (uint8_t i = 0; i <= static_cast<uint8_t>(UploadOrder::Paired); i++) {
+        UploadOrder order = static_cast<UploadOrder>(i);
+        if (strcmp(name, upload_order_name(order)) == 0) {
+            out = order;
+            return true;
+        }
+    }
+    return false;
+}
+
+static void set_upload_order(UploadOrder order) {
+    if (order == upload_order) return;
+    upload_order = order;
+    upload_pair_anchor_valid = false;
+    prefs.putUChar("upload_order", static_cast<uint8_t>(order));
+    Serial.printf("Upload order: %s\n", upload_order_name(order));
+}
+
+template <typename Accept>
+static const ManifestIndexEntry* select_pending(ManifestTier tier, Accept accept) {
+    switch (upload_order) {
+    case UploadOrder::Newest:
+        return manifest_index.newest_where(ManifestStatus::Pending, tier, accept);
+    case UploadOrder::Smallest:
+        return manifest_index.smallest_where(ManifestStatus::Pending, tier, accept);
+    case UploadOrder::Paired:
+        if (upload_pair_anchor_valid) {
+            upload_pair_anchor_valid = false;
+            ManifestItemType anchor_type = upload_pair_anchor.item_type;
+            const ManifestIndexEntry* partner = manifest_index.nearest_where(
+                ManifestStatus::Pending, tier, upload_pair_anchor.captured_epoch, UPLOAD_PAIR_WINDOW_SEC,
+                [&accept, anchor_type](const ManifestIndexEntry& entry) {
+                    return entry.item_type != anchor_type && accept(entry);
+                });
+            if (partner) return partner;
+        }
+        if (const ManifestIndexEntry* found = manifest_index.oldest_where(ManifestStatus::Pending, tier, accept)) {
+            upload_pair_anchor = *found;
+            upload_pair_anchor_valid = true;
+            return found;
+        }
+        return nullptr;
+    case UploadOrder::Oldest:
+        break;
+    }
+    return manifest_index.oldest_where(ManifestStatus::Pending, tier, accept);
+}
+
+// Set by update_upload_tiering() while the backlog outruns the link.
+static bool upload_thumbnails_first = false;
+
+// Next pending item under the current upload order, skipping items still in
+// retry backoff. Items out of attempts are marked FAILED on the way. The
+// preferred tier (thumbnails or everything else) is drained first; the index
+// queries each tier on its own, so the other tier's backlog is never scanned.
+static bool find_next_pending(PendingItem& out, bool (*skip)(const ManifestIndexEntry&) = nullptr) {
+    ManifestLock lock;
+    if (!sd_ok || !manifest_index_ready) return false;
+    time_t now = now_epoch();
+    ManifestTier tier = upload_thumbnails_first ? ManifestTier::Thumbnail : ManifestTier::Full;
+    bool fallback = false;
+
+    while (true) {
+        const ManifestIndexEntry* found = select_pending(
+            tier, [now, skip](const ManifestIndexEntry& entry) {
+                if (skip && skip(entry)) return false;
+                if (entry.upload_attempts >= UPLOAD_MAX_ATTEMPTS) return true;
+                unsigned long backoff = backoff_seconds(entry.upload_attempts);
+                return !(backoff > 0 && (now - static_cast<time_t>(entry.last_attempt_epoch)) < (time_t)backoff);
+            });
+        if (!found) {
+            if (fallback) return false;
+            fallback = true;
+            tier = tier == ManifestTier::Thumbnail ? ManifestTier::Full : ManifestTier::Thumbnail;
+            continue;
+        }
 
+        ManifestIndexEntry entry = *found;
         PendingItem item;
-        String status;
-        if (!load_manifest(String("/manifests/") + name, item, &status)) continue;
-        if (status != "PENDING") continue;
+        if (!load_indexed_manifest(entry, item)) continue;
 
         if (item.upload_attempts >= UPLOAD_MAX_ATTEMPTS) {
-            write_manifest_atomic(
+            bool written = write_manifest_atomic(
                 item.seq,
                 item.filepath,
                 item.captured_epoch,
                 "FAILED",
-                item.item_type.c_str(),
-                item.content_type.c_str(),
+                item.item_type(),
                 item.upload_attempts,
-                item.last_attempt_epoch
+                item.last_attempt_epoch,
+                item.parts_done,
+                item.size_bytes,
+                item.link(),
+                item.speech_confidence
             );
+            if (!written) {
+                entry.status = ManifestStatus::Failed;
+                manifest_index.upsert(entry);
+            }
             continue;
         }
 
-        unsigned long backoff = backoff_seconds(item.upload_attempts);
-        if (backoff > 0 && (now - item.last_attempt_epoch) < (time_t)backoff) {
-            continue;
-        }
-
-        bool better = false;
-        if (!found) {
-            better = true;
-        } else if (item.captured_epoch > 0 && best_epoch > 0) {
-            better = item.captured_epoch < best_epoch;
-        } else if (item.captured_epoch > 0 && best_epoch == 0) {
-            better = true;
-        } else if (item.captured_epoch == 0 && best_epoch == 0) {
-            better = item.seq < best_seq;
-        }
-
-        if (better) {
-            out = item;
-            found = true;
-            best_epoch = item.captured_epoch;
-            best_seq = item.seq;
-        }
+        out = item;
+        return true;
     }
-
-    root.close();
-    return found;
 }
 
 static bool find_oldest_uploaded(PendingItem& out) {
-    if (!sd_ok) return false;
-    File root = SD_MMC.open("/manifests");
-    if (!root) return false;
-
-    bool found = false;
-    time_t best_epoch = 0;
-    uint32_t best_seq = 0;
-
-    while (File f = root.openNextFile()) {
-        if (f.isDirectory()) { f.close(); continue; }
-        String name = f.name();
-        f.close();
-        if (!name.endsWith(".json")) continue;
+    ManifestLock lock;
+    if (!sd_ok || !manifest_index_ready) return false;
 
-        PendingItem item;
-        String status;
-        if (!load_manifest(String("/manifests/") + name, item, &status)) continue;
-        if (status != "UPLOADED") continue;
-
-        bool better = false;
-        if (!found) {
-            better = true;
-        } else if (item.captured_epoch > 0 && best_epoch > 0) {
-            better = item.captured_epoch < best_epoch;
-        } else if (item.captured_epoch > 0 && best_epoch == 0) {
-            better = true;
-        } else if (item.captured_epoch == 0 && best_epoch == 0) {
-            better = item.seq < best_seq;
+    while (const ManifestIndexEntry* found = manifest_index.oldest(ManifestStatus::Uploaded)) {
+        ManifestIndexEntry entry = *found;
+        if (load_indexed_manifest(entry, out)) {
+            return true;
         }
+    }
+    return false;
+}
 
-        if (better) {
-            out = item;
-            found = true;
-            best_epoch = item.captured_epoch;
-            best_seq = item.seq;
-        }
+// Bytes the manifest index accounts for: item sizes plus, on average, half
+// an allocation unit of slack per file.
+static uint64_t tracked_item_bytes() {
+    ManifestLock lock;
+    uint64_t bytes = 0;
+    for (size_t s = 0; s < kManifestStatusCount; s++) {
+        bytes += manifest_index.bytes(static_cast<ManifestStatus>(s));
     }
+    return bytes + static_cast<uint64_t>(manifest_index.size()) * (SD_ALLOC_UNIT_BYTES / 2);
+}
 
-    root.close();
-    return found;
+// SD_MMC.usedBytes() walks the FAT, which takes seconds on large cards. It is
+// sampled once per SD_USAGE_RESYNC_INTERVAL_MS; in between, used space is the
+// sampled remainder (journal, logs, FAT metadata) plus the indexed items.
+static void resync_sd_usage() {
+    if (!sd_ok) return;
+    unsigned long started = millis();
+    sd_total_bytes = SD_MMC.totalBytes();
+    uint64_t used = SD_MMC.usedBytes();
+    uint64_t tracked = manifest_index_ready ? tracked_item_bytes() : 0;
+    sd_untracked_bytes = used > tracked ? used - tracked : 0;
+    sd_usage_synced = sd_total_bytes > 0;
+    last_sd_usage_resync = millis();
+    Serial.printf("SD usage resync: %llu/%llu MB used (%lu ms)\n",
+                  static_cast<unsigned long long>(used / (1024 * 1024)),
+                  static_cast<unsigned long long>(sd_total_bytes / (1024 * 1024)),
+                  static_cast<unsigned long>(last_sd_usage_resync - started));
+}
+
+static uint64_t sd_used_bytes() {
+    if (!manifest_index_ready) return SD_MMC.usedBytes();
+    if (!sd_usage_synced) resync_sd_usage();
+    return sd_untracked_bytes + tracked_item_bytes();
 }
 
 static uint8_t free_percent() {
-    uint64_t total = SD_MMC.totalBytes();
-    uint64_t used = SD_MMC.usedBytes();
-    if (total == 0) return 0;
+    uint64_t used = sd_used_bytes();
+    uint64_t total = manifest_index_ready ? sd_total_bytes : SD_MMC.totalBytes();
+    if (total == 0 || used >= total) return 0;
     uint64_t free_bytes = total - used;
     return static_cast<uint8_t>((free_bytes * 100) / total);
 }
 
-static void enforce_retention() {
+// Retention runs ahead of the low-water mark: once free space drops below
+// SD_RETENTION_START_FREE_PERCENT it deletes the oldest uploaded items in
+// batches of RETENTION_BATCH_ITEMS, one batch per RETENTION_STEP_INTERVAL_MS
+// (every pass below SD_MIN_FREE_PERCENT), until
+// SD_RETENTION_TARGET_FREE_PERCENT is free again.
+static void retention_step(unsigned long now) {
     if (!sd_ok) return;
 
     uint8_t free_pct = free_percent();
-    if (free_pct >= SD_MIN_FREE_PERCENT) {
-        capture_paused = false;
+    if (!retention_active) {
+        if (free_pct >= SD_RETENTION_START_FREE_PERCENT) {
+            capture_paused = false;
+            return;
+        }
+        retention_active = true;
+        retention_deleted = 0;
+        Serial.printf("SD free %u%%, starting retention\n", free_pct);
+    }
+    if (free_pct >= SD_MIN_FREE_PERCENT && now - last_retention_step < RETENTION_STEP_INTERVAL_MS) {
         return;
     }
+    last_retention_step = now;
 
-    Serial.printf("SD free %u%%, enforcing retention\n", free_pct);
-    int deletions = 0;
-    while (free_pct < SD_MIN_FREE_PERCENT) {
+    bool exhausted = false;
+    for (int i = 0; i < RETENTION_BATCH_ITEMS && free_pct < SD_RETENTION_TARGET_FREE_PERCENT; i++) {
         PendingItem item;
         if (!find_oldest_uploaded(item)) {
+            exhausted = true;
             break;
         }
 
-        if (SD_MMC.exists(item.filepath.c_str())) {
-            SD_MMC.remove(item.filepath.c_str());
+        if (SD_MMC.exists(item.filepath)) {
+            SD_MMC.remove(item.filepath);
         }
-        if (SD_MMC.exists(item.manifest_path.c_str())) {
-            SD_MMC.remove(item.manifest_path.c_str());
+        if (!remove_manifest(item)) {
+            exhausted = true;
+            break;
         }
-        deletions++;
+        retention_deleted++;
         free_pct = free_percent();
     }
 
-    Serial.printf("Retention removed %d items, free now %u%%\n", deletions, free_pct);
-    capture_paused = (free_pct < SD_EMERGENCY_FREE_PERCENT);
-    if (capture_paused) {
+    if (exhausted || free_pct >= SD_RETENTION_TARGET_FREE_PERCENT) {
+        retention_active = false;
+        Serial.printf("Retention removed %lu items, free now %u%%\n",
+                      static_cast<unsigned long>(retention_deleted), free_pct);
+    }
+    bool paused = free_pct < SD_EMERGENCY_FREE_PERCENT;
+    if (paused && !capture_paused) {
         Serial.println("EMERGENCY: capture paused (low SD free)");
     }
+    capture_paused = paused;
 }
 
 static int count_pending_manifests() {
-    if (!sd_ok) return 0;
-    File root = SD_MMC.open("/manifests");
-    if (!root) return 0;
-
-    int count = 0;
-    while (File f = root.openNextFile()) {
-        if (f.isDirectory()) { f.close(); continue; }
-        String name = f.name();
-        f.close();
-        if (!name.endsWith(".json")) continue;
-
-        PendingItem item;
-        String status;
-        if (!load_manifest(String("/manifests/") + name, item, &status)) continue;
-        if (status == "PENDING") count++;
-    }
+    ManifestLock lock;
+    if (!sd_ok || !manifest_index_ready) return 0;
+    return static_cast<int>(manifest_index.count(ManifestStatus::Pending));
+}
 
-    root.close();
-    return count;
+static uint64_t pending_backlog_bytes() {
+    ManifestLock lock;
+    if (!sd_ok || !manifest_index_ready) return 0;
+    return manifest_index.bytes(ManifestStatus::Pending);
 }
 
-static void send_telemetry() {
+static WifiScheduler wifi_scheduler({
+    WIFI_DUTY_CYCLE_INTERVAL_MS,
+    WIFI_DUTY_CYCLE_COOLDOWN_MS,
+    WIFI_DUTY_CYCLE_WINDOW_MS,
+    WIFI_DUTY_CYCLE_MAX_WINDOW_MS,
+    WIFI_SCHED_CONNECT_BUDGET_MS,
+    WIFI_SCHED_MIN_BATCH_BYTES,
+    WIFI_SCHED_STALL_SAMPLE_MS,
+    WIFI_SCHED_STALL_MIN_BPS,
+    WIFI_SCHED_WEAK_RSSI,
+    WIFI_SCHED_DEFAULT_BPS,
+    WIFI_SCHED_JITTER_MS,
+});
+
+// Applies the server's per-device settings. Only upload_order is acted on;
+// the remaining fields mirror compile-time config.
+static void fetch_device_config() {
     if (!wifi_ok || strlen(DEVICE_TOKEN) == 0) return;
 
     HTTPClient http;
-    String url = String(API_BASE_URL) + "/devices/telemetry";
+    String url = String(API_BASE_URL) + DEVICES_CONFIG_PATH;
     http.begin(url);
     http.addHeader("X-Device-Token", DEVICE_TOKEN);
-    http.addHeader("Content-Type", "application/json");
+    // HTTP/1.0 keeps the body unchunked so it can be parsed off the stream.
+    http.useHTTP10(true);
+    int code = http.GET();
+    if (code == 200) {
+        StaticJsonDocument<32> filter;
+        filter["upload_order"] = true;
+        StaticJsonDocument<128> doc;
+        if (!deserializeJson(doc, http.getStream(), DeserializationOption::Filter(filter))) {
+            UploadOrder order = upload_order;
+            const char* name = doc["upload_order"];
+            if (parse_upload_order(name, order)) {
+                set_upload_order(order);
+            }
+        }
+    } else {
+        Serial.printf("Config fetch failed: %d\n", code);
+    }
+    http.end();
+}
 
-    uint64_t used = SD_MMC.usedBytes();
-    uint64_t total = SD_MMC.totalBytes();
-    uint64_t free_bytes = total > used ? (total - used) : 0;
+static const char* reset_reason_name(esp_reset_reason_t reason) {
+    switch (reason) {
+    case ESP_RST_POWERON:
+        return "poweron";
+    case ESP_RST_BROWNOUT:
+        return "brownout";
+    case ESP_RST_DEEPSLEEP:
+        return "deepsleep";
+    case ESP_RST_SW:
+        return "software";
+    case ESP_RST_PANIC:
+        return "panic";
+    case ESP_RST_INT_WDT:
+    case ESP_RST_TASK_WDT:
+    case ESP_RST_WDT:
+        return "watchdog";
+    case ESP_RST_EXT:
+        return "external";
+    default:
+        return "other";
+    }
+}
 
-    StaticJsonDocument<256> payload;
-    payload["uptime_seconds"] = millis() / 1000;
-    payload["sd_used_mb"] = static_cast<int>(used / (1024 * 1024));
-    payload["sd_free_mb"] = static_cast<int>(free_bytes / (1024 * 1024));
-    payload["backlog_count"] = count_pending_manifests();
-    payload["wifi_rssi"] = WiFi.RSSI();
-    payload["firmware_version"] = FIRMWARE_VERSION;
+static void update_manifest_status(const PendingItem& item, const char* status, int attempts, time_t last_attempt_epoch) {
+    write_manifest_atomic(
+        item.seq,
+        item.filepath,
+        item.captured_epoch,
+        status,
+        item.item_type(),
+        attempts,
+        last_attempt_epoch,
+        item.parts_done,
+        item.size_bytes,
+        item.link(),
+        item.speech_confidence,
+        item.queue_timing()
+    );
+}
 
-    String body;
-    serializeJson(payload, body);
-    http.POST(body);
-    http.end();
+// Upload pipeline: up to UPLOAD_PIPELINE_DEPTH items are in flight at once.
+// Each item moves through upload-url -> PUT -> ingest. API requests are
+// written on the keep-alive API connection without waiting for earlier
+// responses (HTTP/1.1 pipelining; responses come back in request order), so
+// the upload-url for the next items is already on the wire while the current
+// one streams to object storage on its own connection. When the server has
+// the batch endpoints, one upload-url or ingest request covers up to
+// UPLOAD_API_BATCH_MAX items.
+//
+// Files of UPLOAD_RESUMABLE_MIN_BYTES or more go up in UPLOAD_PART_BYTES
+// parts (upload-parts -> PUT per part -> complete -> ingest). Every finished
+// part is recorded in the manifest, so a retry only sends the missing parts
+// and an attempt that made progress does not count against
+// UPLOAD_MAX_ATTEMPTS.
+enum class UploadSlotState : uint8_t {
+    Empty,
+    AwaitTarget,
+    Ready,
+    NeedsComplete,
+    AwaitComplete,
+    Uploaded,
+    AwaitIngest,
+};
+
+struct UploadSlot {
+    UploadSlotState state = UploadSlotState::Empty;
+    PendingItem item;
+    int attempts = 0;
+    time_t attempt_epoch = 0;
+    // Point into `arena` (or at ""), valid until the slot is released.
+    const char* host = "";
+    uint16_t port = 443;
+    const char* path = "";
+    const char* object_key = "";
+    unsigned long stage_start = 0;
+    unsigned long claim_ms = 0;
+    uint32_t target_ms = 0;
+    uint32_t put_ms = 0;
+    size_t bytes = 0;
+    size_t file_size = 0;
+    bool multipart = false;
+    bool progressed = false;
+    uint16_t part_count = 0;
+    const char* part_paths[UPLOAD_MAX_PARTS] = {};  // indexed from item.parts_done
+    StringArena arena;
+};
+
+enum class ApiOpKind : uint8_t {
+    UploadUrl,
+    UploadParts,
+    CompleteParts,
+    Ingest,
+    Telemetry,  // summary report (no samples) or a batch of ring samples
+};
+
+// One request on the API connection. Every slot is in at most one op, so
+// UPLOAD_PIPELINE_DEPTH ops always fit.
+struct ApiOp {
+    ApiOpKind kind;
+    bool batch;
+    uint8_t count;
+    uint8_t slots[UPLOAD_API_BATCH_MAX];
+    // Telemetry sample numbers [first, end); equal for the summary report.
+    uint32_t telemetry_first = 0;
+    uint32_t telemetry_end = 0;
+};
+
+// Learned from the first batch request; a 404/405 switches to the per-item
+// endpoints until reboot.
+enum class ApiBatchSupport : uint8_t {
+    Unknown,
+    Supported,
+    Unsupported,
+};
+
+static UploadSlot upload_slots[UPLOAD_PIPELINE_DEPTH];
+static ApiOp api_ops[UPLOAD_PIPELINE_DEPTH];
+static size_t api_ops_head = 0;
+static size_t api_ops_count = 0;
+static ApiBatchSupport api_batch_support = ApiBatchSupport::Unknown;
+static ApiBatchSupport api_parts_support = ApiBatchSupport::Unknown;
+
+// Samples taken every TELEMETRY_SAMPLE_INTERVAL_MS, radio on or off, and the
+// perf counters of the summary report awaiting its response.
+static TelemetryRing telemetry_ring;
+static PerfSnapshot telemetry_perf;
+static unsigned long telemetry_perf_ms = 0;
+
+// API request/response documents are sized for the largest batch or parts
+// listing and allocated once, so the upload loop itself never allocates.
+// Responses are parsed straight off the socket through a filter that keeps
+// only the fields below, and the strings a slot keeps are copied into its
+// arena before the next response reuses the document.
+constexpr size_t kApiBatchRequestBytes = 256 + UPLOAD_API_BATCH_MAX * 448;
+// The hourly summary: about 150 values, most of them in the perf rows.
+constexpr size_t kTelemetryReportBytes = 3072;
+constexpr size_t kApiRequestBytes =
+    kApiBatchRequestBytes > kTelemetryReportBytes ? kApiBatchRequestBytes : kTelemetryReportBytes;
+constexpr size_t kApiBatchResponseBytes = 256 + UPLOAD_API_BATCH_MAX * 768;
+constexpr size_t kApiPartsResponseBytes = 256 + UPLOAD_MAX_PARTS * 768;
+constexpr size_t kApiResponseBytes =
+    kApiBatchResponseBytes > kApiPartsResponseBytes ? kApiBatchResponseBytes : kApiPartsResponseBytes;
+
+struct PsramJsonAllocator {
+    void* allocate(size_t size) { return PsramAllocator<uint8_t>::try_allocate(size); }
+    void deallocate(void* ptr) { free(ptr); }
+    void* reallocate(void* ptr, size_t size) { return realloc(ptr, size); }
+};
+using PsramJsonDocument = BasicJsonDocument<PsramJsonAllocator>;
+
+static char api_request_body[kApiRequestBytes];
+
+static PsramJsonDocument& api_request_doc() {
+    static PsramJsonDocument doc(kApiRequestBytes);
+    return doc;
 }
 
-static int read_http_status_code(WiFiClient& client) {
-    char line[96];
-    size_t n = client.readBytesUntil('\n', line, sizeof(line) - 1);
-    line[n] = 0;
+static PsramJsonDocument& api_response_doc() {
+    static PsramJsonDocument doc(kApiResponseBytes);
+    return doc;
+}
 
-    const char* p = strchr(line, ' ');
-    if (!p) return -1;
-    while (*p == ' ') p++;
-    int code = atoi(p);
-    return code;
+static void add_target_fields(JsonVariant filter) {
+    filter["upload_host"] = true;
+    filter["upload_port"] = true;
+    filter["upload_path"] = true;
+    filter["object_key"] = true;
 }
 
-static bool stream_upload(const PendingItem& item, const String& host, uint16_t port, const String& path) {
-    File file = SD_MMC.open(item.filepath.c_str());
-    if (!file) return false;
+// Built once; responses may carry extra fields without growing the document.
+static JsonDocument& api_response_filter(const ApiOp& op) {
+    static StaticJsonDocument<256> target;
+    static StaticJsonDocument<256> parts;
+    static StaticJsonDocument<64> complete;
+    static StaticJsonDocument<256> batch;
+    if (target.isNull()) {
+        add_target_fields(target.to<JsonVariant>());
+        parts["part_count"] = true;
+        JsonVariant part = parts["parts"][0];
+        part["part_number"] = true;
+        part["upload_host"] = true;
+        part["upload_port"] = true;
+        part["upload_path"] = true;
+        complete["object_key"] = true;
+        JsonVariant result = batch["results"][0];
+        result["index"] = true;
+        result["status"] = true;
+        add_target_fields(result);
+    }
+    if (op.batch) return batch;
+    switch (op.kind) {
+    case ApiOpKind::UploadParts:
+        return parts;
+    case ApiOpKind::CompleteParts:
+        return complete;
+    default:
+        break;
+    }
+    return target;
+}
+
+static void init_upload_buffers() {
+    api_request_doc();
+    api_response_doc();
+    for (UploadSlot& slot : upload_slots) {
+        if (!slot.arena.begin(UPLOAD_SLOT_ARENA_BYTES)) {
+            slot.arena.begin(1024);
+        }
+    }
+}
+
+// Serializes into api_request_body; returns 0 if the request does not fit.
+static size_t serialize_api_request(const JsonDocument& req) {
+    if (req.overflowed() || measureJson(req) >= sizeof(api_request_body)) return 0;
+    return serializeJson(req, api_request_body, sizeof(api_request_body));
+}
+
+static bool upload_in_flight(const ManifestIndexEntry& entry) {
+    for (const UploadSlot& slot : upload_slots) {
+        if (slot.state != UploadSlotState::Empty &&
+            slot.item.seq == entry.seq &&
+            static_cast<uint32_t>(slot.item.captured_epoch) == entry.captured_epoch) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool api_ensure() {
+    if (!api_endpoint_ok) {
+        api_endpoint_ok = parse_http_endpoint(API_BASE_URL, api_endpoint);
+        if (!api_endpoint_ok) {
+            Serial.println("API_BASE_URL not parseable");
+            return false;
+        }
+    }
+    return api_conn.ensure(api_endpoint.host, api_endpoint.port, api_endpoint.tls);
+}
+
+static bool api_post(const ApiOp& op, const char* path, const char* body, size_t body_len) {
+    if (api_ops_count >= UPLOAD_PIPELINE_DEPTH || body_len == 0) return false;
+    // Only reconnect between responses; a new socket would orphan the
+    // requests still waiting on the old one.
+    if (api_ops_count == 0 && !api_ensure()) return false;
+    if (!api_conn.connected()) return false;
+    char url[sizeof(api_endpoint.prefix) + 64];
+    int n = snprintf(url, sizeof(url), "%s%s", api_endpoint.prefix, path);
+    if (n <= 0 || static_cast<size_t>(n) >= sizeof(url)) return false;
+    if (!api_conn.send("POST", url, "application/json", kDeviceTokenHeader, body, body_len)) {
+        return false;
+    }
+    api_ops[(api_ops_head + api_ops_count) % UPLOAD_PIPELINE_DEPTH] = op;
+    api_ops_count++;
+    return true;
+}
+
+static void release_upload_slot(UploadSlot& slot) {
+    slot.state = UploadSlotState::Empty;
+    slot.host = "";
+    slot.path = "";
+    slot.object_key = "";
+    slot.arena.reset();
+}
 
-    WiFiClient* client = nullptr;
-    WiFiClientSecure tls_client;
-    WiFiClient plain_client;
+static void fail_upload_slot(UploadSlot& slot, const char* stage) {
+    Serial.printf("%s failed for seq %lu\n", stage, static_cast<unsigned long>(slot.item.seq));
+    if (slot.progressed) {
+        // Parts landed this attempt; give the attempt back so weak links
+        // converge instead of burning UPLOAD_MAX_ATTEMPTS on one big file.
+        update_manifest_status(slot.item, "PENDING", slot.attempts - 1, slot.attempt_epoch);
+    } else if (slot.attempts >= UPLOAD_MAX_ATTEMPTS) {
+        update_manifest_status(slot.item, "FAILED", slot.attempts, slot.attempt_epoch);
+    }
+    upload_stats.failures++;
+    release_upload_slot(slot);
+}
 
-    if (port == 443) {
-#if ALLOW_INSECURE_TLS
-        tls_client.setInsecure();
+static void fill_upload_url_fields(JsonObject req, const PendingItem& item) {
+    req["filename"] = item.filename();
+    req["content_type"] = item.content_type();
+    req["seq"] = item.seq;
+}
+
+// Before NTP, epochs are seconds since boot and cannot be compared across a
+// sync or a reboot.
+constexpr uint32_t kPlausibleEpoch = 1600000000UL;
+
+static void fill_ingest_fields(JsonObject req, const UploadSlot& slot) {
+    const PendingItem& item = slot.item;
+    req["object_key"] = slot.object_key;
+    req["seq"] = item.seq;
+    req["content_type"] = item.content_type();
+    // Thumbnails are ingested as photos; `tier` tells the server which one.
+    bool thumbnail = item.type == ManifestItemType::Thumbnail;
+    req["item_type"] = thumbnail ? "photo" : item.item_type();
+    if (thumbnail || item.linked) {
+        req["tier"] = thumbnail ? "thumbnail" : "full";
+    }
+    if (item.linked) {
+        req["linked_seq"] = item.linked_seq;
+    }
+    if (item.speech_confidence >= 0) {
+        req["speech_confidence"] = item.speech_confidence;
+    }
+    req["original_filename"] = item.filename();
+    req["ntp_synced"] = ntp_synced.load();
+    if (ntp_synced && item.captured_epoch > 0) {
+        struct tm timeinfo;
+        gmtime_r(&item.captured_epoch, &timeinfo);
+        char iso[32];
+        strftime(iso, sizeof(iso), "%Y-%m-%dT%H:%M:%SZ", &timeinfo);
+        req["captured_at"] = iso;
+    }
+#if PIPELINE_TIMING_ENABLED
+    // Stage durations rather than timestamps, so the server needs no
+    // agreement with the device clock: capture -> card (queue), card ->
+    // upload start (wait, whole seconds), upload start -> this ingest.
+    JsonObject timing = req.createNestedObject("timing");
+    if (item.timed) {
+        timing["queue_ms"] = item.timing.queue_ms;
+        uint32_t queued = item.timing.queued_epoch;
+        uint32_t started = static_cast<uint32_t>(slot.attempt_epoch);
+        if ((queued >= kPlausibleEpoch) == (started >= kPlausibleEpoch) && started >= queued) {
+            timing["wait_ms"] = (started - queued) * 1000ULL;
+        }
+    }
+    timing["upload_ms"] = static_cast<uint32_t>(millis() - slot.claim_ms);
+    timing["attempts"] = slot.attempts;
 #endif
-        tls_client.setTimeout(5000);
-        client = &tls_client;
+}
+
+static void fill_upload_parts_fields(JsonObject req, const UploadSlot& slot) {
+    req["seq"] = slot.item.seq;
+    req["content_type"] = slot.item.content_type();
+    req["size_bytes"] = slot.file_size;
+    req["part_size"] = UPLOAD_PART_BYTES;
+    req["first_part"] = slot.item.parts_done;
+}
+
+static void fill_complete_parts_fields(JsonObject req, const UploadSlot& slot) {
+    req["seq"] = slot.item.seq;
+    req["filename"] = slot.item.filename();
+    req["content_type"] = slot.item.content_type();
+    req["size_bytes"] = slot.file_size;
+    req["part_size"] = UPLOAD_PART_BYTES;
+}
+
+// Copies a non-empty response string into the slot's arena.
+static bool keep_slot_string(UploadSlot& slot, const char*& field, const char* value) {
+    if (!value || value[0] == 0) return false;
+    const char* copy = slot.arena.copy(value);
+    if (!copy) return false;
+    field = copy;
+    return true;
+}
+
+static bool read_upload_parts(JsonVariant resp, UploadSlot& slot) {
+    if ((resp["part_count"] | 0) != slot.part_count) return false;
+    slot.arena.reset();
+    uint16_t first = slot.item.parts_done;
+    uint16_t expected = first;
+    for (JsonVariant part : resp["parts"].as<JsonArray>()) {
+        if (expected >= slot.part_count || (part["part_number"] | -1) != expected) return false;
+        const char* host = part["upload_host"] | "";
+        uint16_t port = part["upload_port"] | 443;
+        if (expected == first) {
+            if (!keep_slot_string(slot, slot.host, host)) return false;
+            slot.port = port;
+        } else if (strcmp(host, slot.host) != 0 || port != slot.port) {
+            // All parts share store_conn; mixed hosts are not expected.
+            return false;
+        }
+        if (!keep_slot_string(slot, slot.part_paths[expected - first], part["upload_path"] | "")) {
+            return false;
+        }
+        expected++;
+    }
+    return expected == slot.part_count && expected > first;
+}
+
+static bool read_upload_target(JsonVariant resp, UploadSlot& slot) {
+    slot.arena.reset();
+    slot.port = resp["upload_port"] | 443;
+    return keep_slot_string(slot, slot.host, resp["upload_host"] | "") &&
+           keep_slot_string(slot, slot.path, resp["upload_path"] | "") &&
+           keep_slot_string(slot, slot.object_key, resp["object_key"] | "");
+}
+
+static const char* api_stage_name(ApiOpKind kind) {
+    switch (kind) {
+    case ApiOpKind::UploadUrl:
+        return "upload-url";
+    case ApiOpKind::UploadParts:
+        return "upload-parts";
+    case ApiOpKind::CompleteParts:
+        return "upload-complete";
+    case ApiOpKind::Telemetry:
+        return "telemetry";
+    case ApiOpKind::Ingest:
+        break;
+    }
+    return "ingest";
+}
+
+// Sends one request for the given slots: a batch request when the server
+// may support it, otherwise one pipelined request per slot.
+static void send_api_request(ApiOpKind kind, const uint8_t* slots, uint8_t count) {
+    const char* stage = api_stage_name(kind);
+    unsigned long now = millis();
+    for (uint8_t i = 0; i < count; i++) {
+        upload_slots[slots[i]].stage_start = now;
+    }
+
+    bool batchable = kind == ApiOpKind::UploadUrl || kind == ApiOpKind::Ingest;
+    if (batchable && count > 1 && api_batch_support != ApiBatchSupport::Unsupported) {
+        ApiOp op = {kind, true, count, {}};
+        PsramJsonDocument& req = api_request_doc();
+        req.clear();
+        JsonArray items = req.createNestedArray("items");
+        for (uint8_t i = 0; i < count; i++) {
+            const UploadSlot& slot = upload_slots[slots[i]];
+            op.slots[i] = slots[i];
+            if (kind == ApiOpKind::UploadUrl) {
+                fill_upload_url_fields(items.createNestedObject(), slot.item);
+            } else {
+                fill_ingest_fields(items.createNestedObject(), slot);
+            }
+        }
+        size_t body_len = serialize_api_request(req);
+        const char* path = kind == ApiOpKind::UploadUrl ? DEVICES_UPLOAD_URL_BATCH_PATH : DEVICES_INGEST_BATCH_PATH;
+        if (!api_post(op, path, api_request_body, body_len)) {
+            for (uint8_t i = 0; i < count; i++) {
+                fail_upload_slot(upload_slots[slots[i]], stage);
+            }
+        }
+        return;
+    }
+
+    for (uint8_t i = 0; i < count; i++) {
+        UploadSlot& slot = upload_slots[slots[i]];
+        ApiOp op = {kind, false, 1, {slots[i]}};
+        StaticJsonDocument<448> req;
+        const char* path = DEVICES_INGEST_PATH;
+        switch (kind) {
+        case ApiOpKind::UploadUrl:
+            fill_upload_url_fields(req.to<JsonObject>(), slot.item);
+            path = DEVICES_UPLOAD_URL_PATH;
+            break;
+        case ApiOpKind::UploadParts:
+            fill_upload_parts_fields(req.to<JsonObject>(), slot);
+            path = DEVICES_UPLOAD_PARTS_PATH;
+            break;
+        case ApiOpKind::CompleteParts:
+            fill_complete_parts_fields(req.to<JsonObject>(), slot);
+            path = DEVICES_UPLOAD_PARTS_COMPLETE_PATH;
+            break;
+        case ApiOpKind::Ingest:
+            fill_ingest_fields(req.to<JsonObject>(), slot);
+            break;
+        case ApiOpKind::Telemetry:
+            // Not a slot request; sent by send_telemetry/flush_telemetry_samples.
+            return;
+        }
+        size_t body_len = serialize_api_request(req);
+        if (!api_post(op, path, api_request_body, body_len)) {
+            fail_upload_slot(slot, stage);
+        }
+    }
+}
+
+// Claims the next pending item and records the attempt before any request.
+static bool claim_upload_slot(UploadSlot& slot) {
+    PendingItem item;
+    if (!find_next_pending(item, upload_in_flight)) return false;
+
+    slot.item = item;
+    slot.attempts = item.upload_attempts + 1;
+    slot.attempt_epoch = now_epoch();
+    slot.claim_ms = millis();
+    slot.target_ms = 0;
+    slot.put_ms = 0;
+    slot.bytes = 0;
+    slot.progressed = false;
+
+    File file = SD_MMC.open(item.filepath);
+    slot.file_size = file ? file.size() : 0;
+    if (file) file.close();
+    size_t parts = (slot.file_size + UPLOAD_PART_BYTES - 1) / UPLOAD_PART_BYTES;
+    slot.multipart = api_parts_support != ApiBatchSupport::Unsupported &&
+                     slot.arena.capacity() >= UPLOAD_SLOT_ARENA_BYTES &&
+                     slot.file_size >= UPLOAD_RESUMABLE_MIN_BYTES &&
+                     parts <= UPLOAD_MAX_PARTS;
+    slot.part_count = slot.multipart ? static_cast<uint16_t>(parts) : 0;
+    if (!slot.multipart || slot.item.parts_done > slot.part_count) {
+        slot.item.parts_done = 0;
+    }
+
+    update_manifest_status(slot.item, "PENDING", slot.attempts, slot.attempt_epoch);
+    if (slot.multipart && slot.item.parts_done == slot.part_count) {
+        // Every part landed but the complete call did not succeed; there is
+        // nothing left to sign, so retry only the assembly.
+        slot.arena.reset();
+        slot.state = UploadSlotState::NeedsComplete;
+        return true;
+    }
+    slot.state = UploadSlotState::AwaitTarget;
+    return true;
+}
+
+// PUTs `len` bytes of `file`, starting at its current position.
+static bool stream_range(File& file, const UploadSlot& slot, const char* path, size_t len) {
+    if (!store_conn.ensure(slot.host, slot.port, slot.port == 443)) {
+        return false;
+    }
+    if (!store_conn.begin("PUT", path, slot.item.content_type(), len)) {
+        return false;
+    }
+
+    bool sent = true;
+    if (sd_prefetch.ready() && sd_prefetch.start(file, len)) {
+        const uint8_t* data = nullptr;
+        size_t chunk_len = 0;
+        while (sd_prefetch.next(data, chunk_len)) {
+            if (!store_conn.write(data, chunk_len)) {
+                sent = false;
+                break;
+            }
+        }
+        sd_prefetch.finish();
+        sent = sent && !sd_prefetch.failed();
     } else {
-        plain_client.setTimeout(5000);
-        client = &plain_client;
+        size_t remaining = len;
+        while (remaining > 0) {
+            size_t want = remaining < sizeof(upload_buf) ? remaining : sizeof(upload_buf);
+            size_t got = file.read(upload_buf, want);
+            if (got == 0 || !store_conn.write(upload_buf, got)) {
+                sent = false;
+                break;
+            }
+            remaining -= got;
+        }
+    }
+    if (!sent) {
+        store_conn.stop();
+        return false;
     }
 
-    if (!client->connect(host.c_str(), port)) {
+    HttpResponse resp;
+    if (!store_conn.read_response(resp)) return false;
+    return resp.status >= 200 && resp.status < 300;
+}
+
+static bool stream_upload(UploadSlot& slot) {
+    PerfTimer timer(PerfOp::StreamUpload);
+    File file = SD_MMC.open(slot.item.filepath);
+    if (!file) return false;
+
+    if (!slot.multipart) {
+        bool ok = stream_range(file, slot, slot.path, file.size());
+        if (ok) slot.bytes = file.size();
         file.close();
-        return false;
+        return ok;
+    }
+
+    size_t first = slot.item.parts_done;
+    for (size_t part = first; part < slot.part_count; part++) {
+        size_t offset = part * UPLOAD_PART_BYTES;
+        size_t len = slot.file_size - offset < UPLOAD_PART_BYTES ? slot.file_size - offset : UPLOAD_PART_BYTES;
+        if (!file.seek(offset) || !stream_range(file, slot, slot.part_paths[part - first], len)) {
+            file.close();
+            return false;
+        }
+        slot.bytes += len;
+        slot.progressed = true;
+        slot.item.parts_done = static_cast<uint16_t>(part + 1);
+        update_manifest_status(slot.item, "PENDING", slot.attempts, slot.attempt_epoch);
+    }
+    file.close();
+    return true;
+}
+
+// Once the full frame is uploaded its thumbnail has nothing left to add;
+// drop it if it has not gone out yet.
+static void drop_superseded_thumbnail(const PendingItem& photo) {
+    ManifestLock lock;
+    if (!manifest_index_ready) return;
+    const ManifestIndexEntry* entry =
+        manifest_index.find(photo.linked_seq, static_cast<uint32_t>(photo.captured_epoch));
+    if (!entry || entry->item_type != ManifestItemType::Thumbnail ||
+        entry->status != ManifestStatus::Pending || upload_in_flight(*entry)) {
+        return;
+    }
+    PendingItem thumb;
+    if (!load_manifest(*entry, thumb)) return;
+    if (SD_MMC.exists(thumb.filepath)) {
+        SD_MMC.remove(thumb.filepath);
     }
+    remove_manifest(thumb);
+}
+
+static void finish_upload_slot(UploadSlot& slot) {
+    uint32_t ingest_ms = millis() - slot.stage_start;
+    slot.item.parts_done = 0;
+    update_manifest_status(slot.item, "UPLOADED", slot.attempts, slot.attempt_epoch);
+    if (slot.item.type == ManifestItemType::Photo && slot.item.linked) {
+        drop_superseded_thumbnail(slot.item);
+    }
+    upload_stats.items++;
+    upload_stats.bytes += slot.bytes;
+    upload_stats.target_ms += slot.target_ms;
+    upload_stats.put_ms += slot.put_ms;
+    upload_stats.ingest_ms += ingest_ms;
+    unsigned long put_rate = slot.put_ms > 0 ? static_cast<unsigned long>(slot.bytes * 1000ULL / slot.put_ms) : 0;
+    Serial.printf("Uploaded seq %lu (%lu bytes; url %lu ms, put %lu ms @ %lu B/s, ingest %lu ms)\n",
+                  static_cast<unsigned long>(slot.item.seq),
+                  static_cast<unsigned long>(slot.bytes),
+                  static_cast<unsigned long>(slot.target_ms),
+                  static_cast<unsigned long>(slot.put_ms),
+                  put_rate,
+                  static_cast<unsigned long>(ingest_ms));
+    release_upload_slot(slot);
+}
+
+// `doc` holds the filtered body of a 200 response, or is null if there was
+// none to parse or it did not parse.
+static void handle_single_response(const ApiOp& op, const HttpResponse* resp, JsonDocument* doc) {
+    UploadSlot& slot = upload_slots[op.slots[0]];
+    const char* stage = api_stage_name(op.kind);
+
+    if (op.kind == ApiOpKind::UploadParts && resp && (resp->status == 404 || resp->status == 405)) {
+        // Older server: upload this and later large files in one PUT.
+        Serial.println("Resumable uploads unavailable; using single PUT");
+        api_parts_support = ApiBatchSupport::Unsupported;
+        slot.multipart = false;
+        slot.item.parts_done = 0;
+        send_api_request(ApiOpKind::UploadUrl, op.slots, 1);
+        return;
+    }
+    if (op.kind == ApiOpKind::CompleteParts && resp && resp->status == 409) {
+        // Staged parts expired or went missing; start over from part 0.
+        slot.item.parts_done = 0;
+        slot.progressed = false;
+        update_manifest_status(slot.item, "PENDING", slot.attempts, slot.attempt_epoch);
+    }
+
+    if (!resp || resp->status != 200) {
+        if (resp) Serial.printf("%s failed: %d\n", stage, resp->status);
+        fail_upload_slot(slot, stage);
+        return;
+    }
+
+    if (op.kind == ApiOpKind::Ingest) {
+        finish_upload_slot(slot);
+        return;
+    }
+
+    bool ok = doc != nullptr;
+    switch (op.kind) {
+    case ApiOpKind::UploadParts:
+        api_parts_support = ApiBatchSupport::Supported;
+        ok = ok && read_upload_parts(doc->as<JsonVariant>(), slot);
+        break;
+    case ApiOpKind::CompleteParts:
+        ok = ok && keep_slot_string(slot, slot.object_key, (*doc)["object_key"] | "");
+        break;
+    default:
+        ok = ok && read_upload_target(doc->as<JsonVariant>(), slot);
+        break;
+    }
+    if (!ok) {
+        Serial.printf("%s JSON parse failed\n", stage);
+        fail_upload_slot(slot, stage);
+        return;
+    }
+
+    if (op.kind == ApiOpKind::CompleteParts) {
+        slot.state = UploadSlotState::Uploaded;
+        return;
+    }
+    slot.target_ms = millis() - slot.stage_start;
+    slot.state = UploadSlotState::Ready;
+}
+
+static void handle_batch_response(const ApiOp& op, const HttpResponse* resp, JsonDocument* doc) {
+    const char* stage = api_stage_name(op.kind);
+    if (resp && (resp->status == 404 || resp->status == 405)) {
+        // Older server: replay the same slots through the per-item endpoints.
+        Serial.println("Batch endpoints unavailable; using per-item requests");
+        api_batch_support = ApiBatchSupport::Unsupported;
+        send_api_request(op.kind, op.slots, op.count);
+        return;
+    }
+
+    bool ok = resp && resp->status == 200 && doc != nullptr;
+    if (!ok) {
+        if (resp) Serial.printf("%s batch failed: %d\n", stage, resp->status);
+        for (uint8_t i = 0; i < op.count; i++) {
+            fail_upload_slot(upload_slots[op.slots[i]], stage);
+        }
+        return;
+    }
+    api_batch_support = ApiBatchSupport::Supported;
+
+    bool answered[UPLOAD_API_BATCH_MAX] = {};
+    uint32_t elapsed = millis() - upload_slots[op.slots[0]].stage_start;
+    for (JsonVariant result : (*doc)["results"].as<JsonArray>()) {
+        int index = result["index"] | -1;
+        if (index < 0 || index >= op.count || answered[index]) continue;
+        answered[index] = true;
+        UploadSlot& slot = upload_slots[op.slots[index]];
+        const char* status = result["status"] | "";
+
+        if (op.kind == ApiOpKind::UploadUrl) {
+            if (strcmp(status, "ok") == 0 && read_upload_target(result, slot)) {
+                slot.target_ms = elapsed;
+                slot.state = UploadSlotState::Ready;
+            } else {
+                fail_upload_slot(slot, stage);
+            }
+        } else if (strcmp(status, "queued") == 0 || strcmp(status, "duplicate") == 0) {
+            finish_upload_slot(slot);
+        } else {
+            fail_upload_slot(slot, stage);
+        }
+    }
+    for (uint8_t i = 0; i < op.count; i++) {
+        if (!answered[i]) fail_upload_slot(upload_slots[op.slots[i]], stage);
+    }
+}
+
+static void handle_telemetry_response(const ApiOp& op, const HttpResponse* resp) {
+    bool ok = resp && resp->status >= 200 && resp->status < 300;
+    if (!ok && resp) Serial.printf("telemetry failed: %d\n", resp->status);
+    if (op.telemetry_end == op.telemetry_first) {
+        if (ok) {
+            last_perf_report = telemetry_perf_ms;
+        } else {
+            perf_restore(telemetry_perf);
+        }
+        return;
+    }
+    // Ack only contiguously: after a failed batch, later ones are resent too.
+    if (ok && static_cast<int32_t>(op.telemetry_first - telemetry_ring.first_seq()) <= 0) {
+        telemetry_ring.ack(op.telemetry_end);
+    }
+}
+
+static void handle_api_response(const ApiOp& op, const HttpResponse* resp, JsonDocument* doc = nullptr) {
+    if (op.kind == ApiOpKind::Telemetry) {
+        handle_telemetry_response(op, resp);
+    } else if (op.batch) {
+        handle_batch_response(op, resp, doc);
+    } else {
+        handle_single_response(op, resp, doc);
+    }
+}
+
+static ApiOp pop_api_op() {
+    ApiOp op = api_ops[api_ops_head];
+    api_ops_head = (api_ops_head + 1) % UPLOAD_PIPELINE_DEPTH;
+    api_ops_count--;
+    return op;
+}
+
+// Reads the oldest outstanding API response. On a broken connection every
+// outstanding request fails; the items stay PENDING and back off as usual.
+static void read_api_response() {
+    ApiOp op = pop_api_op();
+    HttpResponse resp;
+    bool ok = api_conn.read_head(resp);
+    JsonDocument* doc = nullptr;
+    if (ok) {
+        bool wants_body = op.batch || (op.kind != ApiOpKind::Ingest && op.kind != ApiOpKind::Telemetry);
+        if (resp.status == 200 && wants_body) {
+            PsramJsonDocument& parsed = api_response_doc();
+            DeserializationError err = deserializeJson(parsed, api_conn.body(),
+                                                       DeserializationOption::Filter(api_response_filter(op)));
+            if (err == DeserializationError::Ok) {
+                doc = &parsed;
+            } else {
+                Serial.printf("%s response: %s\n", api_stage_name(op.kind), err.c_str());
+            }
+        }
+        ok = api_conn.finish_response();
+    }
+
+    if (!ok || !api_conn.connected()) {
+        // Whatever was pipelined behind this response will never be answered.
+        // Drop those ops first so a per-item retry below starts a new socket.
+        size_t lost_count = api_ops_count;
+        ApiOp lost[UPLOAD_PIPELINE_DEPTH];
+        for (size_t i = 0; i < lost_count; i++) {
+            lost[i] = pop_api_op();
+        }
+        handle_api_response(op, ok ? &resp : nullptr, ok ? doc : nullptr);
+        for (size_t i = 0; i < lost_count; i++) {
+            handle_api_response(lost[i], nullptr);
+        }
+        return;
+    }
+    handle_api_response(op, &resp, doc);
+}
+
+// Hourly summary report. Like the sample batches it goes out on the API
+// connection, so it costs no extra TLS handshake. Returns false if it could
+// not be posted now and should stay due.
+static bool send_telemetry() {
+    if (strlen(DEVICE_TOKEN) == 0) return true;
+    if (!wifi_ok || api_ops_count > 0) return false;
+    PowerGuard busy(PowerLockKind::CpuMax);
 
-    client->println("PUT " + path + " HTTP/1.1");
-    client->println("Host: " + host);
-    client->println("Content-Type: " + item.content_type);
-    client->println("Content-Length: " + String(file.size()));
-    client->println("Connection: close");
-    client->println();
+    uint64_t used = sd_used_bytes();
+    uint64_t total = manifest_index_ready ? sd_total_bytes : SD_MMC.totalBytes();
+    uint64_t free_bytes = total > used ? (total - used) : 0;
 
-    while (file.available()) {
-        size_t len = file.read(upload_buf, sizeof(upload_buf));
-        if (client->write(upload_buf, len) != len) {
-            file.close();
-            client->stop();
-            return false;
+    PsramJsonDocument& payload = api_request_doc();
+    payload.clear();
+    payload["uptime_seconds"] = millis() / 1000;
+    payload["sd_used_mb"] = static_cast<int>(used / (1024 * 1024));
+    payload["sd_free_mb"] = static_cast<int>(free_bytes / (1024 * 1024));
+    payload["backlog_count"] = count_pending_manifests();
+    payload["wifi_rssi"] = WiFi.RSSI();
+    payload["firmware_version"] = FIRMWARE_VERSION;
+    payload["backlog_bytes"] = pending_backlog_bytes();
+#if AUDIO_ENABLED
+    if (audio_ok) payload["vad_start_mult"] = vad_start_mult.load();
+#endif
+    if (WIFI_DUTY_CYCLE_ENABLED && wifi_scheduler.windows() > 0) {
+        const WifiWindowStats& window = wifi_scheduler.last_window();
+        JsonObject stats = payload.createNestedObject("wifi_window");
+        stats["connect_ms"] = window.connect_ms;
+        stats["duration_ms"] = window.duration_ms;
+        stats["busy_ms"] = window.busy_ms;
+        stats["planned_ms"] = window.planned_ms;
+        stats["bytes"] = window.bytes;
+        stats["items"] = window.items;
+        stats["throughput_bps"] = window.throughput_bps;
+        stats["rssi"] = window.rssi;
+        stats["close_reason"] = wifi_close_reason_name(window.reason);
+        stats["ewma_bps"] = wifi_scheduler.throughput_bps();
+        stats["windows"] = wifi_scheduler.windows();
+    }
+    JsonObject boot = payload.createNestedObject("boot");
+    boot["reset_reason"] = reset_reason_name(esp_reset_reason());
+    boot["fast"] = BOOT_FAST_ENABLED != 0;
+    boot["audio_ms"] = boot_timings.audio_ms;
+    boot["camera_ms"] = boot_timings.camera_ms;
+    boot["sd_ms"] = boot_timings.sd_ms;
+    boot["first_frame_ms"] = boot_timings.first_frame_ms.load();
+    boot["setup_ms"] = boot_timings.setup_ms;
+    boot["index_ms"] = boot_timings.index_ms.load();
+    JsonObject connect = payload.createNestedObject("wifi_connect");
+    JsonArray fast = connect.createNestedArray("fast_hist");
+    JsonArray full = connect.createNestedArray("scan_hist");
+    for (size_t i = 0; i < kWifiConnectBuckets; i++) {
+        fast.add(wifi_connect_stats.hist[0][i]);
+        full.add(wifi_connect_stats.hist[1][i]);
+    }
+    connect["fast_misses"] = wifi_connect_stats.fast_misses;
+    connect["failures"] = wifi_connect_stats.failures;
+
+    // Counters since the last accepted report; ops are
+    // [count, total_us, max_us, hist...] and idle ops are left out.
+    PerfSnapshot& perf = telemetry_perf;
+    perf_take(perf);
+    telemetry_perf_ms = millis();
+    JsonObject perf_json = payload.createNestedObject("perf");
+    perf_json["interval_ms"] = telemetry_perf_ms - last_perf_report;
+    JsonObject ops = perf_json.createNestedObject("ops");
+    for (size_t op = 0; op < kPerfOpCount; op++) {
+        const PerfOpStats& stats = perf.ops[op];
+        if (stats.count == 0) continue;
+        JsonArray row = ops.createNestedArray(perf_op_name(static_cast<PerfOp>(op)));
+        row.add(stats.count);
+        row.add(stats.total_us);
+        row.add(stats.max_us);
+        for (size_t b = 0; b < kPerfBuckets; b++) {
+            row.add(stats.hist[b]);
         }
     }
+    JsonObject events = perf_json.createNestedObject("events");
+    for (size_t event = 0; event < kPerfEventCount; event++) {
+        events[perf_event_name(static_cast<PerfEvent>(event))] = perf.events[event];
+    }
+    perf_json["heap_free"] = ESP.getFreeHeap();
+    perf_json["heap_min"] = ESP.getMinFreeHeap();
+    perf_json["heap_max_alloc"] = ESP.getMaxAllocHeap();
+    if (psramFound()) {
+        perf_json["psram_free"] = ESP.getFreePsram();
+        perf_json["psram_min"] = ESP.getMinFreePsram();
+    }
 
-    file.close();
-    int status_code = read_http_status_code(*client);
-    client->stop();
-    return status_code >= 200 && status_code < 300;
-}
-
-static bool request_upload_target(const PendingItem& item, String& host, uint16_t& port, String& path, String& object_key) {
-    if (strlen(DEVICE_TOKEN) == 0) {
-        Serial.println("DEVICE_TOKEN not set");
+    size_t body_len = serialize_api_request(payload);
+    if (body_len == 0) {
+        // Retrying would not make it fit; the counters roll into the next one.
+        Serial.println("Telemetry report does not fit; skipped");
+        perf_restore(perf);
+        return true;
+    }
+    ApiOp op = {ApiOpKind::Telemetry, false, 0, {}};
+    if (!api_post(op, DEVICES_TELEMETRY_PATH, api_request_body, body_len)) {
+        perf_restore(perf);
         return false;
     }
+    while (api_ops_count > 0) {
+        read_api_response();
+    }
+    return true;
+}
 
-    HTTPClient http;
-    String url = String(API_BASE_URL) + DEVICES_UPLOAD_URL_PATH;
-    http.begin(url);
-    http.addHeader("X-Device-Token", DEVICE_TOKEN);
-    http.addHeader("Content-Type", "application/json");
-
-    StaticJsonDocument<128> req;
-    req["filename"] = item.filepath.substring(item.filepath.lastIndexOf('/') + 1);
-    req["content_type"] = item.content_type;
-    req["seq"] = item.seq;
-    String body;
-    serializeJson(req, body);
+static void record_telemetry_sample(unsigned long now) {
+    last_telemetry_sample = now;
+    TelemetrySample sample = {};
+    sample.uptime_s = now / 1000;
+    sample.epoch = ntp_synced ? static_cast<uint32_t>(now_epoch()) : 0;
+    if (manifest_index_ready) {
+        uint64_t used = sd_used_bytes();
+        uint64_t free_bytes = sd_total_bytes > used ? sd_total_bytes - used : 0;
+        sample.backlog_count = static_cast<uint32_t>(count_pending_manifests());
+        sample.backlog_kb = static_cast<uint32_t>(pending_backlog_bytes() / 1024);
+        sample.sd_free_mb = static_cast<uint32_t>(free_bytes / (1024 * 1024));
+    }
+    uint32_t heap_kb = ESP.getFreeHeap() / 1024;
+    sample.heap_free_kb = static_cast<uint16_t>(heap_kb > 0xFFFF ? 0xFFFF : heap_kb);
+    if (wifi_ok) {
+        int rssi = WiFi.RSSI();
+        sample.rssi = static_cast<int8_t>(rssi < -128 ? -128 : (rssi > 0 ? 0 : rssi));
+        sample.flags |= kTelemetryWifiOn;
+    }
+    if (audio_recording) sample.flags |= kTelemetryRecording;
+    if (capture_paused) sample.flags |= kTelemetryCapturePaused;
+    if (retention_active) sample.flags |= kTelemetryRetention;
+    telemetry_ring.push(sample);
+}
 
-    int http_code = http.POST(body);
-    if (http_code != 200) {
-        Serial.printf("upload-url failed: %d\n", http_code);
-        http.end();
-        return false;
+// Serializes up to `count` samples from ring offset `offset` as one compact
+// report: field names once, then one integer row per sample. Returns the
+// body length, or 0 if even one row does not fit.
+static size_t build_telemetry_samples(size_t offset, size_t& count) {
+    PsramJsonDocument& req = api_request_doc();
+    while (count > 0) {
+        req.clear();
+        req["uptime_seconds"] = millis() / 1000;
+        JsonObject samples = req.createNestedObject("samples");
+        samples["first_seq"] = telemetry_ring.first_seq() + offset;
+        samples["dropped"] = telemetry_ring.dropped();
+        JsonArray fields = samples.createNestedArray("fields");
+        for (const char* name : {"uptime_s", "epoch", "backlog_count", "backlog_kb", "sd_free_mb", "heap_free_kb",
+                                 "rssi", "flags"}) {
+            fields.add(name);
+        }
+        JsonArray rows = samples.createNestedArray("rows");
+        for (size_t i = 0; i < count; i++) {
+            const TelemetrySample& sample = telemetry_ring.at(offset + i);
+            JsonArray row = rows.createNestedArray();
+            row.add(sample.uptime_s);
+            row.add(sample.epoch);
+            row.add(sample.backlog_count);
+            row.add(sample.backlog_kb);
+            row.add(sample.sd_free_mb);
+            row.add(sample.heap_free_kb);
+            row.add(sample.rssi);
+            row.add(sample.flags);
+        }
+        size_t body_len = serialize_api_request(req);
+        if (body_len > 0) return body_len;
+        count /= 2;
     }
+    return 0;
+}
 
-    StaticJsonDocument<512> resp;
-    DeserializationError err = deserializeJson(resp, http.getString());
-    http.end();
-    if (err != DeserializationError::Ok) {
-        Serial.println("upload-url JSON parse failed");
-        return false;
+// Uploads the ring on the API connection: every batch that fits the
+// pipeline is written back to back, then the responses are read in order.
+static void flush_telemetry_samples() {
+    if (!wifi_ok || strlen(DEVICE_TOKEN) == 0 || api_ops_count > 0) return;
+    PowerGuard busy(PowerLockKind::CpuMax);
+    last_telemetry_flush = millis();
+
+    size_t offset = 0;
+    while (offset < telemetry_ring.size() && api_ops_count < UPLOAD_PIPELINE_DEPTH) {
+        size_t remaining = telemetry_ring.size() - offset;
+        size_t count = remaining < TELEMETRY_BATCH_SAMPLES ? remaining : TELEMETRY_BATCH_SAMPLES;
+        size_t body_len = build_telemetry_samples(offset, count);
+        ApiOp op = {ApiOpKind::Telemetry, false, 0, {}};
+        op.telemetry_first = telemetry_ring.first_seq() + static_cast<uint32_t>(offset);
+        op.telemetry_end = op.telemetry_first + static_cast<uint32_t>(count);
+        if (body_len == 0 || !api_post(op, DEVICES_TELEMETRY_PATH, api_request_body, body_len)) break;
+        offset += count;
+    }
+    while (api_ops_count > 0) {
+        read_api_response();
     }
-
-    host = resp["upload_host"].as<String>();
-    port = resp["upload_port"] | 443;
-    path = resp["upload_path"].as<String>();
-    object_key = resp["object_key"].as<String>();
-    return !(host.isEmpty() || path.isEmpty() || object_key.isEmpty());
 }
 
-static bool notify_ingest(const PendingItem& item, const String& object_key) {
-    HTTPClient http;
-    String url = String(API_BASE_URL) + DEVICES_INGEST_PATH;
-    http.begin(url);
-    http.addHeader("X-Device-Token", DEVICE_TOKEN);
-    http.addHeader("Content-Type", "application/json");
 
-    StaticJsonDocument<384> req;
-    req["object_key"] = object_key;
-    req["seq"] = item.seq;
-    req["content_type"] = item.content_type;
-    req["item_type"] = item.item_type;
-    req["original_filename"] = item.filepath.substring(item.filepath.lastIndexOf('/') + 1);
-    req["ntp_synced"] = ntp_synced;
-    if (ntp_synced && item.captured_epoch > 0) {
-        struct tm timeinfo;
-        gmtime_r(&item.captured_epoch, &timeinfo);
-        char iso[32];
-        strftime(iso, sizeof(iso), "%Y-%m-%dT%H:%M:%SZ", &timeinfo);
-        req["captured_at"] = iso;
+static UploadSlot* oldest_ready_slot() {
+    UploadSlot* best = nullptr;
+    for (UploadSlot& slot : upload_slots) {
+        if (slot.state != UploadSlotState::Ready) continue;
+        if (!best || slot.stage_start < best->stage_start) best = &slot;
     }
+    return best;
+}
 
-    String body;
-    serializeJson(req, body);
-    int http_code = http.POST(body);
-    String response = http.getString();
-    http.end();
-
-    if (http_code == 200) {
-        if (response.indexOf("\"duplicate\"") >= 0) {
-            return true;
-        }
-        return true;
+// Collects up to UPLOAD_API_BATCH_MAX slot indices in `state`.
+static uint8_t collect_slots(UploadSlotState state, uint8_t* out) {
+    uint8_t count = 0;
+    for (size_t i = 0; i < UPLOAD_PIPELINE_DEPTH && count < UPLOAD_API_BATCH_MAX; i++) {
+        if (upload_slots[i].state == state) out[count++] = static_cast<uint8_t>(i);
     }
-    Serial.printf("ingest failed: %d\n", http_code);
-    return false;
+    return count;
 }
 
-static void update_manifest_status(const PendingItem& item, const char* status, int attempts, time_t last_attempt_epoch) {
-    write_manifest_atomic(
-        item.seq,
-        item.filepath,
-        item.captured_epoch,
-        status,
-        item.item_type.c_str(),
-        item.content_type.c_str(),
-        attempts,
-        last_attempt_epoch
-    );
+// Thumbnails go first while the pending backlog needs more than
+// UPLOAD_TIER_HORIZON_SEC of radio time at the measured throughput; full
+// frames take over again once it fits in half of that.
+static void update_upload_tiering() {
+#if CAPTURE_THUMBNAIL_ENABLED
+    uint64_t budget = static_cast<uint64_t>(wifi_scheduler.throughput_bps()) * UPLOAD_TIER_HORIZON_SEC;
+    uint64_t backlog = pending_backlog_bytes();
+    bool thumbnails_first = upload_thumbnails_first ? backlog > budget / 2 : backlog > budget;
+    if (thumbnails_first != upload_thumbnails_first) {
+        upload_thumbnails_first = thumbnails_first;
+        Serial.printf("Upload tier: %s first (backlog %llu bytes, budget %llu bytes)\n",
+                      thumbnails_first ? "thumbnails" : "full frames",
+                      static_cast<unsigned long long>(backlog),
+                      static_cast<unsigned long long>(budget));
+    }
+#endif
 }
 
-static bool upload_one_pending() {
+// Returns true when the whole batch went through or the slice ran out with
+// work left, i.e. the backlog is draining and the next slice can start
+// without waiting for the interval.
+static bool upload_batch() {
     if (!sd_ok || !wifi_ok) return false;
-
-    PendingItem item;
-    if (!find_oldest_pending(item)) {
+    if (strlen(DEVICE_TOKEN) == 0) {
+        Serial.println("DEVICE_TOKEN not set");
         return false;
     }
+    PowerGuard busy(PowerLockKind::CpuMax);
+    update_upload_tiering();
+
+    unsigned long batch_start = millis();
+    uint32_t items_before = upload_stats.items;
+    uint32_t failures_before = upload_stats.failures;
+    int started = 0;
+    bool source_empty = false;
+    bool sliced = false;
+
+    while (true) {
+        // Past the slice deadline, drain what is in flight but start nothing new.
+        if (!sliced && millis() - batch_start >= UPLOAD_SLICE_MS) sliced = true;
+
+        // Keep the pipeline full: claim free slots and request their targets.
+        if (!source_empty && !sliced && started < UPLOAD_BATCH_SIZE && api_ops_count < UPLOAD_PIPELINE_DEPTH) {
+            uint8_t claimed[UPLOAD_API_BATCH_MAX];
+            uint8_t count = 0;
+            for (size_t i = 0; i < UPLOAD_PIPELINE_DEPTH && count < UPLOAD_API_BATCH_MAX && started < UPLOAD_BATCH_SIZE; i++) {
+                if (upload_slots[i].state != UploadSlotState::Empty) continue;
+                if (!claim_upload_slot(upload_slots[i])) {
+                    source_empty = true;
+                    break;
+                }
+                claimed[count++] = static_cast<uint8_t>(i);
+                started++;
+            }
+            if (count > 0) {
+                uint8_t single[UPLOAD_API_BATCH_MAX];
+                uint8_t single_count = 0;
+                for (uint8_t i = 0; i < count; i++) {
+                    if (upload_slots[claimed[i]].state != UploadSlotState::AwaitTarget) continue;
+                    if (upload_slots[claimed[i]].multipart) {
+                        send_api_request(ApiOpKind::UploadParts, &claimed[i], 1);
+                    } else {
+                        single[single_count++] = claimed[i];
+                    }
+                }
+                if (single_count > 0) {
+                    send_api_request(ApiOpKind::UploadUrl, single, single_count);
+                }
+                continue;
+            }
+        }
 
-    time_t attempt_epoch = now_epoch();
-    update_manifest_status(item, "PENDING", item.upload_attempts + 1, attempt_epoch);
-
-    String host, path, object_key;
-    uint16_t port = 443;
-    if (!request_upload_target(item, host, port, path, object_key)) {
-        if (item.upload_attempts + 1 >= UPLOAD_MAX_ATTEMPTS) {
-            update_manifest_status(item, "FAILED", item.upload_attempts + 1, attempt_epoch);
-        } else {
-            update_manifest_status(item, "PENDING", item.upload_attempts + 1, attempt_epoch);
+        UploadSlot* ready = oldest_ready_slot();
+        if (ready) {
+            unsigned long put_start = millis();
+            if (!stream_upload(*ready)) {
+                fail_upload_slot(*ready, "upload");
+                continue;
+            }
+            ready->put_ms = millis() - put_start;
+            ready->state = ready->multipart ? UploadSlotState::NeedsComplete : UploadSlotState::Uploaded;
+            continue;
         }
-        return false;
-    }
 
-    if (!stream_upload(item, host, port, path)) {
-        if (item.upload_attempts + 1 >= UPLOAD_MAX_ATTEMPTS) {
-            update_manifest_status(item, "FAILED", item.upload_attempts + 1, attempt_epoch);
-        } else {
-            update_manifest_status(item, "PENDING", item.upload_attempts + 1, attempt_epoch);
+        uint8_t assemble[UPLOAD_API_BATCH_MAX];
+        uint8_t assemble_count = collect_slots(UploadSlotState::NeedsComplete, assemble);
+        if (assemble_count > 0) {
+            for (uint8_t i = 0; i < assemble_count; i++) {
+                upload_slots[assemble[i]].state = UploadSlotState::AwaitComplete;
+            }
+            send_api_request(ApiOpKind::CompleteParts, assemble, assemble_count);
+            continue;
         }
-        return false;
-    }
 
-    if (!notify_ingest(item, object_key)) {
-        if (item.upload_attempts + 1 >= UPLOAD_MAX_ATTEMPTS) {
-            update_manifest_status(item, "FAILED", item.upload_attempts + 1, attempt_epoch);
-        } else {
-            update_manifest_status(item, "PENDING", item.upload_attempts + 1, attempt_epoch);
+        // Nothing left to stream right now: acknowledge everything uploaded.
+        uint8_t uploaded[UPLOAD_API_BATCH_MAX];
+        uint8_t uploaded_count = collect_slots(UploadSlotState::Uploaded, uploaded);
+        if (uploaded_count > 0) {
+            for (uint8_t i = 0; i < uploaded_count; i++) {
+                upload_slots[uploaded[i]].state = UploadSlotState::AwaitIngest;
+            }
+            send_api_request(ApiOpKind::Ingest, uploaded, uploaded_count);
+            continue;
         }
-        return false;
-    }
 
-    update_manifest_status(item, "UPLOADED", item.upload_attempts + 1, attempt_epoch);
-    Serial.printf("Uploaded seq %lu\n", static_cast<unsigned long>(item.seq));
-    return true;
+        if (api_ops_count > 0) {
+            read_api_response();
+            continue;
+        }
+        break;
+    }
+
+    uint32_t uploaded = upload_stats.items - items_before;
+    uint32_t failed = upload_stats.failures - failures_before;
+    if (uploaded > 0 || failed > 0) {
+        unsigned long put_rate = upload_stats.put_ms > 0
+            ? static_cast<unsigned long>(upload_stats.bytes * 1000ULL / upload_stats.put_ms)
+            : 0;
+        Serial.printf("Upload batch: %lu ok, %lu failed in %lu ms%s (put avg %lu B/s, api connects %lu, reuses %lu)\n",
+                      static_cast<unsigned long>(uploaded),
+                      static_cast<unsigned long>(failed),
+                      static_cast<unsigned long>(millis() - batch_start),
+                      sliced ? ", sliced" : "",
+                      put_rate,
+                      static_cast<unsigned long>(api_conn.connects()),
+                      static_cast<unsigned long>(api_conn.reuses()));
+    }
+    return (started == UPLOAD_BATCH_SIZE || (sliced && !source_empty)) && failed == 0;
 }
 
-static void upload_batch() {
-    for (int i = 0; i < UPLOAD_BATCH_SIZE; i++) {
-        if (!upload_one_pending()) {
-            break;
-        }
-        delay(10);
-    }
+#if CAPTURE_THUMBNAIL_ENABLED
+struct ThumbnailSink {
+    File* file;
+    size_t bytes;
+};
+
+static size_t write_thumbnail_chunk(void* arg, size_t, const void* data, size_t len) {
+    ThumbnailSink* sink = static_cast<ThumbnailSink*>(arg);
+    size_t written = sink->file->write(static_cast<const uint8_t*>(data), len);
+    sink->bytes += written;
+    return written;
 }
 
-static bool capture_and_save() {
-    if (!sd_ok || !camera_ok) return false;
-    if (capture_paused) return false;
+// 1/4-scale RGB565 decode of the frame, kept until encode_thumbnail() runs so
+// the camera buffer can be returned in between.
+struct ThumbnailPixels {
+    uint8_t* rgb = nullptr;
+    size_t bytes = 0;
+    uint16_t width = 0;
+    uint16_t height = 0;
+};
 
-    camera_fb_t *fb = esp_camera_fb_get();
-    if (!fb) {
-        Serial.println("Camera capture failed");
-        return false;
+static bool decode_thumbnail(const camera_fb_t* fb, ThumbnailPixels& out) {
+    static uint8_t* pixels = nullptr;
+    static size_t pixels_bytes = 0;
+    size_t width = fb->width / 4;
+    size_t height = fb->height / 4;
+    size_t bytes = width * height * 2;
+    if (bytes == 0) return false;
+    if (bytes > pixels_bytes) {
+        free(pixels);
+        pixels = PsramAllocator<uint8_t>::try_allocate(bytes);
+        pixels_bytes = pixels ? bytes : 0;
+        if (!pixels) return false;
+    }
+    PowerGuard busy(PowerLockKind::CpuMax);
+    if (!jpg2rgb565(fb->buf, fb->len, pixels, JPG_SCALE_4X)) return false;
+    out.rgb = pixels;
+    out.bytes = bytes;
+    out.width = static_cast<uint16_t>(width);
+    out.height = static_cast<uint16_t>(height);
+    return true;
+}
+
+// Re-encodes the decode next to the photo as <stem>_t.jpg. Returns the
+// thumbnail size, or 0 if it was not written.
+static uint32_t encode_thumbnail(const ThumbnailPixels& pixels, const char* photo_path,
+                                 char* out, size_t cap) {
+    const char* ext = strrchr(photo_path, '.');
+    size_t stem_len = ext ? static_cast<size_t>(ext - photo_path) : strlen(photo_path);
+    int n = snprintf(out, cap, "%.*s_t.jpg", static_cast<int>(stem_len), photo_path);
+    if (n < 0 || static_cast<size_t>(n) >= cap) return 0;
+
+    File file = SD_MMC.open(out, FILE_WRITE);
+    if (!file) return 0;
+    ThumbnailSink sink{&file, 0};
+    bool ok;
+    {
+        PowerGuard busy(PowerLockKind::CpuMax);
+        ok = fmt2jpg_cb(pixels.rgb, pixels.bytes, pixels.width, pixels.height, PIXFORMAT_RGB565,
+                        CAPTURE_THUMBNAIL_QUALITY, write_thumbnail_chunk, &sink);
+    }
+    file.close();
+    if (!ok || sink.bytes == 0) {
+        SD_MMC.remove(out);
+        return 0;
     }
+    return static_cast<uint32_t>(sink.bytes);
+}
+#endif
 
+static bool save_photo(const PhotoFrame& frame) {
+    PerfTimer timer(PerfOp::PhotoSave);
+    camera_fb_t* fb = frame.fb;
     uint32_t seq = get_next_seq();
-    String folder = build_date_folder();
-    if (!SD_MMC.exists(folder.c_str())) {
-        SD_MMC.mkdir(folder.c_str());
+    char folder[16];
+    build_date_folder(folder, sizeof(folder));
+    if (!SD_MMC.exists(folder)) {
+        SD_MMC.mkdir(folder);
     }
 
-    String filepath = folder + build_filename(seq);
-    File file = SD_MMC.open(filepath.c_str(), FILE_WRITE);
+    char filepath[sizeof(ManifestRecord::filepath)];
+    if (!build_filename(filepath, sizeof(filepath), folder, seq)) {
+        esp_camera_fb_return(fb);
+        return false;
+    }
+    File file = SD_MMC.open(filepath, FILE_WRITE);
     if (!file) {
         Serial.println("Failed to open file on SD");
         esp_camera_fb_return(fb);
         return false;
     }
 
-    size_t written = file.write(fb->buf, fb->len);
+    size_t len = fb->len;
+    size_t written = file.write(fb->buf, len);
     file.close();
+#if CAPTURE_THUMBNAIL_ENABLED
+    ThumbnailPixels thumb_pixels;
+    bool thumb_decoded = written == len && decode_thumbnail(fb, thumb_pixels);
+#endif
     esp_camera_fb_return(fb);
 
-    if (written != fb->len) {
+    if (written != len) {
         Serial.println("Short write to SD");
         return false;
     }
 
-    time_t captured_epoch = now_epoch();
-    write_manifest_atomic(seq, filepath, captured_epoch, "PENDING", "photo", "image/jpeg", 0, 0);
+    const uint32_t* link = nullptr;
+#if CAPTURE_THUMBNAIL_ENABLED
+    // The thumbnail's record goes first so a linked photo never points at a
+    // seq the manifest has not seen.
+    uint32_t thumb_seq = 0;
+    char thumb_path[sizeof(ManifestRecord::filepath)];
+    uint32_t thumb_bytes = thumb_decoded
+        ? encode_thumbnail(thumb_pixels, filepath, thumb_path, sizeof(thumb_path))
+        : 0;
+    ManifestTiming thumb_timing = manifest_timing_since(frame.grabbed_ms);
+    if (thumb_bytes > 0) {
+        thumb_seq = get_next_seq();
+        if (write_manifest_atomic(thumb_seq, thumb_path, frame.captured_epoch, "PENDING", "thumbnail", 0, 0, 0,
+                                  thumb_bytes, &seq, -1, &thumb_timing)) {
+            link = &thumb_seq;
+        } else {
+            SD_MMC.remove(thumb_path);
+        }
+    }
+#endif
+
+    ManifestTiming timing = manifest_timing_since(frame.grabbed_ms);
+    if (!write_manifest_atomic(seq, filepath, frame.captured_epoch, "PENDING", "photo", 0, 0, 0,
+                               static_cast<uint32_t>(written), link, -1, &timing)) {
+        Serial.printf("Failed to write manifest for %s\n", filepath);
+        SD_MMC.remove(filepath);
+#if CAPTURE_THUMBNAIL_ENABLED
+        // The photo's seq will never exist; keep the thumbnail as a
+        // standalone capture rather than linked to nothing.
+        if (link) {
+            write_manifest_atomic(thumb_seq, thumb_path, frame.captured_epoch, "PENDING", "thumbnail", 0, 0, 0,
+                                  thumb_bytes, nullptr, -1, &thumb_timing);
+        }
+#endif
+        return false;
+    }
 
-    Serial.printf("Saved %s (%d bytes)\n", filepath.c_str(), (int)written);
+    Serial.printf("Saved %s (%d bytes)\n", filepath, (int)written);
 #if AUDIO_ENABLED
     if (audio_ok && AUDIO_PHOTO_CLIP_ENABLED && !audio_recording) {
+        audio_photo_clip_epoch = frame.captured_epoch;
         audio_photo_clip_pending = true;
-        audio_photo_clip_epoch = captured_epoch;
     }
 #endif
     return true;
 }
 
-void setup() {
-    Serial.begin(115200);
-    delay(1000);
-    Serial.println("\n[ESP32] Day 6: photo + audio -> SD + upload");
+static bool grab_photo(PhotoFrame& frame) {
+    frame.fb = esp_camera_fb_get();
+    if (!frame.fb) {
+        Serial.println("Camera capture failed");
+        return false;
+    }
+    frame.captured_epoch = now_epoch();
+    frame.grabbed_ms = millis();
+    if (boot_timings.first_frame_ms == 0) boot_timings.first_frame_ms = millis();
+    return true;
+}
 
-    init_camera_config();
+#if CAPTURE_DEDUP_ENABLED
+// Hashes a 1/8-scale decode of the JPEG. Returns false if the decode fails;
+// callers then treat the frame as changed.
+static bool hash_photo(const camera_fb_t* fb, uint64_t& hash) {
+    static uint8_t* probe = nullptr;
+    static size_t probe_bytes = 0;
+    size_t width = fb->width / 8;
+    size_t height = fb->height / 8;
+    size_t bytes = width * height * 2;
+    if (bytes == 0) return false;
+    if (bytes > probe_bytes) {
+        free(probe);
+        probe = PsramAllocator<uint8_t>::try_allocate(bytes);
+        probe_bytes = probe ? bytes : 0;
+        if (!probe) return false;
+    }
+    PowerGuard busy(PowerLockKind::CpuMax);
+    if (!jpg2rgb565(fb->buf, fb->len, probe, JPG_SCALE_8X)) return false;
+    hash = frame_dhash_rgb565(probe, width, height);
+    return true;
+}
+#endif
 
-    if (!psramFound()) {
-        Serial.println("PSRAM not found, lowering frame size.");
-        camera_config.frame_size = FRAMESIZE_VGA;
-        camera_config.fb_count = 1;
-        camera_config.fb_location = CAMERA_FB_IN_DRAM;
+static void queue_photo(PhotoFrame& frame) {
+    if (xQueueSend(photo_queue, &frame, 0) != pdTRUE) {
+        esp_camera_fb_return(frame.fb);
+        perf_count(PerfEvent::PhotoDropped);
+        Serial.println("Photo writer busy; frame dropped");
     }
+}
 
-    prefs.begin("lifelog", false);
+// Grabs a frame per capture request and queues it for the writer. If the
+// writer still holds every spare buffer the frame is dropped rather than
+// stalling the camera.
+//
+// With CAPTURE_DEDUP_ENABLED the task also wakes every
+// CAPTURE_PROBE_INTERVAL_MS to probe the scene:
+// - Scheduled frames are kept only if the scene changed since the last
+//   saved photo, or that photo is older than CAPTURE_DEDUP_KEEPALIVE_MS.
+// - A probe that moved more than CAPTURE_MOTION_DISTANCE bits from the
+//   previous probe counts as motion and starts a burst.
+// - A burst (motion or VAD) keeps CAPTURE_BURST_FRAMES frames
+//   CAPTURE_BURST_INTERVAL_MS apart, each still deduplicated.
+static void camera_task(void*) {
+#if CAPTURE_DEDUP_ENABLED
+    uint64_t saved_hash = 0;
+    uint64_t probe_hash = 0;
+    bool have_saved = false;
+    bool have_probe = false;
+    unsigned long last_saved_ms = 0;
+    uint8_t burst_remaining = 0;
+#endif
+
+    while (true) {
+#if CAPTURE_DEDUP_ENABLED
+        uint32_t wait_ms = burst_remaining > 0 ? CAPTURE_BURST_INTERVAL_MS : CAPTURE_PROBE_INTERVAL_MS;
+        bool requested = ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(wait_ms)) > 0;
+#else
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+#endif
+        if (!sd_ok || capture_paused) continue;
+
+        PhotoFrame frame;
+        if (!grab_photo(frame)) continue;
+
+#if CAPTURE_DEDUP_ENABLED
+        if (photo_burst_requested.exchange(false) && burst_remaining == 0) {
+            burst_remaining = CAPTURE_BURST_FRAMES;
+        }
+
+        uint64_t hash = 0;
+        bool hashed = hash_photo(frame.fb, hash);
+        bool motion = hashed && have_probe && frame_hash_distance(hash, probe_hash) > CAPTURE_MOTION_DISTANCE;
+        if (hashed) {
+            probe_hash = hash;
+            have_probe = true;
+        }
+        if (motion && burst_remaining == 0) {
+            burst_remaining = CAPTURE_BURST_FRAMES;
+        }
+
+        bool in_burst = burst_remaining > 0;
+        if (in_burst) burst_remaining--;
+
+        bool changed = !hashed || !have_saved || frame_hash_distance(hash, saved_hash) > CAPTURE_DEDUP_DISTANCE;
+        bool stale = !have_saved || millis() - last_saved_ms >= CAPTURE_DEDUP_KEEPALIVE_MS;
+        if (!(requested || in_burst) || !(changed || stale)) {
+            if (requested) photo_dedup_skipped++;
+            esp_camera_fb_return(frame.fb);
+            continue;
+        }
+
+        if (hashed) {
+            saved_hash = hash;
+            have_saved = true;
+        }
+        last_saved_ms = millis();
+#endif
+        queue_photo(frame);
+    }
+}
+
+static void photo_writer_task(void*) {
+    while (true) {
+        PhotoFrame frame;
+        if (xQueueReceive(photo_queue, &frame, portMAX_DELAY) == pdTRUE) {
+            save_photo(frame);
+        }
+    }
+}
+
+static bool start_camera_tasks(size_t fb_count) {
+    // One frame queued while the writer holds another keeps every buffer busy.
+    photo_queue = xQueueCreate(fb_count > 1 ? fb_count - 1 : 1, sizeof(PhotoFrame));
+    if (!photo_queue) {
+        Serial.println("Photo queue alloc failed");
+        return false;
+    }
+    if (xTaskCreatePinnedToCore(photo_writer_task, "photo_sd", 6144, nullptr,
+                                CAMERA_WRITER_TASK_PRIORITY, &photo_writer_task_handle,
+                                CAMERA_WRITER_TASK_CORE) != pdPASS) {
+        Serial.println("Photo writer task create failed");
+        return false;
+    }
+    if (xTaskCreatePinnedToCore(camera_task, "camera", 4096, nullptr,
+                                CAMERA_TASK_PRIORITY, &camera_task_handle,
+                                CAMERA_TASK_CORE) != pdPASS) {
+        Serial.println("Camera task create failed");
+        return false;
+    }
+    return true;
+}
+
+// Asks the camera task for a photo; falls back to an inline capture when the
+// tasks could not be started.
+static void request_photo_capture() {
+    if (!sd_ok || !camera_ok || capture_paused) return;
+    if (camera_task_handle) {
+        xTaskNotifyGive(camera_task_handle);
+        return;
+    }
+    PhotoFrame frame;
+    if (grab_photo(frame)) {
+        save_photo(frame);
+    }
+}
 
+static void init_camera() {
     esp_err_t cam_err = esp_camera_init(&camera_config);
     if (cam_err != ESP_OK) {
         Serial.printf("Camera init failed: 0x%x\n", cam_err);
         camera_ok = false;
     } else {
         camera_ok = true;
+        // The camera DMA streams continuously (CAMERA_GRAB_LATEST) and is not
+        // tracked by IDF PM, so light sleep would corrupt frames.
+        power_acquire(PowerLockKind::NoLightSleep);
     }
+    boot_timings.camera_ms = millis();
+}
 
+static void mount_sd() {
     // SD_MMC in 1-bit mode for stability on small boards.
     SD_MMC.setPins(
         SD_MMC_CLK_PIN,
@@ -1135,31 +3273,154 @@ void setup() {
         SD_MMC_D2_PIN,
         SD_MMC_D3_PIN
     );
-    if (!SD_MMC.begin("/sdcard", true)) {
+    if (!SD_MMC.begin(kSdMountPoint, true)) {
         Serial.println("SD_MMC mount failed");
         sd_ok = false;
     } else {
         sd_ok = true;
     }
+    boot_timings.sd_ms = millis();
+}
 
+static void start_audio() {
 #if AUDIO_ENABLED
-    audio_ok = init_audio();
+#if AUDIO_VAD_BENCHMARK
+    run_vad_benchmark();
+#endif
+    speech_detector.set_start_mult(prefs.getFloat("vad_mult", AUDIO_RMS_START_MULT));
+    vad_start_mult = speech_detector.start_mult();
+    vad_start_mult_saved = vad_start_mult;
+    audio_ok = init_audio() && start_audio_tasks();
     if (audio_ok) {
+        boot_timings.audio_ms = millis();
         Serial.println("Audio init ok");
     } else {
         Serial.println("Audio init failed");
     }
 #endif
+}
+
+// Sequential tail of the boot path: everything that needs the manifest index
+// or the SD usage baseline.
+static void finish_deferred_boot(bool allow_compaction) {
+    {
+        ManifestLock lock;
+        rebuild_manifest_index(allow_compaction);
+        init_seq_allocator();
+    }
+    if (boot_events) xEventGroupSetBits(boot_events, kBootIndexBuilt);
+    boot_timings.index_ms = millis();
+    if (sd_ok && manifest_index_ready) resync_sd_usage();
+    boot_deferred_done = true;
+}
+
+#if BOOT_FAST_ENABLED
+static void camera_init_task(void* arg) {
+    init_camera();
+    xTaskNotifyGive(static_cast<TaskHandle_t>(arg));
+    vTaskDelete(nullptr);
+}
+
+// Writers keep their file on the card and wait in write_manifest_atomic()
+// until the index is built; the audio ring and the camera's spare frame
+// buffer cover that gap. Seqs handed out meanwhile come from the NVS block.
+// Compaction is left to loop() if a clip is already recording.
+static void manifest_index_task(void*) {
+    finish_deferred_boot(!audio_recording);
+    Serial.printf("Manifest index ready at %lu ms\n", static_cast<unsigned long>(boot_timings.index_ms));
+    vTaskDelete(nullptr);
+}
+#endif
+
+void setup() {
+    Serial.begin(115200);
+#if !BOOT_FAST_ENABLED
+    delay(1000);
+#endif
+    manifest_mutex = xSemaphoreCreateRecursiveMutex();
+    boot_events = xEventGroupCreate();
+#if POWER_MANAGEMENT_ENABLED
+    if (power_init(PM_MAX_FREQ_MHZ, PM_MIN_FREQ_MHZ, PM_LIGHT_SLEEP_ENABLED)) {
+        Serial.printf("PM: DFS %d-%d MHz, light sleep %s\n", PM_MIN_FREQ_MHZ, PM_MAX_FREQ_MHZ,
+                      PM_LIGHT_SLEEP_ENABLED ? "on" : "off");
+    } else {
+        Serial.println("PM unavailable (CONFIG_PM_ENABLE off?); running at full clock");
+    }
+#endif
+    Serial.println("\n[ESP32] Day 6: photo + audio -> SD + upload");
+
+    prefs.begin("lifelog", false);
+    if (!telemetry_ring.begin(TELEMETRY_RING_SAMPLES)) {
+        Serial.println("Telemetry ring unavailable; samples not kept");
+    }
+    uint8_t stored_order = prefs.getUChar("upload_order", UPLOAD_ORDER_DEFAULT);
+    if (stored_order <= static_cast<uint8_t>(UploadOrder::Paired)) {
+        upload_order = static_cast<UploadOrder>(stored_order);
+    }
+
+#if BOOT_FAST_ENABLED
+    // Audio needs neither the card nor the index until a clip starts.
+    start_audio();
+#endif
+
+    init_camera_config();
+
+    if (!psramFound()) {
+        Serial.println("PSRAM not found, lowering frame size.");
+        camera_config.frame_size = FRAMESIZE_VGA;
+        camera_config.fb_count = 1;
+        camera_config.fb_location = CAMERA_FB_IN_DRAM;
+    }
+
+#if BOOT_FAST_ENABLED
+    // The sensor probe and the card mount both spend most of their time
+    // waiting on the bus, so they run side by side.
+    bool camera_async = xTaskCreatePinnedToCore(camera_init_task, "cam_init", 4096, xTaskGetCurrentTaskHandle(),
+                                                BOOT_INIT_TASK_PRIORITY, nullptr, BOOT_INIT_TASK_CORE) == pdPASS;
+    if (!camera_async) init_camera();
+    mount_sd();
+    if (camera_async) ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+    if (camera_ok && sd_ok && !start_camera_tasks(camera_config.fb_count)) {
+        Serial.println("Camera tasks unavailable; capturing inline");
+    }
+    // Capture one immediately on boot.
+    request_photo_capture();
+
+    init_upload_buffers();
+    if (!sd_prefetch.begin(UPLOAD_STREAM_CHUNK_BYTES, UPLOAD_STREAM_BUFFERS,
+                           UPLOAD_PREFETCH_TASK_CORE, UPLOAD_PREFETCH_TASK_PRIORITY)) {
+        Serial.println("SD prefetch unavailable; streaming uploads unbuffered");
+    }
+    if (xTaskCreatePinnedToCore(manifest_index_task, "boot_index", 6144, nullptr,
+                                BOOT_INDEX_TASK_PRIORITY, nullptr, BOOT_INIT_TASK_CORE) != pdPASS) {
+        finish_deferred_boot(true);
+    }
+#else
+    init_camera();
+    mount_sd();
+    finish_deferred_boot(true);
+    init_upload_buffers();
+    if (!sd_prefetch.begin(UPLOAD_STREAM_CHUNK_BYTES, UPLOAD_STREAM_BUFFERS,
+                           UPLOAD_PREFETCH_TASK_CORE, UPLOAD_PREFETCH_TASK_PRIORITY)) {
+        Serial.println("SD prefetch unavailable; streaming uploads unbuffered");
+    }
+
+    start_audio();
+
+    if (camera_ok && sd_ok && !start_camera_tasks(camera_config.fb_count)) {
+        Serial.println("Camera tasks unavailable; capturing inline");
+    }
 
     // Capture one immediately on boot.
-    capture_and_save();
+    request_photo_capture();
+#endif
 
     if (WIFI_DUTY_CYCLE_ENABLED) {
+        uint64_t mac = ESP.getEfuseMac();
+        wifi_scheduler.set_jitter_seed(static_cast<uint32_t>(mac) ^ static_cast<uint32_t>(mac >> 32));
         WiFi.mode(WIFI_OFF);
         wifi_ok = false;
-        wifi_window_active = false;
-        wifi_backlog_window = false;
-        last_wifi_cycle = millis() - WIFI_DUTY_CYCLE_INTERVAL_MS;
     } else {
         wifi_ok = connect_wifi_best_effort();
         if (wifi_ok) {
@@ -1170,28 +3431,68 @@ void setup() {
         ntp_synced = wifi_ok ? sync_time_best_effort() : false;
         Serial.printf("NTP sync: %s\n", ntp_synced ? "ok" : "failed");
     }
+
+    boot_timings.setup_ms = millis();
+    Serial.printf("Boot (%s, %s): audio %lu ms, camera %lu ms, sd %lu ms, first frame %lu ms, setup %lu ms\n",
+                  reset_reason_name(esp_reset_reason()),
+                  BOOT_FAST_ENABLED ? "fast" : "sequential",
+                  static_cast<unsigned long>(boot_timings.audio_ms),
+                  static_cast<unsigned long>(boot_timings.camera_ms),
+                  static_cast<unsigned long>(boot_timings.sd_ms),
+                  static_cast<unsigned long>(boot_timings.first_frame_ms.load()),
+                  static_cast<unsigned long>(boot_timings.setup_ms));
+}
+
+// The learned VAD threshold moves a few percent per clip; NVS only sees it
+// every AUDIO_VAD_PERSIST_INTERVAL_MS, and only once it drifted.
+static void persist_vad_start_mult(unsigned long now) {
+#if AUDIO_ENABLED
+    if (!audio_ok || now - last_vad_persist < AUDIO_VAD_PERSIST_INTERVAL_MS) return;
+    last_vad_persist = now;
+    float mult = vad_start_mult;
+    if (fabsf(mult - vad_start_mult_saved) < vad_start_mult_saved * 0.05f) return;
+    prefs.putFloat("vad_mult", mult);
+    vad_start_mult_saved = mult;
+    Serial.printf("VAD start threshold now %.2fx noise floor\n", mult);
+#endif
+}
+
+// Time until the next loop() deadline. Audio and camera run in their own
+// tasks, so a long idle here only lets the idle task drop the clock (or
+// light-sleep) without costing samples. Active Wi-Fi windows keep the short
+// poll for connection and upload progress.
+static uint32_t loop_idle_ms(unsigned long now) {
+    if (!power_managed()) return 5;
+    if (wifi_ok || wifi_scheduler.active()) return 5;
+
+    uint32_t idle = LOOP_IDLE_MAX_MS;
+    auto until = [&](unsigned long last, unsigned long interval) {
+        unsigned long elapsed = now - last;
+        uint32_t left = elapsed >= interval ? 0 : static_cast<uint32_t>(interval - elapsed);
+        if (left < idle) idle = left;
+    };
+    until(last_capture, CAPTURE_INTERVAL_MS);
+    until(last_retention_check, RETENTION_CHECK_INTERVAL_MS);
+    if (retention_active) until(last_retention_step, RETENTION_STEP_INTERVAL_MS);
+    if (!telemetry_report_due) until(last_telemetry, TELEMETRY_INTERVAL_MS);
+    until(last_telemetry_sample, TELEMETRY_SAMPLE_INTERVAL_MS);
+#if AUDIO_ENABLED
+    if (audio_ok && AUDIO_HEARTBEAT_ENABLED) {
+        until(last_audio_heartbeat, AUDIO_HEARTBEAT_INTERVAL_MS);
+    }
+#endif
+    return idle > 5 ? idle : 5;
 }
 
 void loop() {
-    audio_tick();
     unsigned long now = millis();
 
     if (WIFI_DUTY_CYCLE_ENABLED) {
-        bool window_due = now - last_wifi_cycle >= WIFI_DUTY_CYCLE_INTERVAL_MS;
-        bool backlog_due = false;
-        if (!wifi_window_active) {
-            if (count_pending_manifests() > 0 && now - last_wifi_cycle >= WIFI_DUTY_CYCLE_COOLDOWN_MS) {
-                backlog_due = true;
-            }
-        }
-
-        if (!wifi_window_active && (window_due || backlog_due)) {
-            wifi_window_active = true;
-            wifi_backlog_window = backlog_due && !window_due;
-            wifi_window_start = now;
-            last_wifi_cycle = now;
+        uint64_t backlog = pending_backlog_bytes();
+        if (wifi_scheduler.should_open(now, backlog)) {
+            wifi_scheduler.open(now, backlog, static_cast<uint32_t>(upload_stats.bytes), upload_stats.items);
             wifi_ok = connect_wifi_best_effort(5000);
-            last_wifi_attempt = now;
+            last_wifi_attempt = millis();
             if (wifi_ok) {
                 Serial.printf("WiFi connected: %s\n", WiFi.localIP().toString().c_str());
             } else {
@@ -1199,7 +3500,7 @@ void loop() {
             }
         }
 
-        if (wifi_window_active && !wifi_ok && !audio_recording && now - last_wifi_attempt >= 10000) {
+        if (wifi_scheduler.active() && !wifi_ok && now - last_wifi_attempt >= 10000) {
             wifi_ok = connect_wifi_best_effort(500);
             last_wifi_attempt = now;
             if (wifi_ok) {
@@ -1207,22 +3508,33 @@ void loop() {
             }
         }
 
-        if (wifi_window_active) {
-            unsigned long window_limit = wifi_backlog_window ? WIFI_DUTY_CYCLE_MAX_WINDOW_MS : WIFI_DUTY_CYCLE_WINDOW_MS;
-            bool window_expired = now - wifi_window_start >= window_limit;
-            bool backlog_cleared = count_pending_manifests() == 0;
-            if (window_expired || backlog_cleared) {
+        if (wifi_scheduler.active()) {
+            if (wifi_ok) {
+                wifi_scheduler.on_connected(millis(), WiFi.RSSI());
+            }
+            WifiCloseReason reason = wifi_scheduler.poll(millis(), backlog, static_cast<uint32_t>(upload_stats.bytes),
+                                                         upload_stats.items);
+            if (reason != WifiCloseReason::None) {
                 if (WiFi.status() == WL_CONNECTED) {
                     WiFi.disconnect(true);
                 }
                 WiFi.mode(WIFI_OFF);
                 wifi_ok = false;
-                wifi_window_active = false;
-                wifi_backlog_window = false;
-                Serial.println("WiFi window closed");
+                wifi_scheduler.close(millis(), reason);
+                const WifiWindowStats& window = wifi_scheduler.last_window();
+                Serial.printf("WiFi window closed (%s): %lu ms on air, connect %lu ms, busy %lu ms, "
+                              "%lu B in %lu items, %lu B/s, rssi %d\n",
+                              wifi_close_reason_name(window.reason),
+                              static_cast<unsigned long>(window.duration_ms),
+                              static_cast<unsigned long>(window.connect_ms),
+                              static_cast<unsigned long>(window.busy_ms),
+                              static_cast<unsigned long>(window.bytes),
+                              static_cast<unsigned long>(window.items),
+                              static_cast<unsigned long>(window.throughput_bps),
+                              window.rssi);
             }
         }
-    } else if (!wifi_ok && !audio_recording && now - last_wifi_attempt >= 10000) {
+    } else if (!wifi_ok && now - last_wifi_attempt >= 10000) {
         wifi_ok = connect_wifi_best_effort(200);
         last_wifi_attempt = now;
         if (wifi_ok) {
@@ -1230,14 +3542,20 @@ void loop() {
         }
     }
 
-    if (wifi_ok && !ntp_synced && !audio_recording && now - last_ntp_attempt >= 15000) {
+    if (wifi_ok && !ntp_synced && now - last_ntp_attempt >= 15000) {
         ntp_synced = sync_time_best_effort(500);
         last_ntp_attempt = now;
         Serial.printf("NTP sync: %s\n", ntp_synced ? "ok" : "failed");
     }
 
+    if (wifi_ok && (!device_config_fetched || now - last_config_fetch >= DEVICE_CONFIG_INTERVAL_MS)) {
+        fetch_device_config();
+        device_config_fetched = true;
+        last_config_fetch = now;
+    }
+
     if (now - last_capture >= CAPTURE_INTERVAL_MS) {
-        capture_and_save();
+        request_photo_capture();
         last_capture = now;
     }
 
@@ -1251,20 +3569,53 @@ void loop() {
     }
 #endif
 
-    if (!audio_recording && now - last_upload >= UPLOAD_INTERVAL_MS) {
-        upload_batch();
-        last_upload = now;
+    unsigned long upload_ms = 0;
+    if (now - last_upload >= UPLOAD_INTERVAL_MS) {
+        unsigned long slice_start = millis();
+        bool more = upload_batch();
+        upload_ms = millis() - slice_start;
+        last_upload = more ? now - UPLOAD_INTERVAL_MS : now;
     }
 
-    if (!audio_recording && now - last_retention_check >= RETENTION_CHECK_INTERVAL_MS) {
-        enforce_retention();
+    if (sd_ok && boot_deferred_done && now - last_sd_usage_resync >= SD_USAGE_RESYNC_INTERVAL_MS) {
+        resync_sd_usage();
+    }
+    if (boot_deferred_done && (now - last_retention_check >= RETENTION_CHECK_INTERVAL_MS || retention_active)) {
+        retention_step(now);
         last_retention_check = now;
     }
 
-    if (!audio_recording && now - last_telemetry >= TELEMETRY_INTERVAL_MS) {
-        send_telemetry();
+    // Compaction holds the manifest lock for the whole rewrite; defer it past
+    // active clips so the audio writer is not blocked waiting to finish one.
+    if (!audio_recording && manifest_index_ready && manifest_journal_needs_compaction()) {
+        compact_manifest_journal();
+    }
+
+    persist_vad_start_mult(now);
+
+    if (boot_deferred_done && now - last_telemetry_sample >= TELEMETRY_SAMPLE_INTERVAL_MS) {
+        record_telemetry_sample(now);
+    }
+    if (boot_deferred_done && !telemetry_report_due && now - last_telemetry >= TELEMETRY_INTERVAL_MS) {
+        telemetry_report_due = true;
         last_telemetry = now;
     }
+    if (telemetry_report_due && wifi_ok && send_telemetry()) {
+        telemetry_report_due = false;
+    }
+    // A full batch goes out on the next pass (a few seconds apart if the
+    // last flush failed or left more behind); a partial one waits.
+    if (wifi_ok && telemetry_ring.size() > 0) {
+        unsigned long wait = telemetry_ring.size() >= TELEMETRY_BATCH_SAMPLES ? 5000 : TELEMETRY_FLUSH_INTERVAL_MS;
+        if (now - last_telemetry_flush >= wait) flush_telemetry_samples();
+    }
+
+    // Everything this pass did besides the upload slice was time the window
+    // could not spend uploading.
+    if (WIFI_DUTY_CYCLE_ENABLED && wifi_scheduler.connected()) {
+        unsigned long pass_ms = millis() - now;
+        wifi_scheduler.note_busy(static_cast<uint32_t>(pass_ms > upload_ms ? pass_ms - upload_ms : 0));
+    }
 
-    delay(5);
+    delay(loop_idle_ms(millis()));
 }
@@ -0,0 +1,234 @@
+#include "manifest_index.h"
+
+#include <algorithm>
+
+void ManifestIndex::clear() {
+    entries_.clear();
+    shards_.clear();
+    for (size_t s = 0; s < kManifestStatusCount; s++) {
+        counts_[s] = 0;
+        bytes_[s] = 0;
+        hints_[s] = 0;
+        for (size_t k = 0; k < kManifestTierCount; k++) {
+            tier_counts_[s][k] = 0;
+            tier_hints_[s][k] = 0;
+        }
+    }
+}
+
+void ManifestIndex::reserve(size_t count) {
+    entries_.reserve(count);
+}
+
+void ManifestIndex::load(const ManifestIndexEntry& entry) {
+    entries_.push_back(entry);
+}
+
+void ManifestIndex::finish_load() {
+    std::stable_sort(entries_.begin(), entries_.end(), [](const ManifestIndexEntry& a, const ManifestIndexEntry& b) {
+        return before(a, b.captured_epoch, b.seq);
+    });
+    // Directory scans can surface the same seq twice (e.g. a stale copy);
+    // keep the last one loaded for each position.
+    auto last = std::unique(entries_.rbegin(), entries_.rend(), [](const ManifestIndexEntry& a, const ManifestIndexEntry& b) {
+        return a.seq == b.seq && a.captured_epoch == b.captured_epoch;
+    });
+    entries_.erase(entries_.begin(), last.base());
+    recount();
+}
+
+bool ManifestIndex::before(const ManifestIndexEntry& a, uint32_t captured_epoch, uint32_t seq) {
+    bool a_unsynced = a.captured_epoch == 0;
+    bool b_unsynced = captured_epoch == 0;
+    if (a_unsynced != b_unsynced) return !a_unsynced;
+    if (a.captured_epoch != captured_epoch) return a.captured_epoch < captured_epoch;
+    return a.seq < seq;
+}
+
+size_t ManifestIndex::lower_bound(uint32_t seq, uint32_t captured_epoch) const {
+    size_t lo = 0;
+    size_t hi = entries_.size();
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (before(entries_[mid], captured_epoch, seq)) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+uint32_t ManifestIndex::max_seq() const {
+    uint32_t highest = 0;
+    for (const ManifestIndexEntry& entry : entries_) {
+        if (entry.seq > highest) highest = entry.seq;
+    }
+    return highest;
+}
+
+size_t ManifestIndex::shard_at(size_t pos) const {
+    // Last shard starting at or before pos.
+    size_t lo = 0;
+    size_t hi = shards_.size();
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (shards_[mid].begin <= pos) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    if (lo == 0) return shards_.size();
+    const ManifestShard& shard = shards_[lo - 1];
+    return pos < shard.begin + shard.size ? lo - 1 : lo;
+}
+
+size_t ManifestIndex::find_shard(uint32_t day) const {
+    size_t lo = 0;
+    size_t hi = shards_.size();
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (shards_[mid].day < day) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+void ManifestIndex::shift_shards(size_t after, bool grow) {
+    for (size_t sh = after + 1; sh < shards_.size(); sh++) {
+        if (grow) {
+            shards_[sh].begin++;
+        } else {
+            shards_[sh].begin--;
+        }
+    }
+}
+
+void ManifestIndex::count_entry(const ManifestIndexEntry& entry, ManifestShard& shard, bool add) {
+    size_t s = static_cast<size_t>(entry.status);
+    size_t k = static_cast<size_t>(manifest_tier(entry.item_type));
+    if (add) {
+        counts_[s]++;
+        bytes_[s] += entry.size_bytes;
+        tier_counts_[s][k]++;
+        shard.counts[s]++;
+        shard.bytes[s] += entry.size_bytes;
+        shard.tier_counts[s][k]++;
+    } else {
+        counts_[s]--;
+        bytes_[s] -= entry.size_bytes;
+        tier_counts_[s][k]--;
+        shard.counts[s]--;
+        shard.bytes[s] -= entry.size_bytes;
+        shard.tier_counts[s][k]--;
+    }
+}
+
+void ManifestIndex::recount() {
+    shards_.clear();
+    for (size_t s = 0; s < kManifestStatusCount; s++) {
+        counts_[s] = 0;
+        bytes_[s] = 0;
+        hints_[s] = entries_.size();
+        for (size_t k = 0; k < kManifestTierCount; k++) {
+            tier_counts_[s][k] = 0;
+            tier_hints_[s][k] = entries_.size();
+        }
+    }
+    for (size_t i = 0; i < entries_.size(); i++) {
+        const ManifestIndexEntry& entry = entries_[i];
+        size_t s = static_cast<size_t>(entry.status);
+        size_t k = static_cast<size_t>(manifest_tier(entry.item_type));
+        if (counts_[s] == 0) hints_[s] = i;
+        if (tier_counts_[s][k] == 0) tier_hints_[s][k] = i;
+
+        uint32_t day = shard_day(entry.captured_epoch);
+        if (shards_.empty() || shards_.back().day != day) {
+            ManifestShard shard;
+            shard.day = day;
+            shard.begin = static_cast<uint32_t>(i);
+            shards_.push_back(shard);
+        }
+        ManifestShard& shard = shards_.back();
+        shard.size++;
+        count_entry(entry, shard, true);
+    }
+}
+
+void ManifestIndex::upsert(const ManifestIndexEntry& entry) {
+    size_t pos = lower_bound(entry.seq, entry.captured_epoch);
+    size_t s = static_cast<size_t>(entry.status);
+    size_t k = static_cast<size_t>(manifest_tier(entry.item_type));
+
+    if (pos < entries_.size() && entries_[pos].seq == entry.seq &&
+        entries_[pos].captured_epoch == entry.captured_epoch) {
+        ManifestIndexEntry& existing = entries_[pos];
+        ManifestShard& shard = shards_[shard_at(pos)];
+        count_entry(existing, shard, false);
+        existing = entry;
+        count_entry(entry, shard, true);
+        if (pos < hints_[s]) hints_[s] = pos;
+        if (pos < tier_hints_[s][k]) tier_hints_[s][k] = pos;
+        return;
+    }
+
+    uint32_t day = shard_day(entry.captured_epoch);
+    size_t sh = find_shard(day);
+    if (sh == shards_.size() || shards_[sh].day != day) {
+        ManifestShard shard;
+        shard.day = day;
+        shard.begin = static_cast<uint32_t>(pos);
+        shards_.insert(shards_.begin() + sh, shard);
+    }
+    ManifestShard& shard = shards_[sh];
+    shard.size++;
+    count_entry(entry, shard, true);
+    shift_shards(sh, true);
+
+    entries_.insert(entries_.begin() + pos, entry);
+    for (size_t t = 0; t < kManifestStatusCount; t++) {
+        if (hints_[t] > pos) hints_[t]++;
+        for (size_t j = 0; j < kManifestTierCount; j++) {
+            if (tier_hints_[t][j] > pos) tier_hints_[t][j]++;
+        }
+    }
+    if (pos < hints_[s]) hints_[s] = pos;
+    if (pos < tier_hints_[s][k]) tier_hints_[s][k] = pos;
+}
+
+bool ManifestIndex::remove(uint32_t seq, uint32_t captured_epoch) {
+    size_t pos = lower_bound(seq, captured_epoch);
+    if (pos >= entries_.size() || entries_[pos].seq != seq || entries_[pos].captured_epoch != captured_epoch) {
+        return false;
+    }
+    size_t sh = shard_at(pos);
+    ManifestShard& shard = shards_[sh];
+    shard.size--;
+    count_entry(entries_[pos], shard, false);
+    shift_shards(sh, false);
+    if (shard.size == 0) shards_.erase(shards_.begin() + sh);
+    entries_.erase(entries_.begin() + pos);
+    for (size_t t = 0; t < kManifestStatusCount; t++) {
+        if (hints_[t] > pos) hints_[t]--;
+        for (size_t j = 0; j < kManifestTierCount; j++) {
+            if (tier_hints_[t][j] > pos) tier_hints_[t][j]--;
+        }
+    }
+    return true;
+}
+
+const ManifestIndexEntry* ManifestIndex::find(uint32_t seq, uint32_t captured_epoch) const {
+    size_t pos = lower_bound(seq, captured_epoch);
+    if (pos >= entries_.size() || entries_[pos].seq != seq || entries_[pos].captured_epoch != captured_epoch) {
+        return nullptr;
+    }
+    return &entries_[pos];
+}
+
+const ManifestIndexEntry* ManifestIndex::oldest(ManifestStatus status) {
+    return oldest_where(status, [](const ManifestIndexEntry&) { return true; });
+}
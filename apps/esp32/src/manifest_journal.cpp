@@ -0,0 +1,246 @@
+#include "manifest_journal.h"
+
+#include <string.h>
+
+namespace {
+
+constexpr char kJournalMagic[4] = {'O', 'M', 'J', '1'};
+constexpr uint16_t kJournalVersion = 1;
+constexpr size_t kReplayBatchRecords = 16;
+
+struct JournalHeader {
+    char magic[4];
+    uint16_t version;
+    uint16_t record_size;
+    uint32_t reserved;
+    uint32_t crc;
+};
+
+static_assert(sizeof(JournalHeader) == 16, "JournalHeader layout is part of the on-card format");
+
+constexpr uint32_t kHeaderBytes = sizeof(JournalHeader);
+constexpr uint32_t kRecordBytes = sizeof(ManifestRecord);
+
+// Reflected CRC-32 (IEEE 802.3), nibble table to keep flash/RAM use small.
+uint32_t crc32(const uint8_t* data, size_t len) {
+    static const uint32_t table[16] = {
+        0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC,
+        0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+        0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C,
+        0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C,
+    };
+    uint32_t crc = 0xFFFFFFFF;
+    for (size_t i = 0; i < len; i++) {
+        crc ^= data[i];
+        crc = (crc >> 4) ^ table[crc & 0x0F];
+        crc = (crc >> 4) ^ table[crc & 0x0F];
+    }
+    return ~crc;
+}
+
+void fill_header(JournalHeader& header) {
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, kJournalMagic, sizeof(header.magic));
+    header.version = kJournalVersion;
+    header.record_size = static_cast<uint16_t>(kRecordBytes);
+    header.crc = crc32(reinterpret_cast<const uint8_t*>(&header), offsetof(JournalHeader, crc));
+}
+
+ManifestRecord replay_buf[kReplayBatchRecords];
+
+}  // namespace
+
+void ManifestJournal::seal(ManifestRecord& record) {
+    record.crc = crc32(reinterpret_cast<const uint8_t*>(&record), offsetof(ManifestRecord, crc));
+}
+
+bool ManifestJournal::valid(const ManifestRecord& record) {
+    return record.crc == crc32(reinterpret_cast<const uint8_t*>(&record), offsetof(ManifestRecord, crc));
+}
+
+bool ManifestJournal::create_empty(const char* path) {
+    File f = fs_->open(path, FILE_WRITE);
+    if (!f) return false;
+    JournalHeader header;
+    fill_header(header);
+    size_t written = f.write(reinterpret_cast<const uint8_t*>(&header), sizeof(header));
+    f.flush();
+    f.close();
+    return written == sizeof(header);
+}
+
+bool ManifestJournal::check_header() {
+    JournalHeader header;
+    JournalHeader expected;
+    fill_header(expected);
+    file_.seek(0);
+    if (file_.read(reinterpret_cast<uint8_t*>(&header), sizeof(header)) != sizeof(header)) {
+        return false;
+    }
+    return memcmp(&header, &expected, sizeof(header)) == 0;
+}
+
+bool ManifestJournal::begin(fs::FS& fs, const char* path, const char* tmp_path) {
+    end();
+    fs_ = &fs;
+    path_ = path;
+    tmp_path_ = tmp_path;
+
+    // A compaction swap interrupted after the old journal was removed leaves
+    // only the complete temp file behind; otherwise the temp file is partial.
+    if (!fs.exists(path) && fs.exists(tmp_path)) {
+        fs.rename(tmp_path, path);
+    } else if (fs.exists(tmp_path)) {
+        fs.remove(tmp_path);
+    }
+
+    if (!fs.exists(path) && !create_empty(path)) {
+        fs_ = nullptr;
+        return false;
+    }
+
+    file_ = fs.open(path, "r+");
+    if (file_ && !check_header()) {
+        // Only a torn create can leave a bad header; there is nothing to keep.
+        file_.close();
+        fs.remove(path);
+        if (create_empty(path)) {
+            file_ = fs.open(path, "r+");
+        }
+    }
+    if (!file_) {
+        fs_ = nullptr;
+        return false;
+    }
+
+    size_t size = file_.size();
+    uint32_t body = size > kHeaderBytes ? static_cast<uint32_t>(size - kHeaderBytes) : 0;
+    end_offset_ = kHeaderBytes + (body / kRecordBytes) * kRecordBytes;
+    return true;
+}
+
+void ManifestJournal::end() {
+    if (file_) {
+        file_.close();
+    }
+    fs_ = nullptr;
+    end_offset_ = 0;
+}
+
+uint32_t ManifestJournal::record_count() const {
+    return end_offset_ > kHeaderBytes ? (end_offset_ - kHeaderBytes) / kRecordBytes : 0;
+}
+
+bool ManifestJournal::replay(const Visitor& visit, ManifestJournalStats* stats) {
+    if (!ready()) return false;
+
+    ManifestJournalStats local;
+    size_t size = file_.size();
+    local.torn_tail = size > end_offset_;
+
+    uint32_t offset = kHeaderBytes;
+    file_.seek(offset);
+    while (offset < end_offset_) {
+        uint32_t remaining = (end_offset_ - offset) / kRecordBytes;
+        size_t batch = remaining < kReplayBatchRecords ? remaining : kReplayBatchRecords;
+        size_t want = batch * kRecordBytes;
+        size_t got = file_.read(reinterpret_cast<uint8_t*>(replay_buf), want);
+        if (got != want) {
+            local.torn_tail = true;
+            break;
+        }
+        for (size_t i = 0; i < batch; i++) {
+            if (valid(replay_buf[i])) {
+                local.records++;
+                visit(replay_buf[i], offset);
+            } else {
+                local.corrupt++;
+            }
+            offset += kRecordBytes;
+        }
+    }
+
+    if (stats) {
+        *stats = local;
+    }
+    return true;
+}
+
+bool ManifestJournal::append(ManifestRecord& record, uint32_t* offset_out) {
+    if (!ready()) return false;
+    seal(record);
+    if (!file_.seek(end_offset_)) return false;
+    size_t written = file_.write(reinterpret_cast<const uint8_t*>(&record), sizeof(record));
+    file_.flush();
+    if (written != sizeof(record)) {
+        // end_offset_ is unchanged, so the next append overwrites the fragment.
+        return false;
+    }
+    if (offset_out) {
+        *offset_out = end_offset_;
+    }
+    end_offset_ += kRecordBytes;
+    return true;
+}
+
+bool ManifestJournal::read(uint32_t offset, ManifestRecord& out) {
+    if (!ready()) return false;
+    if (offset < kHeaderBytes || offset + kRecordBytes > end_offset_) return false;
+    if (!file_.seek(offset)) return false;
+    if (file_.read(reinterpret_cast<uint8_t*>(&out), sizeof(out)) != sizeof(out)) return false;
+    return valid(out);
+}
+
+bool ManifestJournal::compact(const LivePredicate& is_live, const Visitor& relocated) {
+    if (!ready()) return false;
+    if (!create_empty(tmp_path_)) return false;
+
+    File out = fs_->open(tmp_path_, FILE_APPEND);
+    if (!out) {
+        fs_->remove(tmp_path_);
+        return false;
+    }
+
+    bool ok = true;
+    uint32_t offset = kHeaderBytes;
+    file_.seek(offset);
+    while (ok && offset < end_offset_) {
+        uint32_t remaining = (end_offset_ - offset) / kRecordBytes;
+        size_t batch = remaining < kReplayBatchRecords ? remaining : kReplayBatchRecords;
+        size_t want = batch * kRecordBytes;
+        if (file_.read(reinterpret_cast<uint8_t*>(replay_buf), want) != want) {
+            ok = false;
+            break;
+        }
+        for (size_t i = 0; i < batch; i++) {
+            const ManifestRecord& record = replay_buf[i];
+            if (valid(record) && is_live(record, offset)) {
+                if (out.write(reinterpret_cast<const uint8_t*>(&record), sizeof(record)) != sizeof(record)) {
+                    ok = false;
+                    break;
+                }
+            }
+            offset += kRecordBytes;
+        }
+    }
+    out.flush();
+    out.close();
+
+    if (!ok) {
+        fs_->remove(tmp_path_);
+        return false;
+    }
+
+    fs::FS& fs = *fs_;
+    const char* path = path_;
+    const char* tmp_path = tmp_path_;
+    file_.close();
+    fs.remove(path);
+    bool renamed = fs.rename(tmp_path, path);
+    // begin() retries the swap if the rename failed; offsets only move when
+    // the compacted file is the one that ends up open.
+    if (!begin(fs, path, tmp_path) || !renamed) {
+        return false;
+    }
+    return replay(relocated);
+}
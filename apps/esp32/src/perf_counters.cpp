@@ -0,0 +1,123 @@
+#include "perf_counters.h"
+
+#include <string.h>
+
+#if defined(ESP_PLATFORM)
+#include <freertos/FreeRTOS.h>
+#include "esp_timer.h"
+#else
+#include <chrono>
+#include <mutex>
+#endif
+
+namespace {
+
+constexpr uint32_t kBucketLimitUs[kPerfBuckets - 1] = {100, 1000, 10000, 100000, 1000000};
+
+PerfSnapshot counters;
+
+#if defined(ESP_PLATFORM)
+portMUX_TYPE counters_mux = portMUX_INITIALIZER_UNLOCKED;
+
+struct CountersLock {
+    CountersLock() { portENTER_CRITICAL(&counters_mux); }
+    ~CountersLock() { portEXIT_CRITICAL(&counters_mux); }
+};
+#else
+std::mutex counters_mutex;
+
+struct CountersLock {
+    std::lock_guard<std::mutex> guard{counters_mutex};
+};
+#endif
+
+void add(PerfOpStats& into, const PerfOpStats& from) {
+    into.count += from.count;
+    into.total_us += from.total_us;
+    if (from.max_us > into.max_us) into.max_us = from.max_us;
+    for (size_t b = 0; b < kPerfBuckets; b++) {
+        into.hist[b] += from.hist[b];
+    }
+}
+
+}  // namespace
+
+const char* perf_op_name(PerfOp op) {
+    switch (op) {
+    case PerfOp::AudioFrame:
+        return "audio_frame";
+    case PerfOp::SdWrite:
+        return "sd_write";
+    case PerfOp::PhotoSave:
+        return "photo_save";
+    case PerfOp::ManifestIo:
+        return "manifest_io";
+    case PerfOp::StreamUpload:
+        return "stream_upload";
+    case PerfOp::WifiConnect:
+        return "wifi_connect";
+    case PerfOp::Count:
+        break;
+    }
+    return "unknown";
+}
+
+const char* perf_event_name(PerfEvent event) {
+    switch (event) {
+    case PerfEvent::I2sOverrun:
+        return "i2s_overruns";
+    case PerfEvent::AudioDropped:
+        return "audio_dropped";
+    case PerfEvent::PhotoDropped:
+        return "photo_dropped";
+    case PerfEvent::VadFalseStart:
+        return "vad_false_starts";
+    case PerfEvent::VadDiscardedBytes:
+        return "vad_discarded_bytes";
+    case PerfEvent::Count:
+        break;
+    }
+    return "unknown";
+}
+
+uint64_t perf_now_us() {
+#if defined(ESP_PLATFORM)
+    return static_cast<uint64_t>(esp_timer_get_time());
+#else
+    using namespace std::chrono;
+    return static_cast<uint64_t>(duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count());
+#endif
+}
+
+void perf_record(PerfOp op, uint32_t elapsed_us) {
+    size_t bucket = 0;
+    while (bucket < kPerfBuckets - 1 && elapsed_us >= kBucketLimitUs[bucket]) bucket++;
+
+    CountersLock lock;
+    PerfOpStats& stats = counters.ops[static_cast<size_t>(op)];
+    stats.count++;
+    stats.total_us += elapsed_us;
+    if (elapsed_us > stats.max_us) stats.max_us = elapsed_us;
+    stats.hist[bucket]++;
+}
+
+void perf_count(PerfEvent event, uint32_t n) {
+    CountersLock lock;
+    counters.events[static_cast<size_t>(event)] += n;
+}
+
+void perf_take(PerfSnapshot& out) {
+    CountersLock lock;
+    out = counters;
+    memset(&counters, 0, sizeof(counters));
+}
+
+void perf_restore(const PerfSnapshot& snapshot) {
+    CountersLock lock;
+    for (size_t op = 0; op < kPerfOpCount; op++) {
+        add(counters.ops[op], snapshot.ops[op]);
+    }
+    for (size_t event = 0; event < kPerfEventCount; event++) {
+        counters.events[event] += snapshot.events[event];
+    }
+}
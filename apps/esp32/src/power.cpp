@@ -0,0 +1,64 @@
+#include "power.h"
+
+#if defined(ESP_PLATFORM)
+#include "esp_idf_version.h"
+#include "esp_pm.h"
+#endif
+
+#if defined(ESP_PLATFORM)
+namespace {
+
+esp_pm_lock_handle_t cpu_lock = nullptr;
+esp_pm_lock_handle_t awake_lock = nullptr;
+bool managed = false;
+
+esp_pm_lock_handle_t lock_for(PowerLockKind kind) {
+    return kind == PowerLockKind::CpuMax ? cpu_lock : awake_lock;
+}
+
+}  // namespace
+
+bool power_init(uint32_t max_mhz, uint32_t min_mhz, bool light_sleep) {
+    if (managed) return true;
+#if ESP_IDF_VERSION_MAJOR >= 5
+    esp_pm_config_t config = {};
+#else
+    esp_pm_config_esp32s3_t config = {};
+#endif
+    config.max_freq_mhz = static_cast<int>(max_mhz);
+    config.min_freq_mhz = static_cast<int>(min_mhz);
+    config.light_sleep_enable = light_sleep;
+    if (esp_pm_configure(&config) != ESP_OK) return false;
+    if (esp_pm_lock_create(ESP_PM_CPU_FREQ_MAX, 0, "busy", &cpu_lock) != ESP_OK ||
+        esp_pm_lock_create(ESP_PM_NO_LIGHT_SLEEP, 0, "awake", &awake_lock) != ESP_OK) {
+        return false;
+    }
+    managed = true;
+    return true;
+}
+
+bool power_managed() {
+    return managed;
+}
+
+void power_acquire(PowerLockKind kind) {
+    esp_pm_lock_handle_t lock = lock_for(kind);
+    if (lock) esp_pm_lock_acquire(lock);
+}
+
+void power_release(PowerLockKind kind) {
+    esp_pm_lock_handle_t lock = lock_for(kind);
+    if (lock) esp_pm_lock_release(lock);
+}
+#else
+bool power_init(uint32_t, uint32_t, bool) {
+    return false;
+}
+
+bool power_managed() {
+    return false;
+}
+
+void power_acquire(PowerLockKind) {}
+void power_release(PowerLockKind) {}
+#endif
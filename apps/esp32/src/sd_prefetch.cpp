@@ -0,0 +1,130 @@
+#include "sd_prefetch.h"
+
+#include "psram_allocator.h"
+
+bool SdPrefetchReader::begin(size_t chunk_bytes, size_t buffers, int core, unsigned priority) {
+    if (task_ || chunk_bytes == 0 || buffers < 2 || buffers > 255) return false;
+
+    storage_ = PsramAllocator<uint8_t>::try_allocate(chunk_bytes * buffers);
+    free_q_ = xQueueCreate(buffers, sizeof(uint8_t));
+    // One extra slot for the end-of-file marker.
+    full_q_ = xQueueCreate(buffers + 1, sizeof(Chunk));
+    idle_ = xSemaphoreCreateBinary();
+    chunk_bytes_ = chunk_bytes;
+    buffers_ = buffers;
+
+    if (storage_ && free_q_ && full_q_ && idle_ &&
+        xTaskCreatePinnedToCore(task_entry, "sd_prefetch", 4096, this, priority, &task_, core) == pdPASS) {
+        return true;
+    }
+
+    task_ = nullptr;
+    if (storage_) free(storage_);
+    if (free_q_) vQueueDelete(free_q_);
+    if (full_q_) vQueueDelete(full_q_);
+    if (idle_) vSemaphoreDelete(idle_);
+    storage_ = nullptr;
+    free_q_ = nullptr;
+    full_q_ = nullptr;
+    idle_ = nullptr;
+    return false;
+}
+
+bool SdPrefetchReader::start(File& file, size_t limit) {
+    if (!task_ || active_) return false;
+    xQueueReset(free_q_);
+    xQueueReset(full_q_);
+    for (size_t i = 0; i < buffers_; i++) {
+        uint8_t index = static_cast<uint8_t>(i);
+        xQueueSend(free_q_, &index, 0);
+    }
+    file_ = &file;
+    remaining_ = limit;
+    abort_ = false;
+    ended_ = false;
+    failed_ = false;
+    held_ = -1;
+    active_ = true;
+    xTaskNotifyGive(task_);
+    return true;
+}
+
+bool SdPrefetchReader::next(const uint8_t*& data, size_t& len) {
+    if (!active_ || ended_) return false;
+    release();
+
+    Chunk chunk;
+    xQueueReceive(full_q_, &chunk, portMAX_DELAY);
+    if (chunk.end) {
+        ended_ = true;
+        failed_ = chunk.error;
+        return false;
+    }
+    held_ = chunk.index;
+    data = storage_ + static_cast<size_t>(chunk.index) * chunk_bytes_;
+    len = chunk.len;
+    return true;
+}
+
+void SdPrefetchReader::release() {
+    if (held_ < 0) return;
+    uint8_t index = static_cast<uint8_t>(held_);
+    xQueueSend(free_q_, &index, 0);
+    held_ = -1;
+}
+
+void SdPrefetchReader::finish() {
+    if (!active_) return;
+    release();
+    if (!ended_) {
+        // Hand every filled buffer back so the reader can observe abort_.
+        abort_ = true;
+        Chunk chunk;
+        do {
+            xQueueReceive(full_q_, &chunk, portMAX_DELAY);
+            if (!chunk.end) {
+                xQueueSend(free_q_, &chunk.index, 0);
+            }
+        } while (!chunk.end);
+        ended_ = true;
+    }
+    xSemaphoreTake(idle_, portMAX_DELAY);
+    file_ = nullptr;
+    active_ = false;
+}
+
+void SdPrefetchReader::task_entry(void* arg) {
+    static_cast<SdPrefetchReader*>(arg)->run();
+}
+
+void SdPrefetchReader::run() {
+    while (true) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        while (true) {
+            uint8_t index = 0;
+            xQueueReceive(free_q_, &index, portMAX_DELAY);
+
+            Chunk chunk = {index, 0, false, false};
+            if (abort_) {
+                chunk.end = true;
+                xQueueSend(full_q_, &chunk, portMAX_DELAY);
+                break;
+            }
+
+            uint8_t* buf = storage_ + static_cast<size_t>(index) * chunk_bytes_;
+            size_t want = remaining_ < chunk_bytes_ ? remaining_ : chunk_bytes_;
+            size_t got = want > 0 ? file_->read(buf, want) : 0;
+            remaining_ -= got;
+            chunk.len = static_cast<uint32_t>(got);
+            if (got == 0) {
+                chunk.end = true;
+                chunk.error = remaining_ > 0 && file_->available() > 0;
+            }
+            xQueueSend(full_q_, &chunk, portMAX_DELAY);
+            if (chunk.end) break;
+        }
+
+        xSemaphoreGive(idle_);
+    }
+}
@@ -0,0 +1,66 @@
+#include "sd_write_buffer.h"
+
+#include "perf_counters.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(ESP_PLATFORM)
+#include "esp_heap_caps.h"
+#endif
+
+static constexpr size_t kSectorBytes = 512;
+
+bool SdWriteBuffer::begin(size_t capacity) {
+    if (buf_) return true;
+    capacity -= capacity % kSectorBytes;
+    if (capacity == 0) return false;
+#if defined(ESP_PLATFORM)
+    buf_ = static_cast<uint8_t*>(heap_caps_malloc(capacity, MALLOC_CAP_DMA | MALLOC_CAP_8BIT));
+#endif
+    if (!buf_) {
+        buf_ = static_cast<uint8_t*>(malloc(capacity));
+    }
+    if (!buf_) return false;
+    capacity_ = capacity;
+    return true;
+}
+
+void SdWriteBuffer::attach(File& file) {
+    file_ = &file;
+    used_ = 0;
+    flushes_ = 0;
+}
+
+bool SdWriteBuffer::write(const uint8_t* data, size_t len) {
+    if (!file_) return false;
+    if (!buf_) {
+        return file_->write(data, len) == len;
+    }
+    while (len > 0) {
+        size_t take = capacity_ - used_;
+        if (take > len) take = len;
+        memcpy(buf_ + used_, data, take);
+        used_ += take;
+        data += take;
+        len -= take;
+        if (used_ == capacity_ && !flush()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool SdWriteBuffer::flush() {
+    if (!file_ || used_ == 0) return true;
+    size_t len = used_;
+    used_ = 0;
+    flushes_++;
+    PerfTimer timer(PerfOp::SdWrite);
+    return file_->write(buf_, len) == len;
+}
+
+void SdWriteBuffer::detach() {
+    file_ = nullptr;
+    used_ = 0;
+}
@@ -0,0 +1,164 @@
+#include "speech_detector.h"
+
+#include <math.h>
+
+namespace {
+
+// Frame scores at or above kSpeechScore count as speech (towards a start and
+// towards clip confidence); inside a clip, frames below kQuietScore count
+// towards the stop like quiet ones.
+constexpr uint8_t kSpeechScore = 160;
+constexpr uint8_t kQuietScore = 96;
+
+// Model: score = 128 + (bias + sum(w[i] * x[i])) / 2, each input clamped to
+// int8 range. Hand-set so voiced speech saturates high and broadband noise
+// (fans, hiss), hum and keyboard clicks land below kSpeechScore.
+constexpr int32_t kWeights[4] = {2, 2, 2, 2};  // level, zcr band, hf band, modulation
+constexpr int32_t kBias = -128;
+
+// Threshold learning per VAD clip.
+constexpr float kFalseStartStep = 1.25f;
+constexpr float kConfidentStep = 0.98f;
+
+int32_t clamp_i32(int32_t value, int32_t lo, int32_t hi) {
+    if (value < lo) return lo;
+    if (value > hi) return hi;
+    return value;
+}
+
+int32_t abs_i32(int32_t value) { return value < 0 ? -value : value; }
+
+float clamp_f(float value, float lo, float hi) {
+    if (value < lo) return lo;
+    if (value > hi) return hi;
+    return value;
+}
+
+}  // namespace
+
+SpeechDetector::SpeechDetector(const SpeechDetectorConfig& config)
+    : config_(config), start_mult_(clamp_f(config.start_mult, config.min_start_mult, config.max_start_mult)) {}
+
+void SpeechDetector::reset() {
+    noise_rms_ = 0.0f;
+    level_ema_ = 0.0f;
+    last_score_ = 0;
+    over_count_ = 0;
+    under_count_ = 0;
+    in_clip_ = false;
+    clip_vad_ = false;
+    clip_frames_ = 0;
+    clip_speech_frames_ = 0;
+}
+
+void SpeechDetector::set_start_mult(float mult) {
+    if (!(mult > 0.0f)) return;
+    start_mult_ = clamp_f(mult, config_.min_start_mult, config_.max_start_mult);
+}
+
+uint8_t SpeechDetector::score_frame(const VadFeatures& features) {
+    float rms = features.rms;
+    level_ema_ = level_ema_ <= 1.0f ? rms : level_ema_ * 0.8f + rms * 0.2f;
+    if (features.rms == 0) {
+        last_score_ = 0;
+        return 0;
+    }
+
+    float noise = noise_rms_ > 1.0f ? noise_rms_ : 1.0f;
+    // Level over the floor, 16 per doubling.
+    int32_t level = static_cast<int32_t>(16.0f * log2f(rms / noise));
+    // Crossings per 1000 samples: ~100 for voiced speech, ~500 for hiss,
+    // near 0 for hum.
+    int32_t zc_per_k = static_cast<int32_t>(features.zero_crossings) * 1000 /
+                       static_cast<int32_t>(config_.frame_samples ? config_.frame_samples : 1);
+    int32_t zcr_band = 48 - abs_i32(zc_per_k - 100) / 2;
+    // First-difference RMS over level: ~0.1-0.4 for voiced speech, 1.41 for
+    // white noise.
+    int32_t hf_ratio = static_cast<int32_t>(features.hf_rms) * 128 / static_cast<int32_t>(features.rms);
+    int32_t hf_band = 32 - abs_i32(hf_ratio - 32);
+    float level_avg = level_ema_ > 1.0f ? level_ema_ : 1.0f;
+    int32_t modulation = static_cast<int32_t>(64.0f * fabsf(rms - level_avg) / level_avg);
+
+    int32_t x[4] = {
+        clamp_i32(level, -64, 48),
+        clamp_i32(zcr_band, -48, 48),
+        clamp_i32(hf_band, -64, 32),
+        clamp_i32(modulation, 0, 64),
+    };
+    int32_t z = kBias;
+    for (size_t i = 0; i < 4; i++) z += kWeights[i] * x[i];
+    last_score_ = static_cast<uint8_t>(clamp_i32(128 + z / 2, 0, 255));
+    return last_score_;
+}
+
+bool SpeechDetector::speech_started(const VadFeatures& features) {
+    uint8_t score = score_frame(features);
+    float rms = features.rms;
+
+    if (noise_rms_ <= 1.0f) {
+        noise_rms_ = rms;
+    } else if (rms < noise_rms_ * config_.noise_update_max_mult) {
+        noise_rms_ = noise_rms_ * (1.0f - config_.noise_alpha) + rms * config_.noise_alpha;
+    }
+
+    if (rms > noise_rms_ * start_mult_ && score >= kSpeechScore) {
+        if (over_count_ < 0xFFFF) over_count_++;
+    } else {
+        over_count_ = 0;
+    }
+    return over_count_ >= config_.start_frames;
+}
+
+void SpeechDetector::begin_clip(bool vad) {
+    in_clip_ = true;
+    clip_vad_ = vad;
+    // The frames that triggered a VAD start are part of the clip.
+    clip_frames_ = vad ? over_count_ : 0;
+    clip_speech_frames_ = clip_frames_;
+    over_count_ = 0;
+    under_count_ = 0;
+}
+
+bool SpeechDetector::speech_ended(const VadFeatures& features) {
+    uint8_t score = score_frame(features);
+    clip_frames_++;
+    if (score >= kSpeechScore) clip_speech_frames_++;
+    if (!clip_vad_) return false;
+
+    float stop_threshold = noise_rms_ * start_mult_ * config_.stop_ratio;
+    if (features.rms < stop_threshold || score < kQuietScore) {
+        if (under_count_ < 0xFFFF) under_count_++;
+    } else {
+        under_count_ = 0;
+    }
+    return under_count_ >= config_.stop_frames;
+}
+
+SpeechClipResult SpeechDetector::end_clip() {
+    SpeechClipResult result;
+    if (!in_clip_) return result;
+
+    // The quiet tail that closed a VAD clip says nothing about its content.
+    uint32_t frames = clip_frames_;
+    if (clip_vad_ && under_count_ < frames) frames -= under_count_;
+    if (frames == 0) frames = 1;
+    uint32_t confidence = clip_speech_frames_ * 100 / frames;
+    result.confidence = static_cast<uint8_t>(confidence > 100 ? 100 : confidence);
+
+    if (clip_vad_) {
+        if (result.confidence < config_.min_confidence) {
+            result.false_start = true;
+            false_starts_++;
+            set_start_mult(start_mult_ * kFalseStartStep);
+        } else if (result.confidence >= 2 * config_.min_confidence) {
+            set_start_mult(start_mult_ * kConfidentStep);
+        }
+    }
+
+    in_clip_ = false;
+    clip_vad_ = false;
+    clip_frames_ = 0;
+    clip_speech_frames_ = 0;
+    under_count_ = 0;
+    return result;
+}
@@ -0,0 +1,21 @@
+#include "string_arena.h"
+
+#include "psram_allocator.h"
+
+bool StringArena::begin(size_t capacity) {
+    if (data_ || capacity == 0) return false;
+    data_ = PsramAllocator<char>::try_allocate(capacity);
+    if (!data_) return false;
+    capacity_ = capacity;
+    used_ = 0;
+    return true;
+}
+
+const char* StringArena::copy(const char* s, size_t len) {
+    if (!data_ || len >= capacity_ - used_) return nullptr;
+    char* out = data_ + used_;
+    memcpy(out, s, len);
+    out[len] = 0;
+    used_ += len + 1;
+    return out;
+}
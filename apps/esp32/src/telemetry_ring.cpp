@@ -0,0 +1,35 @@
+#include "telemetry_ring.h"
+
+#include "psram_allocator.h"
+
+bool TelemetryRing::begin(size_t capacity) {
+    if (data_ || capacity == 0) return false;
+    data_ = PsramAllocator<TelemetrySample>::try_allocate(capacity);
+    if (!data_) return false;
+    capacity_ = capacity;
+    head_ = 0;
+    count_ = 0;
+    return true;
+}
+
+void TelemetryRing::push(const TelemetrySample& sample) {
+    if (!data_) return;
+    if (count_ == capacity_) {
+        head_ = (head_ + 1) % capacity_;
+        count_--;
+        first_seq_++;
+        dropped_++;
+    }
+    data_[(head_ + count_) % capacity_] = sample;
+    count_++;
+}
+
+void TelemetryRing::ack(uint32_t end_seq) {
+    // Signed distance so the numbering may wrap.
+    int32_t ahead = static_cast<int32_t>(end_seq - first_seq_);
+    if (ahead <= 0) return;
+    size_t n = static_cast<size_t>(ahead) < count_ ? static_cast<size_t>(ahead) : count_;
+    head_ = (head_ + n) % capacity_;
+    count_ -= n;
+    first_seq_ += static_cast<uint32_t>(n);
+}
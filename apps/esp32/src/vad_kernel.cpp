@@ -0,0 +1,91 @@
+#include "vad_kernel.h"
+
+#include <math.h>
+
+uint32_t vad_isqrt(uint64_t value) {
+    uint64_t result = 0;
+    uint64_t bit = 1ULL << 62;
+    while (bit > value) bit >>= 2;
+    while (bit != 0) {
+        if (value >= result + bit) {
+            value -= result + bit;
+            result = (result >> 1) + bit;
+        } else {
+            result >>= 1;
+        }
+        bit >>= 2;
+    }
+    return static_cast<uint32_t>(result);
+}
+
+void vad_compute_features(const int16_t* samples, size_t count, VadFeatures& out) {
+    out = VadFeatures();
+    if (count == 0) return;
+
+    uint64_t energy = 0;
+    uint64_t hf_energy = 0;
+    uint32_t crossings = 0;
+    int32_t prev = samples[0];
+
+    size_t i = 0;
+    for (; i + 1 < count; i += 2) {
+        int32_t a = samples[i];
+        int32_t b = samples[i + 1];
+        energy += static_cast<uint32_t>(a * a) + static_cast<uint32_t>(b * b);
+
+        // Halved differences keep each square within 2^30.
+        int32_t da = (a - prev) >> 1;
+        int32_t db = (b - a) >> 1;
+        hf_energy += static_cast<uint32_t>(da * da) + static_cast<uint32_t>(db * db);
+
+        crossings += static_cast<uint32_t>((a ^ prev) < 0) + static_cast<uint32_t>((b ^ a) < 0);
+        prev = b;
+    }
+    if (i < count) {
+        int32_t a = samples[i];
+        int32_t da = (a - prev) >> 1;
+        energy += static_cast<uint32_t>(a * a);
+        hf_energy += static_cast<uint32_t>(da * da);
+        crossings += static_cast<uint32_t>((a ^ prev) < 0);
+    }
+
+    uint32_t rms = vad_isqrt(energy / count);
+    uint32_t hf_rms = vad_isqrt(hf_energy / count) * 2;
+    out.rms = static_cast<uint16_t>(rms > 0xFFFF ? 0xFFFF : rms);
+    out.hf_rms = static_cast<uint16_t>(hf_rms > 0xFFFF ? 0xFFFF : hf_rms);
+    out.zero_crossings = static_cast<uint16_t>(crossings > 0xFFFF ? 0xFFFF : crossings);
+}
+
+float vad_reference_rms(const int16_t* samples, size_t count) {
+    if (count == 0) return 0.0f;
+    uint64_t sum = 0;
+    for (size_t i = 0; i < count; i++) {
+        int32_t s = samples[i];
+        sum += static_cast<uint64_t>(s) * static_cast<uint64_t>(s);
+    }
+    float mean = static_cast<float>(sum) / static_cast<float>(count);
+    return sqrtf(mean);
+}
+
+void vad_reference_features(const int16_t* samples, size_t count, VadFeatures& out) {
+    out = VadFeatures();
+    if (count == 0) return;
+
+    float rms = vad_reference_rms(samples, count);
+
+    uint64_t hf_sum = 0;
+    for (size_t i = 1; i < count; i++) {
+        int64_t d = static_cast<int64_t>(samples[i]) - samples[i - 1];
+        hf_sum += static_cast<uint64_t>(d * d);
+    }
+    float hf_rms = sqrtf(static_cast<float>(hf_sum) / static_cast<float>(count));
+
+    uint32_t crossings = 0;
+    for (size_t i = 1; i < count; i++) {
+        if ((samples[i] < 0) != (samples[i - 1] < 0)) crossings++;
+    }
+
+    out.rms = static_cast<uint16_t>(rms > 65535.0f ? 65535 : static_cast<uint32_t>(rms));
+    out.hf_rms = static_cast<uint16_t>(hf_rms > 65535.0f ? 65535 : static_cast<uint32_t>(hf_rms));
+    out.zero_crossings = static_cast<uint16_t>(crossings > 0xFFFF ? 0xFFFF : crossings);
+}
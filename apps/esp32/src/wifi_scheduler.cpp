@@ -0,0 +1,190 @@
+#include "wifi_scheduler.h"
+
+namespace {
+
+// Grace after connecting before an empty backlog closes the window, so
+// telemetry and a final ingest round get their turn.
+constexpr uint32_t kDrainGraceMs = 2000;
+
+uint32_t clamp_ms(uint64_t value, uint32_t lo, uint32_t hi) {
+    if (value < lo) return lo;
+    if (value > hi) return hi;
+    return static_cast<uint32_t>(value);
+}
+
+// Integer hash (lowbias32) so consecutive seeds and window counts spread
+// evenly over the jitter range.
+uint32_t mix32(uint32_t x) {
+    x ^= x >> 16;
+    x *= 0x7feb352dU;
+    x ^= x >> 15;
+    x *= 0x846ca68bU;
+    x ^= x >> 16;
+    return x;
+}
+
+uint32_t ewma(uint32_t average, uint32_t sample) {
+    return static_cast<uint32_t>((static_cast<uint64_t>(average) * 3 + sample) / 4);
+}
+
+}  // namespace
+
+const char* wifi_close_reason_name(WifiCloseReason reason) {
+    switch (reason) {
+    case WifiCloseReason::Drained:
+        return "drained";
+    case WifiCloseReason::Planned:
+        return "planned";
+    case WifiCloseReason::MaxWindow:
+        return "max_window";
+    case WifiCloseReason::Stalled:
+        return "stalled";
+    case WifiCloseReason::NoLink:
+        return "no_link";
+    case WifiCloseReason::None:
+        break;
+    }
+    return "none";
+}
+
+WifiScheduler::WifiScheduler(const WifiSchedulerConfig& config)
+    : config_(config), cooldown_ms_(config.cooldown_ms), ewma_bps_(config.default_bps ? config.default_bps : 1) {}
+
+void WifiScheduler::set_jitter_seed(uint32_t seed) {
+    jitter_seed_ = seed;
+    draw_jitter();
+}
+
+void WifiScheduler::draw_jitter() {
+    // Never spread past the interval, or interval-bound windows would open
+    // back to back.
+    uint32_t range = config_.jitter_ms < config_.interval_ms ? config_.jitter_ms : config_.interval_ms / 2;
+    jitter_offset_ms_ = range > 0 ? mix32(jitter_seed_ ^ mix32(windows_)) % range : 0;
+}
+
+uint32_t WifiScheduler::plan_ms(uint64_t backlog_bytes) const {
+    uint64_t drain_ms = backlog_bytes * 1000ULL / ewma_bps_;
+    // 25% headroom over the estimate; the plan is revisited when it runs out.
+    return clamp_ms(ewma_connect_ms_ + drain_ms + drain_ms / 4, config_.min_window_ms, config_.max_window_ms);
+}
+
+bool WifiScheduler::should_open(uint32_t now_ms, uint64_t backlog_bytes) const {
+    if (active_) return false;
+    if (!have_closed_) return now_ms >= jitter_offset_ms_;
+
+    uint32_t since = now_ms - last_close_ms_;
+    if (since < cooldown_ms_) return false;
+    if (since >= config_.interval_ms - jitter_offset_ms_) return true;
+    if (backlog_bytes == 0) return false;
+
+    // Early window only if the upload time at least matches the connect cost
+    // (or the backlog is large anyway); otherwise keep accumulating.
+    uint64_t drain_ms = backlog_bytes * 1000ULL / ewma_bps_;
+    return backlog_bytes >= config_.min_batch_bytes || drain_ms >= 2ULL * ewma_connect_ms_;
+}
+
+void WifiScheduler::open(uint32_t now_ms, uint64_t backlog_bytes, uint32_t uploaded_total, uint32_t items_total) {
+    active_ = true;
+    connected_ = false;
+    opened_ms_ = now_ms;
+    bytes_base_ = uploaded_total;
+    items_base_ = items_total;
+    slow_samples_ = 0;
+    current_ = WifiWindowStats();
+    current_.planned_ms = plan_ms(backlog_bytes);
+}
+
+void WifiScheduler::on_connected(uint32_t now_ms, int rssi) {
+    if (!active_ || connected_) return;
+    connected_ = true;
+    connected_ms_ = now_ms;
+    current_.connect_ms = now_ms - opened_ms_;
+    current_.rssi = static_cast<int8_t>(rssi < -128 ? -128 : (rssi > 0 ? 0 : rssi));
+    ewma_connect_ms_ = ewma(ewma_connect_ms_, current_.connect_ms);
+    sample_ms_ = now_ms;
+    sample_bytes_ = 0;
+    sample_busy_ms_ = 0;
+}
+
+void WifiScheduler::note_busy(uint32_t ms) {
+    if (!active_ || !connected_) return;
+    current_.busy_ms += ms;
+}
+
+WifiCloseReason WifiScheduler::poll(uint32_t now_ms, uint64_t backlog_bytes, uint32_t uploaded_total,
+                                    uint32_t items_total) {
+    if (!active_) return WifiCloseReason::None;
+    current_.bytes = uploaded_total - bytes_base_;
+    current_.items = items_total - items_base_;
+
+    uint32_t elapsed = now_ms - opened_ms_;
+    if (!connected_) {
+        return elapsed >= config_.connect_budget_ms ? WifiCloseReason::NoLink : WifiCloseReason::None;
+    }
+    if (backlog_bytes == 0 && now_ms - connected_ms_ >= kDrainGraceMs) return WifiCloseReason::Drained;
+    if (elapsed >= config_.max_window_ms) return WifiCloseReason::MaxWindow;
+
+    // Sample and plan against the time uploads actually had: a window that
+    // spent half of its connected time on other work is not a slow link.
+    uint32_t up_ms = now_ms - connected_ms_;
+    uint32_t avail_ms = up_ms > current_.busy_ms ? up_ms - current_.busy_ms : 0;
+    uint32_t sample_avail = now_ms - sample_ms_;
+    uint32_t sample_busy = current_.busy_ms - sample_busy_ms_;
+    sample_avail = sample_avail > sample_busy ? sample_avail - sample_busy : 0;
+    if (sample_avail >= config_.stall_sample_ms) {
+        uint32_t delta = current_.bytes - sample_bytes_;
+        uint64_t bps = static_cast<uint64_t>(delta) * 1000ULL / sample_avail;
+        slow_samples_ = bps < config_.stall_min_bps ? slow_samples_ + 1 : 0;
+        sample_ms_ = now_ms;
+        sample_bytes_ = current_.bytes;
+        sample_busy_ms_ = current_.busy_ms;
+        if (slow_samples_ >= 2) return WifiCloseReason::Stalled;
+    }
+
+    uint32_t avail_elapsed = elapsed > current_.busy_ms ? elapsed - current_.busy_ms : 0;
+    if (avail_elapsed >= current_.planned_ms) {
+        // Replan from what this window actually achieved. If it moved less
+        // than half of what the plan assumed, the link is worse than the
+        // estimate; stop and retry later rather than idling on air.
+        uint64_t expected = static_cast<uint64_t>(ewma_bps_) * avail_ms / 1000ULL;
+        if (current_.bytes * 2ULL < expected) return WifiCloseReason::Planned;
+        uint32_t bps = avail_ms > 0 ? static_cast<uint32_t>(static_cast<uint64_t>(current_.bytes) * 1000ULL / avail_ms) : 0;
+        uint64_t drain_ms = bps > 0 ? backlog_bytes * 1000ULL / bps : config_.min_window_ms;
+        current_.planned_ms = clamp_ms(avail_elapsed + drain_ms + drain_ms / 4, avail_elapsed + 1, config_.max_window_ms);
+    }
+    return WifiCloseReason::None;
+}
+
+void WifiScheduler::close(uint32_t now_ms, WifiCloseReason reason) {
+    if (!active_) return;
+    current_.duration_ms = now_ms - opened_ms_;
+    current_.reason = reason;
+    if (connected_) {
+        uint32_t up_ms = now_ms - connected_ms_;
+        uint32_t avail_ms = up_ms > current_.busy_ms ? up_ms - current_.busy_ms : 0;
+        if (avail_ms > 0) {
+            current_.throughput_bps = static_cast<uint32_t>(static_cast<uint64_t>(current_.bytes) * 1000ULL / avail_ms);
+        }
+        // Tiny windows say more about request latency than link speed.
+        if (current_.bytes >= 16 * 1024 && current_.throughput_bps > 0) {
+            ewma_bps_ = ewma(ewma_bps_, current_.throughput_bps);
+        }
+    }
+
+    bool poor = reason == WifiCloseReason::NoLink || reason == WifiCloseReason::Stalled ||
+                (connected_ && current_.rssi <= config_.weak_rssi);
+    if (poor) {
+        uint32_t doubled = cooldown_ms_ * 2;
+        cooldown_ms_ = doubled > config_.interval_ms ? config_.interval_ms : doubled;
+    } else {
+        cooldown_ms_ = config_.cooldown_ms;
+    }
+
+    last_ = current_;
+    active_ = false;
+    connected_ = false;
+    have_closed_ = true;
+    last_close_ms_ = now_ms;
+    windows_++;
+    draw_jitter();
+}
@@ -87,6 +87,13 @@ class Settings(BaseSettings):
     # Device auth (ESP32)
     device_token_secret: str = Field(default="dev-device-token-secret")
     device_pairing_code_ttl_minutes: int = Field(default=10, ge=1)
+    device_upload_order: Literal["oldest", "newest", "smallest", "paired"] = "oldest"
+    # Device audio clips scored below this speech confidence (0-100) skip the
+    # expensive pipeline steps (transcription, understanding).
+    device_audio_min_speech_confidence: int = Field(default=30, ge=0, le=100)
+    # Items per grouped processing job from /devices/ingest/batch, so a fleet
+    # reconnecting at once enqueues a few jobs per device rather than one per item.
+    device_ingest_group_size: int = Field(default=8, ge=1)
 
     # Google Photos OAuth
     google_photos_client_id: Optional[str] = None
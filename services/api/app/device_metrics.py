@@ -0,0 +1,149 @@
+"""Prometheus metrics built from device telemetry reports."""
+
+from __future__ import annotations
+
+from typing import TYPE_CHECKING
+
+from prometheus_client import Counter, Gauge, Histogram
+
+if TYPE_CHECKING:  # pragma: no cover - typing only
+    from .routes.devices import DeviceItemTiming, TelemetryRequest, TelemetrySamples
+
+
+# Upper bounds of the firmware's decade buckets, in seconds; the last one is open.
+OP_BUCKET_BOUNDS = ("0.0001", "0.001", "0.01", "0.1", "1", "+Inf")
+
+# Firmware ops arrive as deltas since the device's last accepted report, so
+# they map onto counters. Buckets are cumulative per `le` as in a native
+# histogram: histogram_quantile(0.99, sum by (le, op) (rate(..._bucket_total[5m]))).
+DEVICE_OP_BUCKETS = Counter(
+    "lifelog_device_op_duration_bucket",
+    "Device-side operation durations, cumulative per upper bound",
+    ["op", "le"],
+)
+DEVICE_OP_SECONDS = Counter(
+    "lifelog_device_op_duration_seconds",
+    "Total device-side time spent per operation",
+    ["op"],
+)
+DEVICE_OP_COUNT = Counter(
+    "lifelog_device_op",
+    "Device-side operations recorded",
+    ["op"],
+)
+DEVICE_OP_MAX = Gauge(
+    "lifelog_device_op_max_seconds",
+    "Slowest operation in the device's last report",
+    ["device", "op"],
+)
+DEVICE_EVENTS = Counter(
+    "lifelog_device_events",
+    "Device-side event counters (I2S overruns, dropped frames, VAD false starts)",
+    ["event"],
+)
+DEVICE_GAUGES = Gauge(
+    "lifelog_device_state",
+    "Latest device health values (heap, PSRAM, SD, backlog, RSSI, VAD threshold)",
+    ["device", "metric"],
+)
+DEVICE_SAMPLES = Counter(
+    "lifelog_device_telemetry_samples",
+    "Buffered device samples received, or overwritten on the device before upload",
+    ["kind"],
+)
+DEVICE_BOOT = Gauge(
+    "lifelog_device_boot_milestone_seconds",
+    "Time from firmware start to each boot milestone in the device's last boot",
+    ["device", "stage"],
+)
+
+DEVICE_STAGE_SECONDS = Histogram(
+    "lifelog_device_pipeline_stage_seconds",
+    "Device-side time per pipeline stage, reported with each ingested item",
+    ["stage"],
+    # Items can sit on the card for hours between Wi-Fi windows.
+    buckets=(0.1, 1, 5, 30, 60, 300, 900, 1800, 3600, 7200, 21600, 86400),
+)
+
+_GAUGE_FIELDS = ("sd_free_mb", "backlog_count", "backlog_bytes", "wifi_rssi", "battery_mv", "vad_start_mult")
+_PERF_GAUGE_FIELDS = ("heap_free", "heap_min", "heap_max_alloc", "psram_free", "psram_min")
+_BOOT_STAGES = ("audio", "camera", "sd", "first_frame", "setup", "index")
+# Sample field -> (gauge metric, scale).
+_SAMPLE_GAUGES = {
+    "backlog_count": ("backlog_count", 1),
+    "backlog_kb": ("backlog_bytes", 1024),
+    "sd_free_mb": ("sd_free_mb", 1),
+    "heap_free_kb": ("heap_free", 1024),
+}
+_SAMPLE_FLAG_WIFI = 0x01
+# Ingest timing field -> stage label.
+_TIMING_STAGES = {"queue_ms": "device_queue", "wait_ms": "device_wait", "upload_ms": "device_upload"}
+_samples_dropped: dict[str, int] = {}
+
+
+def _record_samples(device_id: str, samples: "TelemetrySamples") -> None:
+    DEVICE_SAMPLES.labels(kind="received").inc(len(samples.rows))
+    if samples.dropped is not None:
+        # Overwrites since boot; a smaller count means the device restarted.
+        previous = _samples_dropped.get(device_id, 0)
+        new_drops = samples.dropped - previous if samples.dropped >= previous else samples.dropped
+        if new_drops > 0:
+            DEVICE_SAMPLES.labels(kind="dropped").inc(new_drops)
+        _samples_dropped[device_id] = samples.dropped
+
+    latest = samples.latest()
+    for field, (metric, scale) in _SAMPLE_GAUGES.items():
+        if field in latest:
+            DEVICE_GAUGES.labels(device=device_id, metric=metric).set(latest[field] * scale)
+    if latest.get("flags", 0) & _SAMPLE_FLAG_WIFI:
+        DEVICE_GAUGES.labels(device=device_id, metric="wifi_rssi").set(latest.get("rssi", 0))
+
+
+def record_device_telemetry(device_id: str, report: "TelemetryRequest") -> None:
+    # Buffered samples first, so values measured at send time win.
+    if report.samples is not None:
+        _record_samples(device_id, report.samples)
+    for field in _GAUGE_FIELDS:
+        value = getattr(report, field)
+        if value is not None:
+            DEVICE_GAUGES.labels(device=device_id, metric=field).set(value)
+
+    boot = report.boot
+    if boot is not None:
+        for stage in _BOOT_STAGES:
+            value = getattr(boot, f"{stage}_ms")
+            if value:
+                DEVICE_BOOT.labels(device=device_id, stage=stage).set(value / 1000)
+
+    perf = report.perf
+    if perf is None:
+        return
+    for field in _PERF_GAUGE_FIELDS:
+        value = getattr(perf, field)
+        if value is not None:
+            DEVICE_GAUGES.labels(device=device_id, metric=field).set(value)
+
+    for op, row in perf.ops.items():
+        # [count, total_us, max_us, hist...]
+        if len(row) < 3:
+            continue
+        count, total_us, max_us = row[0], row[1], row[2]
+        hist = row[3 : 3 + len(OP_BUCKET_BOUNDS)]
+        DEVICE_OP_COUNT.labels(op=op).inc(count)
+        DEVICE_OP_SECONDS.labels(op=op).inc(total_us / 1_000_000)
+        DEVICE_OP_MAX.labels(device=device_id, op=op).set(max_us / 1_000_000)
+        cumulative = 0
+        for bound, bucket in zip(OP_BUCKET_BOUNDS, hist):
+            cumulative += bucket
+            DEVICE_OP_BUCKETS.labels(op=op, le=bound).inc(cumulative)
+
+    for event, count in perf.events.items():
+        if count > 0:
+            DEVICE_EVENTS.labels(event=event).inc(count)
+
+
+def record_device_item_timing(timing: "DeviceItemTiming") -> None:
+    for field, stage in _TIMING_STAGES.items():
+        value = getattr(timing, field)
+        if value is not None:
+            DEVICE_STAGE_SECONDS.labels(stage=stage).observe(value / 1000)
@@ -162,9 +162,21 @@ async def run_pipeline(
     artifacts = PipelineArtifacts(ArtifactStore(session, item))
     steps = get_pipeline_steps(item.item_type)
     logger.info("Pipeline start item={} steps={}", item.id, [step.name for step in steps])
+    skip_reason = "dedupe"
+    speech_confidence = payload.get("speech_confidence")
+    if (
+        item.item_type == "audio"
+        and speech_confidence is not None
+        and speech_confidence < settings.device_audio_min_speech_confidence
+    ):
+        # The device's speech detector found little speech in this clip.
+        artifacts.skip_expensive = True
+        skip_reason = "low_speech_confidence"
+    step_ms: dict[str, int] = {}
+    artifacts.set("step_ms", step_ms)
     for step in steps:
         if artifacts.skip_expensive and step.is_expensive:
-            logger.info("Pipeline step skipped item={} step={} reason=dedupe", item.id, step.name)
+            logger.info("Pipeline step skipped item={} step={} reason={}", item.id, step.name, skip_reason)
             continue
         started = perf_counter()
         logger.info("Pipeline step start item={} step={} version={}", item.id, step.name, step.version)
@@ -178,6 +190,7 @@ async def run_pipeline(
         if not skip_before and artifacts.skip_expensive:
             logger.info("Pipeline skip_expensive enabled item={} step={}", item.id, step.name)
         elapsed_ms = int((perf_counter() - started) * 1000)
+        step_ms[step.name] = elapsed_ms
         logger.info("Pipeline step done item={} step={} duration_ms={}", item.id, step.name, elapsed_ms)
         if settings.pipeline_log_details:
             details = _step_details(step.name, item, artifacts)
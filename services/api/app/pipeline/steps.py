@@ -968,6 +968,13 @@ class DedupStep:
     is_expensive = False
 
     async def run(self, item: SourceItem, artifacts: PipelineArtifacts, config: PipelineConfig) -> None:
+        if (
+            config.payload.get("device_tier") == "thumbnail"
+            and item.canonical_item_id is not None
+            and item.canonical_item_id != item.id
+        ):
+            # Linked at ingest to the full frame of the same capture.
+            return
         content_hash = artifacts.get("content_hash") or item.content_hash
         if not content_hash:
             if item.canonical_item_id is None:
@@ -1032,6 +1039,10 @@ class DedupStep:
         result = await config.session.execute(stmt)
         candidates = result.scalars().all()
         for candidate in candidates:
+            if candidate.canonical_item_id == item.id:
+                # Another rendition of this capture (a device thumbnail linked
+                # to this full frame) or an earlier duplicate of it.
+                continue
             distance = hamming_distance_hex(item.phash, candidate.phash or "")
             if distance is None:
                 continue
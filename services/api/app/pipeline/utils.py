@@ -6,7 +6,7 @@ from datetime import datetime, timezone
 import hashlib
 import io
 import re
-from typing import Iterable, Optional
+from typing import Any, Iterable, Optional
 
 
 def hash_bytes(value: bytes) -> str:
@@ -35,6 +35,46 @@ def parse_iso_datetime(value: Optional[str]) -> Optional[datetime]:
     return dt
 
 
+# Device timing field -> stage name in the recorded timing.
+_DEVICE_TIMING_STAGES = {"queue_ms": "device_queue", "wait_ms": "device_wait", "upload_ms": "device_upload"}
+
+
+def build_pipeline_timing(
+    payload: dict[str, Any],
+    started_at: datetime,
+    completed_at: datetime,
+    step_ms: Optional[dict[str, int]] = None,
+) -> Optional[dict[str, Any]]:
+    """Per-stage durations for one processed device item, in milliseconds.
+
+    Device stages are durations reported by the device; server stages are
+    measured from the ingest time stamped into the payload. End-to-end is
+    their sum, so it never mixes the two clocks.
+    """
+
+    ingested_at = parse_iso_datetime(payload.get("ingested_at"))
+    if ingested_at is None:
+        return None
+    stages: dict[str, int] = {}
+    device_timing = payload.get("device_timing") or {}
+    for field, stage in _DEVICE_TIMING_STAGES.items():
+        value = device_timing.get(field)
+        if isinstance(value, int) and value >= 0:
+            stages[stage] = value
+    stages["api_queue"] = max(0, int((started_at - ingested_at).total_seconds() * 1000))
+    stages["processing"] = max(0, int((completed_at - started_at).total_seconds() * 1000))
+    timing: dict[str, Any] = {
+        "stages": stages,
+        "end_to_end_ms": sum(stages.values()),
+        "completed_at": completed_at.isoformat(),
+    }
+    if step_ms:
+        timing["steps"] = dict(step_ms)
+    if "attempts" in device_timing:
+        timing["attempts"] = device_timing["attempts"]
+    return timing
+
+
 def parse_exif_datetime(value: Optional[str]) -> Optional[datetime]:
     if not value:
         return None
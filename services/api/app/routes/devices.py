@@ -2,6 +2,7 @@
 
 from __future__ import annotations
 
+import asyncio
 import base64
 import hashlib
 import hmac
@@ -11,23 +12,32 @@ from typing import Optional
 from urllib.parse import urlparse
 from uuid import UUID, uuid4
 
-from fastapi import APIRouter, Depends, Header, HTTPException
+from fastapi import APIRouter, Depends, Header, HTTPException, Query
 from pydantic import BaseModel, Field
 from enum import Enum
-from sqlalchemy import select
+from sqlalchemy import and_, select
 from sqlalchemy.ext.asyncio import AsyncSession
 
 from ..auth import get_current_user_id
 from ..config import get_settings
-from ..db.models import Device, SourceItem, User
+from ..db.models import DerivedArtifact, Device, SourceItem, User
 from ..db.session import get_session
+from ..device_metrics import record_device_item_timing, record_device_telemetry
 from ..routes.storage import sanitize_filename
-from ..storage import get_storage_provider
-from ..tasks.process_item import process_item
+from ..storage import StorageObjectNotFound, get_storage_provider
+from ..tasks.process_item import process_item, process_items
 
 
 router = APIRouter()
 
+# Resumable device uploads stage fixed-size parts as separate objects and
+# assemble them server-side, which works with every presigned-PUT provider.
+# Assembly holds the parts and the joined object in memory, so the limits
+# stay at what the firmware sends (UPLOAD_MAX_PARTS x UPLOAD_PART_BYTES).
+MIN_UPLOAD_PART_BYTES = 64 * 1024
+MAX_UPLOAD_PART_BYTES = 256 * 1024
+MAX_UPLOAD_PARTS = 16
+
 
 def _hash_token(token: str, secret: str) -> str:
     return hmac.new(secret.encode("utf-8"), token.encode("utf-8"), hashlib.sha256).hexdigest()
@@ -106,6 +116,22 @@ class DeviceItemType(str, Enum):
     document = "document"
 
 
+class DeviceTier(str, Enum):
+    """Which rendition of a capture a device item is."""
+
+    full = "full"
+    thumbnail = "thumbnail"
+
+
+class UploadOrder(str, Enum):
+    """Order in which a device drains its pending queue."""
+
+    oldest = "oldest"
+    newest = "newest"
+    smallest = "smallest"
+    paired = "paired"
+
+
 class UploadUrlRequest(BaseModel):
     filename: str = Field(..., description="Original filename for key generation")
     content_type: str = Field(default="image/jpeg", description="MIME type")
@@ -121,6 +147,16 @@ class UploadUrlResponse(BaseModel):
     upload_headers: dict[str, str] = Field(default_factory=dict)
 
 
+class DeviceItemTiming(BaseModel):
+    """Device-side stage durations, measured on the device's monotonic clock so
+    they survive clock skew and missing NTP."""
+
+    queue_ms: Optional[int] = Field(default=None, ge=0, description="Capture to manifest enqueue")
+    wait_ms: Optional[int] = Field(default=None, ge=0, description="Enqueue to upload claim")
+    upload_ms: Optional[int] = Field(default=None, ge=0, description="Upload claim to ingest request")
+    attempts: Optional[int] = Field(default=None, ge=0, description="Upload attempts, this one included")
+
+
 class DeviceIngestRequest(BaseModel):
     object_key: str = Field(..., description="Key/path in object storage")
     seq: int = Field(..., ge=0, description="Monotonic device sequence id")
@@ -129,6 +165,14 @@ class DeviceIngestRequest(BaseModel):
     content_type: Optional[str] = Field(default=None, description="MIME type")
     original_filename: Optional[str] = Field(default=None, description="Original filename if available")
     item_type: Optional["DeviceItemType"] = Field(default=None, description="Asset type")
+    tier: Optional[DeviceTier] = Field(default=None, description="Rendition when the capture has several")
+    linked_seq: Optional[int] = Field(
+        default=None, ge=0, description="Seq of the other rendition of the same capture"
+    )
+    speech_confidence: Optional[int] = Field(
+        default=None, ge=0, le=100, description="On-device speech detector confidence for audio clips"
+    )
+    timing: Optional[DeviceItemTiming] = Field(default=None, description="Device-side pipeline timing")
 
 
 class DeviceIngestResponse(BaseModel):
@@ -137,20 +181,180 @@ class DeviceIngestResponse(BaseModel):
     task_id: Optional[str] = None
 
 
+class UploadUrlBatchRequest(BaseModel):
+    items: list[UploadUrlRequest] = Field(default_factory=list, min_length=1)
+
+
+class UploadUrlBatchItemResponse(BaseModel):
+    index: int
+    status: str
+    seq: Optional[int] = None
+    upload_host: Optional[str] = None
+    upload_port: Optional[int] = None
+    upload_path: Optional[str] = None
+    object_key: Optional[str] = None
+    error: Optional[str] = None
+
+
+class UploadUrlBatchResponse(BaseModel):
+    results: list[UploadUrlBatchItemResponse]
+
+
+class UploadPartsRequest(BaseModel):
+    seq: int = Field(..., ge=0, description="Device sequence id of the item being uploaded")
+    content_type: str = Field(default="application/octet-stream", description="MIME type of the parts")
+    size_bytes: int = Field(..., gt=0, description="Total size of the assembled object")
+    part_size: int = Field(..., ge=MIN_UPLOAD_PART_BYTES, le=MAX_UPLOAD_PART_BYTES)
+    first_part: int = Field(default=0, ge=0, description="First part that still needs a URL")
+
+
+class UploadPartTarget(BaseModel):
+    part_number: int
+    upload_host: str
+    upload_port: int
+    upload_path: str
+
+
+class UploadPartsResponse(BaseModel):
+    part_size: int
+    part_count: int
+    parts: list[UploadPartTarget]
+
+
+class UploadPartsCompleteRequest(BaseModel):
+    seq: int = Field(..., ge=0)
+    filename: str = Field(..., description="Original filename for key generation")
+    content_type: str = Field(default="application/octet-stream")
+    size_bytes: int = Field(..., gt=0)
+    part_size: int = Field(..., ge=MIN_UPLOAD_PART_BYTES, le=MAX_UPLOAD_PART_BYTES)
+    path_date: Optional[date] = Field(default=None, description="Optional date for path prefix (YYYY-MM-DD)")
+
+
+class UploadPartsCompleteResponse(BaseModel):
+    object_key: str
+    size_bytes: int
+
+
+class DeviceIngestBatchRequest(BaseModel):
+    items: list[DeviceIngestRequest] = Field(default_factory=list, min_length=1)
+
+
+class DeviceIngestBatchItemResponse(BaseModel):
+    index: int
+    seq: int
+    status: str
+    item_id: Optional[str] = None
+    task_id: Optional[str] = None
+    error: Optional[str] = None
+
+
+class DeviceIngestBatchResponse(BaseModel):
+    accepted: int
+    duplicates: int
+    failed: int
+    results: list[DeviceIngestBatchItemResponse]
+
+
+class TelemetryWifiWindow(BaseModel):
+    """Stats for the device's most recent Wi-Fi upload window."""
+
+    connect_ms: Optional[int] = None
+    duration_ms: Optional[int] = None
+    busy_ms: Optional[int] = None
+    planned_ms: Optional[int] = None
+    bytes: Optional[int] = None
+    items: Optional[int] = None
+    throughput_bps: Optional[int] = None
+    rssi: Optional[int] = None
+    close_reason: Optional[str] = None
+    ewma_bps: Optional[int] = None
+    windows: Optional[int] = None
+
+
+class TelemetryWifiConnect(BaseModel):
+    """Device Wi-Fi association times, bucketed <250/<500/<1000/<2000/<4000/>=4000 ms."""
+
+    fast_hist: list[int] = Field(default_factory=list)
+    scan_hist: list[int] = Field(default_factory=list)
+    fast_misses: Optional[int] = None
+    failures: Optional[int] = None
+
+
+class TelemetryPerf(BaseModel):
+    """Device performance counters accumulated since its last accepted report."""
+
+    interval_ms: Optional[int] = None
+    # op -> [count, total_us, max_us, <100us, <1ms, <10ms, <100ms, <1s, >=1s]
+    ops: dict[str, list[int]] = Field(default_factory=dict)
+    events: dict[str, int] = Field(default_factory=dict)
+    heap_free: Optional[int] = None
+    heap_min: Optional[int] = None
+    heap_max_alloc: Optional[int] = None
+    psram_free: Optional[int] = None
+    psram_min: Optional[int] = None
+
+
+class TelemetryBoot(BaseModel):
+    """Device boot milestones, in ms since the firmware started (0 = not reached)."""
+
+    reset_reason: Optional[str] = None
+    fast: Optional[bool] = None
+    audio_ms: Optional[int] = None
+    camera_ms: Optional[int] = None
+    sd_ms: Optional[int] = None
+    first_frame_ms: Optional[int] = None
+    setup_ms: Optional[int] = None
+    index_ms: Optional[int] = None
+
+
+class TelemetrySamples(BaseModel):
+    """Periodic samples the device buffered while its radio was off, oldest first."""
+
+    first_seq: Optional[int] = None
+    dropped: Optional[int] = None
+    fields: list[str] = Field(default_factory=list)
+    rows: list[list[int]] = Field(default_factory=list)
+
+    def latest(self) -> dict[str, int]:
+        if not self.rows:
+            return {}
+        return dict(zip(self.fields, self.rows[-1]))
+
+
 class TelemetryRequest(BaseModel):
     uptime_seconds: Optional[int] = None
     sd_used_mb: Optional[int] = None
     sd_free_mb: Optional[int] = None
     backlog_count: Optional[int] = None
+    backlog_bytes: Optional[int] = None
     battery_mv: Optional[int] = None
     wifi_rssi: Optional[int] = None
     firmware_version: Optional[str] = None
+    vad_start_mult: Optional[float] = None
+    wifi_window: Optional[TelemetryWifiWindow] = None
+    wifi_connect: Optional[TelemetryWifiConnect] = None
+    perf: Optional[TelemetryPerf] = None
+    boot: Optional[TelemetryBoot] = None
+    samples: Optional[TelemetrySamples] = None
 
 
 class TelemetryResponse(BaseModel):
     status: str = "ok"
 
 
+class DeviceItemTimingStatus(BaseModel):
+    seq: int
+    status: str
+    item_id: Optional[str] = None
+    stages: dict[str, int] = Field(default_factory=dict)
+    steps: dict[str, int] = Field(default_factory=dict)
+    end_to_end_ms: Optional[int] = None
+
+
+class DeviceTimingResponse(BaseModel):
+    items: list[DeviceItemTimingStatus] = Field(default_factory=list)
+
+
 class DeviceConfigResponse(BaseModel):
     version: int = 1
     capture_interval_sec: int = 30
@@ -158,6 +362,7 @@ class DeviceConfigResponse(BaseModel):
     sd_min_free_percent: int = 15
     burst_enabled: bool = False
     burst_interval_sec: int = 180
+    upload_order: UploadOrder = UploadOrder.oldest
 
 
 @router.post("/pair", response_model=PairResponse)
@@ -241,23 +446,36 @@ async def activate_device(
     return ActivateResponse(device_id=device.id, device_token=device_token)
 
 
-@router.post("/upload-url", response_model=UploadUrlResponse)
-async def get_device_upload_url(
-    request: UploadUrlRequest,
-    device: Device = Depends(_get_current_device),
-) -> UploadUrlResponse:
-    settings = get_settings()
-    storage = get_storage_provider()
+def _check_batch_size(count: int, settings) -> None:
+    if count > settings.ingest_batch_limit:
+        raise HTTPException(
+            status_code=413,
+            detail=f"Batch exceeds max size of {settings.ingest_batch_limit} items",
+        )
 
-    safe_name = sanitize_filename(request.filename)
-    prefix = f"devices/{device.id}"
-    path_date = request.path_date or datetime.now(timezone.utc).date()
-    prefix = f"{prefix}/{path_date:%Y/%m/%d}"
 
-    if request.seq is not None:
-        key = f"{prefix}/{request.seq}-{safe_name}"
-    else:
-        key = f"{prefix}/{uuid4()}-{safe_name}"
+def _device_object_key(device: Device, filename: str, seq: Optional[int], path_date: Optional[date]) -> str:
+    safe_name = sanitize_filename(filename)
+    path_date = path_date or datetime.now(timezone.utc).date()
+    prefix = f"devices/{device.id}/{path_date:%Y/%m/%d}"
+    if seq is not None:
+        return f"{prefix}/{seq}-{safe_name}"
+    return f"{prefix}/{uuid4()}-{safe_name}"
+
+
+def _device_part_key(device: Device, seq: int, part_number: int) -> str:
+    return f"devices/{device.id}/parts/{seq}/{part_number:04d}"
+
+
+def _part_count(size_bytes: int, part_size: int) -> int:
+    count = (size_bytes + part_size - 1) // part_size
+    if count > MAX_UPLOAD_PARTS:
+        raise HTTPException(status_code=413, detail=f"Upload exceeds max of {MAX_UPLOAD_PARTS} parts")
+    return count
+
+
+def _build_upload_target(request: UploadUrlRequest, device: Device, settings, storage) -> UploadUrlResponse:
+    key = _device_object_key(device, request.filename, request.seq, request.path_date)
 
     signed = storage.get_presigned_upload(key, request.content_type, settings.presigned_url_ttl_seconds)
     if not signed.get("url"):
@@ -275,25 +493,7 @@ async def get_device_upload_url(
     )
 
 
-@router.post("/ingest", response_model=DeviceIngestResponse)
-async def ingest_device_item(
-    request: DeviceIngestRequest,
-    device: Device = Depends(_get_current_device),
-    session: AsyncSession = Depends(get_session),
-) -> DeviceIngestResponse:
-    settings = get_settings()
-    existing = await session.execute(
-        select(SourceItem).where(SourceItem.device_id == device.id, SourceItem.device_seq == request.seq)
-    )
-    existing_item = existing.scalar_one_or_none()
-    if existing_item:
-        return DeviceIngestResponse(status="duplicate", item_id=str(existing_item.id))
-
-    user = await session.get(User, device.user_id)
-    if user is None:
-        user = User(id=device.user_id)
-        session.add(user)
-
+def _build_device_item(request: DeviceIngestRequest, device: Device) -> tuple[SourceItem, dict]:
     content_type = request.content_type
     if not content_type:
         if request.object_key.lower().endswith(".wav"):
@@ -330,8 +530,6 @@ async def ingest_device_item(
         original_filename=original_filename,
         processing_status="pending",
     )
-    session.add(source_item)
-    await session.commit()
 
     payload = {
         "item_id": str(item_id),
@@ -342,21 +540,320 @@ async def ingest_device_item(
         "content_type": content_type,
         "original_filename": original_filename,
     }
+    if request.tier:
+        payload["device_tier"] = request.tier.value
+    if request.speech_confidence is not None:
+        payload["speech_confidence"] = request.speech_confidence
+    # The worker measures its queue wait and end-to-end latency from here.
+    payload["ingested_at"] = datetime.now(timezone.utc).isoformat()
+    if request.timing is not None:
+        payload["device_timing"] = request.timing.model_dump(exclude_none=True)
+        record_device_item_timing(request.timing)
+    return source_item, payload
+
+
+def _link_device_tier(
+    source_item: SourceItem, request: DeviceIngestRequest, items_by_seq: dict[int, SourceItem]
+) -> None:
+    """Point a thumbnail at the full frame of the same capture, whichever arrives first.
+
+    Both rows must already be flushed: the link is a foreign key.
+    """
+
+    if request.tier is None or request.linked_seq is None:
+        return
+    other = items_by_seq.get(request.linked_seq)
+    if other is None:
+        return
+    if request.tier == DeviceTier.thumbnail:
+        source_item.canonical_item_id = other.id
+    else:
+        other.canonical_item_id = source_item.id
+
+
+async def _ensure_device_user(session: AsyncSession, device: Device) -> None:
+    user = await session.get(User, device.user_id)
+    if user is None:
+        session.add(User(id=device.user_id))
+
+
+@router.post("/upload-url", response_model=UploadUrlResponse)
+async def get_device_upload_url(
+    request: UploadUrlRequest,
+    device: Device = Depends(_get_current_device),
+) -> UploadUrlResponse:
+    return _build_upload_target(request, device, get_settings(), get_storage_provider())
+
+
+@router.post("/upload-url/batch", response_model=UploadUrlBatchResponse)
+async def get_device_upload_urls(
+    request: UploadUrlBatchRequest,
+    device: Device = Depends(_get_current_device),
+) -> UploadUrlBatchResponse:
+    """Sign upload targets for several items in one round trip."""
+
+    settings = get_settings()
+    _check_batch_size(len(request.items), settings)
+    storage = get_storage_provider()
+
+    results: list[UploadUrlBatchItemResponse] = []
+    for index, item in enumerate(request.items):
+        try:
+            target = _build_upload_target(item, device, settings, storage)
+        except HTTPException as exc:
+            results.append(
+                UploadUrlBatchItemResponse(index=index, status="error", seq=item.seq, error=str(exc.detail))
+            )
+            continue
+        results.append(
+            UploadUrlBatchItemResponse(
+                index=index,
+                status="ok",
+                seq=item.seq,
+                upload_host=target.upload_host,
+                upload_port=target.upload_port,
+                upload_path=target.upload_path,
+                object_key=target.object_key,
+            )
+        )
+    return UploadUrlBatchResponse(results=results)
+
+
+@router.post("/upload-parts", response_model=UploadPartsResponse)
+async def get_device_upload_parts(
+    request: UploadPartsRequest,
+    device: Device = Depends(_get_current_device),
+) -> UploadPartsResponse:
+    """Sign PUT targets for the parts of a resumable upload, from first_part on."""
+
+    settings = get_settings()
+    storage = get_storage_provider()
+    part_count = _part_count(request.size_bytes, request.part_size)
+
+    parts: list[UploadPartTarget] = []
+    for part_number in range(request.first_part, part_count):
+        key = _device_part_key(device, request.seq, part_number)
+        signed = storage.get_presigned_upload(key, request.content_type, settings.presigned_url_ttl_seconds)
+        if not signed.get("url"):
+            raise HTTPException(status_code=501, detail="Presigned upload URL not implemented for current provider.")
+        host, port, path = _split_upload_url(signed["url"])
+        parts.append(UploadPartTarget(part_number=part_number, upload_host=host, upload_port=port, upload_path=path))
+
+    return UploadPartsResponse(part_size=request.part_size, part_count=part_count, parts=parts)
+
+
+async def _fetch_staged(storage, key: str) -> bytes:
+    """Fetch a staged object; empty if it does not exist.
+
+    Any other storage failure becomes a 503, so the device retries the
+    complete call and keeps the parts it has already sent.
+    """
+
+    try:
+        return await asyncio.to_thread(storage.fetch, key)
+    except StorageObjectNotFound:
+        return b""
+    except Exception as exc:
+        raise HTTPException(status_code=503, detail="Storage unavailable; retry") from exc
+
+
+@router.post("/upload-parts/complete", response_model=UploadPartsCompleteResponse)
+async def complete_device_upload_parts(
+    request: UploadPartsCompleteRequest,
+    device: Device = Depends(_get_current_device),
+) -> UploadPartsCompleteResponse:
+    """Assemble staged parts into the final object and drop the parts.
+
+    Idempotent: if the parts are already gone but the assembled object is
+    present with the expected size, the earlier result is returned.
+    """
+
+    storage = get_storage_provider()
+    part_count = _part_count(request.size_bytes, request.part_size)
+    object_key = _device_object_key(device, request.filename, request.seq, request.path_date)
+
+    chunks: list[bytes] = []
+    for part_number in range(part_count):
+        data = await _fetch_staged(storage, _device_part_key(device, request.seq, part_number))
+        expected = min(request.part_size, request.size_bytes - part_number * request.part_size)
+        if len(data) != expected:
+            assembled = await _fetch_staged(storage, object_key)
+            if len(assembled) == request.size_bytes:
+                return UploadPartsCompleteResponse(object_key=object_key, size_bytes=request.size_bytes)
+            # Only a part that is really gone restarts the upload on the device.
+            raise HTTPException(status_code=409, detail=f"Missing or short part {part_number}")
+        chunks.append(data)
+
+    body = b"".join(chunks)
+    chunks.clear()
+    await asyncio.to_thread(storage.store, object_key, body, request.content_type)
+    for part_number in range(part_count):
+        try:
+            await asyncio.to_thread(storage.delete, _device_part_key(device, request.seq, part_number))
+        except Exception:  # pragma: no cover - leftover parts are harmless
+            pass
+
+    return UploadPartsCompleteResponse(object_key=object_key, size_bytes=request.size_bytes)
+
+
+@router.post("/ingest", response_model=DeviceIngestResponse)
+async def ingest_device_item(
+    request: DeviceIngestRequest,
+    device: Device = Depends(_get_current_device),
+    session: AsyncSession = Depends(get_session),
+) -> DeviceIngestResponse:
+    existing = await session.execute(
+        select(SourceItem).where(SourceItem.device_id == device.id, SourceItem.device_seq == request.seq)
+    )
+    existing_item = existing.scalar_one_or_none()
+    if existing_item:
+        return DeviceIngestResponse(status="duplicate", item_id=str(existing_item.id))
+
+    await _ensure_device_user(session, device)
+    source_item, payload = _build_device_item(request, device)
+    session.add(source_item)
+    if request.tier is not None and request.linked_seq is not None:
+        linked = await session.execute(
+            select(SourceItem).where(
+                SourceItem.device_id == device.id, SourceItem.device_seq == request.linked_seq
+            )
+        )
+        linked_item = linked.scalar_one_or_none()
+        if linked_item:
+            await session.flush()
+            _link_device_tier(source_item, request, {request.linked_seq: linked_item})
+    await session.commit()
 
     task = process_item.delay(payload)
-    return DeviceIngestResponse(status="queued", item_id=str(item_id), task_id=task.id)
+    return DeviceIngestResponse(status="queued", item_id=str(source_item.id), task_id=task.id)
+
+
+@router.post("/ingest/batch", response_model=DeviceIngestBatchResponse)
+async def ingest_device_items(
+    request: DeviceIngestBatchRequest,
+    device: Device = Depends(_get_current_device),
+    session: AsyncSession = Depends(get_session),
+) -> DeviceIngestBatchResponse:
+    """Persist several device items with one dedup query and one commit, and
+    enqueue them as grouped processing jobs."""
+
+    settings = get_settings()
+    _check_batch_size(len(request.items), settings)
+
+    seqs = {item.seq for item in request.items}
+    # Other renditions are looked up in the same query so they can be linked.
+    lookup = seqs | {item.linked_seq for item in request.items if item.linked_seq is not None}
+    existing = await session.execute(
+        select(SourceItem).where(SourceItem.device_id == device.id, SourceItem.device_seq.in_(lookup))
+    )
+    items_by_seq: dict[int, SourceItem] = {item.device_seq: item for item in existing.scalars().all()}
+    known: dict[int, str] = {seq: str(item.id) for seq, item in items_by_seq.items() if seq in seqs}
+
+    results: list[Optional[DeviceIngestBatchItemResponse]] = [None] * len(request.items)
+    new_entries: list[tuple[int, SourceItem, dict]] = []
+    for index, item in enumerate(request.items):
+        if item.seq in known:
+            results[index] = DeviceIngestBatchItemResponse(
+                index=index, seq=item.seq, status="duplicate", item_id=known[item.seq]
+            )
+            continue
+        source_item, payload = _build_device_item(item, device)
+        # A retried batch may repeat a seq; the first occurrence wins.
+        known[item.seq] = str(source_item.id)
+        items_by_seq[item.seq] = source_item
+        new_entries.append((index, source_item, payload))
+
+    if new_entries:
+        await _ensure_device_user(session, device)
+        session.add_all([source_item for _, source_item, _ in new_entries])
+        linked = [(index, source_item) for index, source_item, _ in new_entries
+                  if request.items[index].linked_seq in items_by_seq]
+        if linked:
+            await session.flush()
+            for index, source_item in linked:
+                _link_device_tier(source_item, request.items[index], items_by_seq)
+        await session.commit()
+
+        # One processing job per group instead of one per item; items in a
+        # group share its task id.
+        group_size = settings.device_ingest_group_size
+        for start in range(0, len(new_entries), group_size):
+            group = new_entries[start:start + group_size]
+            task = process_items.delay([payload for _, _, payload in group])
+            for index, source_item, _ in group:
+                results[index] = DeviceIngestBatchItemResponse(
+                    index=index,
+                    seq=source_item.device_seq,
+                    status="queued",
+                    item_id=str(source_item.id),
+                    task_id=task.id,
+                )
+
+    finalized = [entry for entry in results if entry is not None]
+    accepted = sum(1 for entry in finalized if entry.status == "queued")
+    duplicates = sum(1 for entry in finalized if entry.status == "duplicate")
+    return DeviceIngestBatchResponse(
+        accepted=accepted,
+        duplicates=duplicates,
+        failed=len(finalized) - accepted - duplicates,
+        results=finalized,
+    )
 
 
 @router.post("/telemetry", response_model=TelemetryResponse)
 async def ingest_telemetry(
-    _request: TelemetryRequest,
-    _device: Device = Depends(_get_current_device),
+    request: TelemetryRequest,
+    device: Device = Depends(_get_current_device),
 ) -> TelemetryResponse:
+    record_device_telemetry(str(device.id), request)
     return TelemetryResponse()
 
 
+@router.get("/timing", response_model=DeviceTimingResponse)
+async def get_device_timing(
+    seq: Optional[list[int]] = Query(default=None, description="Device seqs to look up"),
+    device: Device = Depends(_get_current_device),
+    session: AsyncSession = Depends(get_session),
+) -> DeviceTimingResponse:
+    """Processing status and per-stage timing of this device's items, by seq."""
+
+    if not seq:
+        return DeviceTimingResponse()
+    _check_batch_size(len(seq), get_settings())
+    rows = await session.execute(
+        select(SourceItem, DerivedArtifact.payload)
+        .outerjoin(
+            DerivedArtifact,
+            and_(
+                DerivedArtifact.source_item_id == SourceItem.id,
+                DerivedArtifact.artifact_type == "pipeline_timing",
+            ),
+        )
+        .where(SourceItem.device_id == device.id, SourceItem.device_seq.in_(set(seq)))
+    )
+    found = {item.device_seq: (item, timing) for item, timing in rows.fetchall()}
+    items: list[DeviceItemTimingStatus] = []
+    for value in seq:
+        if value not in found:
+            items.append(DeviceItemTimingStatus(seq=value, status="unknown"))
+            continue
+        item, timing = found[value]
+        timing = timing or {}
+        items.append(
+            DeviceItemTimingStatus(
+                seq=value,
+                status=item.processing_status,
+                item_id=str(item.id),
+                stages=timing.get("stages") or {},
+                steps=timing.get("steps") or {},
+                end_to_end_ms=timing.get("end_to_end_ms"),
+            )
+        )
+    return DeviceTimingResponse(items=items)
+
+
 @router.get("/config", response_model=DeviceConfigResponse)
 async def get_device_config(
     _device: Device = Depends(_get_current_device),
 ) -> DeviceConfigResponse:
-    return DeviceConfigResponse()
+    return DeviceConfigResponse(upload_order=get_settings().device_upload_order)
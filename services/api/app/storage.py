@@ -22,6 +22,11 @@ from loguru import logger
 from .config import Settings, get_settings
 
 
+class StorageObjectNotFound(KeyError):
+    """Raised by fetch() when the object does not exist, as opposed to the
+    store being unreachable."""
+
+
 class StorageProvider(Protocol):
     """Interface for generating presigned URLs and managing objects."""
 
@@ -137,6 +142,9 @@ class S3StorageProvider(StorageProvider):
         try:
             resp = self.client.get_object(Bucket=self._bucket(), Key=key)
         except ClientError as exc:
+            code = exc.response.get("Error", {}).get("Code")
+            if code in ("NoSuchKey", "404"):
+                raise StorageObjectNotFound(key) from exc
             logger.error("S3 fetch failed key={} error={}", key, exc)
             raise
         body = resp.get("Body")
@@ -293,6 +301,9 @@ class SupabaseStorageProvider(StorageProvider):
             "Authorization": f"Bearer {self.settings.supabase_service_role_key}",
         }
         resp = httpx.get(url, headers=headers, timeout=30)
+        # Older Supabase storage reports a missing object as a 400 "not_found".
+        if resp.status_code == 404 or (resp.status_code == 400 and "not_found" in resp.text):
+            raise StorageObjectNotFound(key)
         resp.raise_for_status()
         return resp.content
 
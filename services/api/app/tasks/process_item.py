@@ -3,8 +3,8 @@
 from __future__ import annotations
 
 import asyncio
-from datetime import datetime
-from typing import Any, Dict
+from datetime import datetime, timezone
+from typing import Any, Dict, List
 from uuid import UUID
 
 from loguru import logger
@@ -17,7 +17,7 @@ from ..db.models import ProcessedContext, SourceItem
 from ..db.session import isolated_session
 from ..integrations.openclaw_sync import get_openclaw_sync
 from ..pipeline import run_pipeline
-from ..pipeline.utils import parse_iso_datetime
+from ..pipeline.utils import build_pipeline_timing, parse_iso_datetime
 from ..user_settings import fetch_user_settings
 
 
@@ -80,12 +80,18 @@ async def _process_payload(payload: Dict[str, Any]) -> Dict[str, Any]:
         item.processing_status = "processing"
         item.processing_error = None
         await session.flush()
+        started_at = datetime.now(timezone.utc)
 
         try:
-            await run_pipeline(session, item, payload)
+            artifacts = await run_pipeline(session, item, payload)
             await _sync_openclaw_contexts_for_item(session, item)
             item.processing_status = "completed"
             item.processed_at = datetime.utcnow()
+            timing = build_pipeline_timing(
+                payload, started_at, datetime.now(timezone.utc), artifacts.get("step_ms")
+            )
+            if timing is not None:
+                await artifacts.store.upsert("pipeline_timing", "pipeline", "v1", "device", timing)
             await session.commit()
         except Exception as exc:
             await session.rollback()
@@ -115,3 +121,24 @@ def process_item(self, payload: Dict[str, Any]) -> Dict[str, Any]:
     except Exception as exc:  # pragma: no cover - propagate to retry logic
         logger.exception("Unhandled exception in process_item: {}", exc)
         raise
+
+
+async def _process_payloads(payloads: List[Dict[str, Any]]) -> Dict[str, Any]:
+    results: List[Dict[str, Any]] = []
+    failed = 0
+    for payload in payloads:
+        # Items are independent; one failure is recorded on its row and does
+        # not hold back the rest of the group.
+        try:
+            results.append(await _process_payload(payload))
+        except Exception as exc:
+            failed += 1
+            results.append({"status": "failed", "item_id": str(payload.get("item_id")), "error": str(exc)})
+    return {"status": "completed", "processed": len(results) - failed, "failed": failed, "items": results}
+
+
+@celery_app.task(name="pipeline.process_items", bind=True)
+def process_items(self, payloads: List[Dict[str, Any]]) -> Dict[str, Any]:
+    """Process a group of items from one ingest batch in a single job."""
+
+    return asyncio.run(_process_payloads(payloads))
@@ -0,0 +1,304 @@
+#!/usr/bin/env python3
+"""End-to-end latency and throughput benchmark for the device pipeline.
+
+This script:
+1) Pairs and activates N simulated devices.
+2) Has each device capture synthetic photos at a fixed rate and upload them in
+   Wi-Fi windows, through the same /devices endpoints the firmware uses
+   (upload-url/batch, presigned PUT, ingest/batch with per-item timing).
+3) Polls /devices/timing until every item is processed and reports
+   p50/p95/p99 per pipeline stage plus items/sec.
+
+Run it against the stack from docker-compose.yml with the celery worker up.
+
+Example:
+  uv run python scripts/bench_device_pipeline.py \
+    --api-url http://127.0.0.1:8000 \
+    --devices 20 --captures 30 --capture-interval 1 --window-interval 10
+"""
+
+from __future__ import annotations
+
+import argparse
+import asyncio
+from dataclasses import dataclass, field
+from datetime import datetime, timezone
+import random
+import time
+from typing import Any, Dict, List, Sequence
+
+import httpx
+
+
+STAGES = ("device_queue", "device_wait", "device_upload", "api_queue", "processing", "end_to_end")
+TERMINAL_STATUSES = {"completed", "failed"}
+
+
+@dataclass
+class CapturedItem:
+    seq: int
+    data: bytes
+    captured_at: datetime
+    captured_mono: float
+    queued_mono: float
+
+
+@dataclass
+class SimDevice:
+    index: int
+    token: str
+    pending: List[CapturedItem] = field(default_factory=list)
+    ingested: List[int] = field(default_factory=list)
+    next_seq: int = 0
+
+
+def parse_args() -> argparse.Namespace:
+    parser = argparse.ArgumentParser(description="Replay a synthetic device fleet and report per-stage latency.")
+    parser.add_argument("--api-url", default="http://127.0.0.1:8000", help="API base URL.")
+    parser.add_argument(
+        "--auth-token",
+        default=None,
+        help="Bearer token for /devices/pair if AUTH_ENABLED=true (optional).",
+    )
+    parser.add_argument("--devices", type=int, default=10, help="Simulated devices (default: 10).")
+    parser.add_argument("--captures", type=int, default=20, help="Captures per device (default: 20).")
+    parser.add_argument(
+        "--capture-interval",
+        type=float,
+        default=1.0,
+        help="Seconds between captures on each device (default: 1).",
+    )
+    parser.add_argument(
+        "--window-interval",
+        type=float,
+        default=10.0,
+        help="Seconds between upload windows on each device (default: 10).",
+    )
+    parser.add_argument(
+        "--batch-size",
+        type=int,
+        default=8,
+        help="Items per upload-url/ingest batch, as UPLOAD_BATCH_SIZE on the device (default: 8).",
+    )
+    parser.add_argument("--image-bytes", type=int, default=60_000, help="Synthetic image size (default: 60000).")
+    parser.add_argument(
+        "--poll-timeout",
+        type=float,
+        default=600.0,
+        help="Seconds to wait for processing after the last upload (default: 600).",
+    )
+    parser.add_argument("--seed", type=int, default=None, help="Random seed for jitter and payloads.")
+    parser.add_argument(
+        "--http-timeout",
+        type=float,
+        default=30.0,
+        help="HTTP client timeout in seconds for API/storage requests.",
+    )
+    return parser.parse_args()
+
+
+def synthetic_jpeg(size: int, rng: random.Random) -> bytes:
+    # JPEG markers around random filler: enough for storage and hashing; decode
+    # steps may reject it, which still exercises the queue and worker.
+    return b"\xff\xd8" + rng.randbytes(max(0, size - 4)) + b"\xff\xd9"
+
+
+def percentile(values: Sequence[float], pct: float) -> float:
+    if not values:
+        return 0.0
+    ordered = sorted(values)
+    rank = (len(ordered) - 1) * pct / 100
+    low = int(rank)
+    high = min(low + 1, len(ordered) - 1)
+    return ordered[low] + (ordered[high] - ordered[low]) * (rank - low)
+
+
+def chunked(items: Sequence[Any], size: int) -> List[Sequence[Any]]:
+    return [items[i : i + size] for i in range(0, len(items), size)]
+
+
+async def register_device(api_client: httpx.AsyncClient, index: int) -> SimDevice:
+    resp = await api_client.post("/devices/pair", json={"name": f"bench-{index}"})
+    resp.raise_for_status()
+    code = resp.json()["pairing_code"]
+    resp = await api_client.post("/devices/activate", json={"pairing_code": code})
+    resp.raise_for_status()
+    return SimDevice(index=index, token=resp.json()["device_token"])
+
+
+async def put_object(storage_client: httpx.AsyncClient, target: Dict[str, Any], data: bytes) -> None:
+    scheme = "https" if target["upload_port"] == 443 else "http"
+    url = f"{scheme}://{target['upload_host']}:{target['upload_port']}{target['upload_path']}"
+    resp = await storage_client.put(url, content=data, headers={"Content-Type": "image/jpeg"})
+    resp.raise_for_status()
+
+
+async def upload_window(
+    device: SimDevice,
+    api_client: httpx.AsyncClient,
+    storage_client: httpx.AsyncClient,
+    batch_size: int,
+) -> None:
+    headers = {"X-Device-Token": device.token}
+    while device.pending:
+        batch = device.pending[:batch_size]
+        del device.pending[:batch_size]
+        claimed_mono = time.monotonic()
+        resp = await api_client.post(
+            "/devices/upload-url/batch",
+            headers=headers,
+            json={
+                "items": [
+                    {"filename": f"{item.seq}.jpg", "content_type": "image/jpeg", "seq": item.seq}
+                    for item in batch
+                ]
+            },
+        )
+        resp.raise_for_status()
+        targets = {result["seq"]: result for result in resp.json()["results"] if result["status"] == "ok"}
+
+        ingest: List[Dict[str, Any]] = []
+        for item in batch:
+            target = targets.get(item.seq)
+            if target is None:
+                continue
+            await put_object(storage_client, target, item.data)
+            now = time.monotonic()
+            ingest.append(
+                {
+                    "object_key": target["object_key"],
+                    "seq": item.seq,
+                    "captured_at": item.captured_at.isoformat(),
+                    "ntp_synced": True,
+                    "content_type": "image/jpeg",
+                    "item_type": "photo",
+                    "timing": {
+                        "queue_ms": int((item.queued_mono - item.captured_mono) * 1000),
+                        "wait_ms": int((claimed_mono - item.queued_mono) * 1000),
+                        "upload_ms": int((now - claimed_mono) * 1000),
+                        "attempts": 1,
+                    },
+                }
+            )
+        if not ingest:
+            continue
+        resp = await api_client.post("/devices/ingest/batch", headers=headers, json={"items": ingest})
+        resp.raise_for_status()
+        device.ingested.extend(result["seq"] for result in resp.json()["results"] if result["status"] == "queued")
+
+
+async def run_device(
+    device: SimDevice,
+    args: argparse.Namespace,
+    api_client: httpx.AsyncClient,
+    storage_client: httpx.AsyncClient,
+    rng: random.Random,
+) -> None:
+    # Start windows out of phase, as the firmware's jitter does.
+    next_window = time.monotonic() + rng.uniform(0, args.window_interval)
+    for _ in range(args.captures):
+        captured_mono = time.monotonic()
+        data = synthetic_jpeg(args.image_bytes, rng)
+        device.pending.append(
+            CapturedItem(
+                seq=device.next_seq,
+                data=data,
+                captured_at=datetime.now(timezone.utc),
+                captured_mono=captured_mono,
+                queued_mono=time.monotonic(),
+            )
+        )
+        device.next_seq += 1
+        if time.monotonic() >= next_window:
+            await upload_window(device, api_client, storage_client, args.batch_size)
+            next_window = time.monotonic() + args.window_interval
+        await asyncio.sleep(args.capture_interval)
+    await upload_window(device, api_client, storage_client, args.batch_size)
+
+
+async def collect_timings(
+    devices: Sequence[SimDevice],
+    api_client: httpx.AsyncClient,
+    batch_size: int,
+    timeout: float,
+) -> List[Dict[str, Any]]:
+    done: Dict[tuple[int, int], Dict[str, Any]] = {}
+    outstanding = {device.index: list(device.ingested) for device in devices}
+    deadline = time.monotonic() + timeout
+    while any(outstanding.values()) and time.monotonic() < deadline:
+        for device in devices:
+            seqs = outstanding[device.index]
+            still: List[int] = []
+            for chunk in chunked(seqs, batch_size):
+                resp = await api_client.get(
+                    "/devices/timing",
+                    headers={"X-Device-Token": device.token},
+                    params=[("seq", seq) for seq in chunk],
+                )
+                resp.raise_for_status()
+                for entry in resp.json()["items"]:
+                    if entry["status"] in TERMINAL_STATUSES:
+                        done[(device.index, entry["seq"])] = entry
+                    else:
+                        still.append(entry["seq"])
+            outstanding[device.index] = still
+        if any(outstanding.values()):
+            await asyncio.sleep(2.0)
+    missing = sum(len(seqs) for seqs in outstanding.values())
+    if missing:
+        print(f"Timed out waiting for {missing} items.")
+    return list(done.values())
+
+
+def report(entries: Sequence[Dict[str, Any]], elapsed_s: float) -> None:
+    completed = [entry for entry in entries if entry["status"] == "completed"]
+    failed = len(entries) - len(completed)
+    print(f"\nItems: completed={len(completed)} failed={failed} in {elapsed_s:.1f}s")
+    print(f"{'stage':<16}{'n':>7}{'p50 ms':>11}{'p95 ms':>11}{'p99 ms':>11}{'items/s':>10}")
+    for stage in STAGES:
+        if stage == "end_to_end":
+            values = [entry["end_to_end_ms"] for entry in completed if entry.get("end_to_end_ms") is not None]
+        else:
+            values = [entry["stages"][stage] for entry in completed if stage in entry["stages"]]
+        if not values:
+            continue
+        # Throughput a single lane of this stage could sustain at its mean cost.
+        mean_s = sum(values) / len(values) / 1000
+        rate = 1 / mean_s if mean_s > 0 else float("inf")
+        print(
+            f"{stage:<16}{len(values):>7}{percentile(values, 50):>11.0f}"
+            f"{percentile(values, 95):>11.0f}{percentile(values, 99):>11.0f}{rate:>10.2f}"
+        )
+    if elapsed_s > 0:
+        print(f"Overall throughput: {len(completed) / elapsed_s:.2f} items/s")
+
+
+async def main() -> None:
+    args = parse_args()
+    rng = random.Random(args.seed)
+
+    headers: Dict[str, str] = {}
+    if args.auth_token:
+        headers["Authorization"] = f"Bearer {args.auth_token}"
+
+    async with httpx.AsyncClient(
+        base_url=args.api_url.rstrip("/"), timeout=args.http_timeout, headers=headers
+    ) as api_client, httpx.AsyncClient(timeout=args.http_timeout) as storage_client:
+        devices = [await register_device(api_client, index) for index in range(args.devices)]
+        print(f"Registered {len(devices)} devices; capturing {args.captures} items each.")
+
+        started = time.monotonic()
+        await asyncio.gather(
+            *(
+                run_device(device, args, api_client, storage_client, random.Random(rng.random()))
+                for device in devices
+            )
+        )
+        ingested = sum(len(device.ingested) for device in devices)
+        print(f"Uploaded and ingested {ingested} items; waiting for processing.")
+        entries = await collect_timings(devices, api_client, args.batch_size, args.poll_timeout)
+        report(entries, time.monotonic() - started)
+
+
+if __name__ == "__main__":
+    asyncio.run(main())
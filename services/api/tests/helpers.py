@@ -78,6 +78,9 @@ class FakeSession:
     def add_all(self, objs: list[Any]) -> None:
         self.added.extend(objs)
 
+    async def flush(self) -> None:
+        pass
+
     async def commit(self) -> None:
         self.committed = True
 
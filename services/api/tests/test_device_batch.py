@@ -0,0 +1,235 @@
+"""Tests for the device batch upload-url and ingest endpoints."""
+
+from types import SimpleNamespace
+from uuid import UUID, uuid4
+
+from fastapi.testclient import TestClient
+
+from app.db.session import get_session
+from app.main import app
+from app.routes import devices as devices_module
+
+from tests.helpers import FakeResult, FakeSession, FakeStorage, override_get_session
+
+
+DEVICE = SimpleNamespace(
+    id=UUID("aaaaaaaa-1111-2222-3333-444444444444"),
+    user_id=UUID("12345678-1234-5678-1234-567812345678"),
+)
+
+
+def _override_device():
+    async def _override():
+        return DEVICE
+    return _override
+
+
+def test_upload_url_batch_signs_each_item(monkeypatch):
+    app.dependency_overrides[devices_module._get_current_device] = _override_device()
+    monkeypatch.setattr(devices_module, "get_storage_provider", lambda: FakeStorage())
+
+    client = TestClient(app)
+    response = client.post(
+        "/devices/upload-url/batch",
+        json={
+            "items": [
+                {"filename": "a.jpg", "content_type": "image/jpeg", "seq": 10},
+                {"filename": "b.wav", "content_type": "audio/wav", "seq": 11},
+            ]
+        },
+    )
+    assert response.status_code == 200
+    results = response.json()["results"]
+    assert [result["index"] for result in results] == [0, 1]
+    assert all(result["status"] == "ok" for result in results)
+    assert results[0]["upload_host"] == "storage.example.test"
+    assert results[0]["upload_port"] == 443
+    assert results[0]["object_key"].endswith("/10-a.jpg")
+    assert results[1]["seq"] == 11
+    assert "upload=true" in results[1]["upload_path"]
+
+
+def test_ingest_batch_dedups_and_queues(monkeypatch):
+    existing = SimpleNamespace(id=uuid4(), device_seq=7)
+    fake_session = FakeSession(results=[FakeResult(scalars=[existing])])
+    tasks = []
+
+    def fake_delay(payloads):
+        tasks.extend(payloads)
+        return SimpleNamespace(id=f"task-{len(tasks)}")
+
+    app.dependency_overrides[get_session] = override_get_session(fake_session)
+    app.dependency_overrides[devices_module._get_current_device] = _override_device()
+    monkeypatch.setattr(devices_module.process_items, "delay", fake_delay)
+
+    client = TestClient(app)
+    response = client.post(
+        "/devices/ingest/batch",
+        json={
+            "items": [
+                {"object_key": "devices/x/7-a.jpg", "seq": 7},
+                {"object_key": "devices/x/8-b.wav", "seq": 8},
+                {"object_key": "devices/x/8-b.wav", "seq": 8},
+            ]
+        },
+    )
+    assert response.status_code == 200
+    payload = response.json()
+    assert payload["accepted"] == 1
+    assert payload["duplicates"] == 2
+    assert payload["failed"] == 0
+    statuses = [result["status"] for result in payload["results"]]
+    assert statuses == ["duplicate", "queued", "duplicate"]
+    assert payload["results"][0]["item_id"] == str(existing.id)
+    assert payload["results"][2]["item_id"] == payload["results"][1]["item_id"]
+    assert len(tasks) == 1
+    assert tasks[0]["item_type"] == "audio"
+    assert fake_session.committed
+
+
+def test_ingest_batch_links_thumbnail_tiers(monkeypatch):
+    # seq 20 (thumbnail) is already stored; its full frame (21) arrives now
+    # together with a new thumbnail/full pair (30, 31).
+    stored_thumb = SimpleNamespace(id=uuid4(), device_seq=20, canonical_item_id=None)
+    fake_session = FakeSession(results=[FakeResult(scalars=[stored_thumb])])
+    tasks = []
+
+    def fake_delay(payloads):
+        tasks.extend(payloads)
+        return SimpleNamespace(id=f"task-{len(tasks)}")
+
+    app.dependency_overrides[get_session] = override_get_session(fake_session)
+    app.dependency_overrides[devices_module._get_current_device] = _override_device()
+    monkeypatch.setattr(devices_module.process_items, "delay", fake_delay)
+
+    client = TestClient(app)
+    response = client.post(
+        "/devices/ingest/batch",
+        json={
+            "items": [
+                {"object_key": "devices/x/21-a.jpg", "seq": 21, "tier": "full", "linked_seq": 20},
+                {"object_key": "devices/x/30-b_t.jpg", "seq": 30, "tier": "thumbnail", "linked_seq": 31},
+                {"object_key": "devices/x/31-b.jpg", "seq": 31, "tier": "full", "linked_seq": 30},
+            ]
+        },
+    )
+    assert response.status_code == 200
+    payload = response.json()
+    assert payload["accepted"] == 3
+    by_seq = {getattr(item, "device_seq", None): item for item in fake_session.added}
+    assert stored_thumb.canonical_item_id == by_seq[21].id
+    assert by_seq[30].canonical_item_id == by_seq[31].id
+    assert by_seq[31].canonical_item_id is None
+    assert [task.get("device_tier") for task in tasks] == ["full", "thumbnail", "full"]
+
+
+def test_ingest_batch_groups_processing_jobs(monkeypatch):
+    fake_session = FakeSession(results=[FakeResult(scalars=[])])
+    jobs = []
+
+    def fake_delay(payloads):
+        jobs.append(payloads)
+        return SimpleNamespace(id=f"job-{len(jobs)}")
+
+    app.dependency_overrides[get_session] = override_get_session(fake_session)
+    app.dependency_overrides[devices_module._get_current_device] = _override_device()
+    monkeypatch.setattr(
+        devices_module,
+        "get_settings",
+        lambda: SimpleNamespace(ingest_batch_limit=200, device_ingest_group_size=2),
+    )
+    monkeypatch.setattr(devices_module.process_items, "delay", fake_delay)
+
+    client = TestClient(app)
+    response = client.post(
+        "/devices/ingest/batch",
+        json={"items": [{"object_key": f"devices/x/{seq}-a.jpg", "seq": seq} for seq in (50, 51, 52)]},
+    )
+    assert response.status_code == 200
+    payload = response.json()
+    assert payload["accepted"] == 3
+    assert [len(job) for job in jobs] == [2, 1]
+    assert [result["task_id"] for result in payload["results"]] == ["job-1", "job-1", "job-2"]
+    keys = [task["storage_key"] for job in jobs for task in job]
+    assert keys == [f"devices/x/{seq}-a.jpg" for seq in (50, 51, 52)]
+
+
+def test_ingest_forwards_speech_confidence(monkeypatch):
+    fake_session = FakeSession(results=[FakeResult(scalar=None)])
+    tasks = []
+
+    def fake_delay(payload):
+        tasks.append(payload)
+        return SimpleNamespace(id="task-1")
+
+    app.dependency_overrides[get_session] = override_get_session(fake_session)
+    app.dependency_overrides[devices_module._get_current_device] = _override_device()
+    monkeypatch.setattr(devices_module.process_item, "delay", fake_delay)
+
+    client = TestClient(app)
+    response = client.post(
+        "/devices/ingest",
+        json={"object_key": "devices/x/40-c.wav", "seq": 40, "item_type": "audio", "speech_confidence": 12},
+    )
+    assert response.status_code == 200
+    assert response.json()["status"] == "queued"
+    assert tasks[0]["speech_confidence"] == 12
+
+
+def test_ingest_forwards_device_timing(monkeypatch):
+    fake_session = FakeSession(results=[FakeResult(scalar=None)])
+    tasks = []
+
+    def fake_delay(payload):
+        tasks.append(payload)
+        return SimpleNamespace(id="task-1")
+
+    app.dependency_overrides[get_session] = override_get_session(fake_session)
+    app.dependency_overrides[devices_module._get_current_device] = _override_device()
+    monkeypatch.setattr(devices_module.process_item, "delay", fake_delay)
+
+    client = TestClient(app)
+    response = client.post(
+        "/devices/ingest",
+        json={
+            "object_key": "devices/x/41-d.jpg",
+            "seq": 41,
+            "timing": {"queue_ms": 180, "upload_ms": 950, "attempts": 1},
+        },
+    )
+    assert response.status_code == 200
+    assert tasks[0]["device_timing"] == {"queue_ms": 180, "upload_ms": 950, "attempts": 1}
+    assert tasks[0]["ingested_at"]
+
+
+def test_device_timing_reports_stages_by_seq():
+    done = SimpleNamespace(id=uuid4(), device_seq=60, processing_status="completed")
+    pending = SimpleNamespace(id=uuid4(), device_seq=61, processing_status="pending")
+    timing = {"stages": {"device_queue": 200, "api_queue": 40, "processing": 900}, "end_to_end_ms": 1140}
+    fake_session = FakeSession(results=[FakeResult(rows=[(done, timing), (pending, None)])])
+
+    app.dependency_overrides[get_session] = override_get_session(fake_session)
+    app.dependency_overrides[devices_module._get_current_device] = _override_device()
+
+    client = TestClient(app)
+    response = client.get("/devices/timing", params=[("seq", 60), ("seq", 61), ("seq", 62)])
+    assert response.status_code == 200
+    items = response.json()["items"]
+    assert [item["status"] for item in items] == ["completed", "pending", "unknown"]
+    assert items[0]["stages"]["processing"] == 900
+    assert items[0]["end_to_end_ms"] == 1140
+    assert items[1]["stages"] == {}
+
+
+def test_device_config_reports_upload_order(monkeypatch):
+    app.dependency_overrides[devices_module._get_current_device] = _override_device()
+    monkeypatch.setattr(
+        devices_module,
+        "get_settings",
+        lambda: SimpleNamespace(device_upload_order="paired"),
+    )
+
+    client = TestClient(app)
+    response = client.get("/devices/config")
+    assert response.status_code == 200
+    assert response.json()["upload_order"] == "paired"
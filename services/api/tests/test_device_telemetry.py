@@ -0,0 +1,97 @@
+"""Tests for device telemetry ingestion into Prometheus metrics."""
+
+from types import SimpleNamespace
+from uuid import UUID
+
+from fastapi.testclient import TestClient
+from prometheus_client import REGISTRY
+
+from app.main import app
+from app.routes import devices as devices_module
+
+
+DEVICE = SimpleNamespace(
+    id=UUID("aaaaaaaa-1111-2222-3333-555555555555"),
+    user_id=UUID("12345678-1234-5678-1234-567812345678"),
+)
+
+
+def _sample(name: str, **labels) -> float:
+    return REGISTRY.get_sample_value(name, labels) or 0.0
+
+
+def test_telemetry_perf_feeds_prometheus():
+    async def _override():
+        return DEVICE
+
+    app.dependency_overrides[devices_module._get_current_device] = _override
+    before_bucket = _sample("lifelog_device_op_duration_bucket_total", op="sd_write", le="0.01")
+    before_events = _sample("lifelog_device_events_total", event="i2s_overruns")
+
+    client = TestClient(app)
+    response = client.post(
+        "/devices/telemetry",
+        json={
+            "backlog_bytes": 4096,
+            "boot": {
+                "reset_reason": "brownout",
+                "fast": True,
+                "audio_ms": 40,
+                "first_frame_ms": 420,
+                "index_ms": 0,
+            },
+            "perf": {
+                "interval_ms": 60000,
+                "ops": {"sd_write": [5, 12000, 6000, 0, 2, 3, 0, 0, 0]},
+                "events": {"i2s_overruns": 2, "photo_dropped": 0},
+                "heap_min": 81920,
+                "heap_max_alloc": 65536,
+            },
+        },
+    )
+    assert response.status_code == 200
+
+    device = str(DEVICE.id)
+    assert _sample("lifelog_device_op_duration_bucket_total", op="sd_write", le="0.01") - before_bucket == 5
+    assert _sample("lifelog_device_events_total", event="i2s_overruns") - before_events == 2
+    assert _sample("lifelog_device_op_max_seconds", device=device, op="sd_write") == 0.006
+    assert _sample("lifelog_device_state", device=device, metric="heap_min") == 81920
+    assert _sample("lifelog_device_state", device=device, metric="heap_max_alloc") == 65536
+    assert _sample("lifelog_device_state", device=device, metric="backlog_bytes") == 4096
+    assert _sample("lifelog_device_boot_milestone_seconds", device=device, stage="first_frame") == 0.42
+    assert _sample("lifelog_device_boot_milestone_seconds", device=device, stage="index") == 0
+
+
+def test_telemetry_samples_update_gauges_and_counts():
+    async def _override():
+        return DEVICE
+
+    app.dependency_overrides[devices_module._get_current_device] = _override
+    before_received = _sample("lifelog_device_telemetry_samples_total", kind="received")
+    before_dropped = _sample("lifelog_device_telemetry_samples_total", kind="dropped")
+    fields = ["uptime_s", "epoch", "backlog_count", "backlog_kb", "sd_free_mb", "heap_free_kb", "rssi", "flags"]
+
+    client = TestClient(app)
+    response = client.post(
+        "/devices/telemetry",
+        json={
+            "uptime_seconds": 7300,
+            "samples": {
+                "first_seq": 118,
+                "dropped": 3,
+                "fields": fields,
+                "rows": [
+                    [7140, 0, 40, 8000, 900, 120, 0, 0],
+                    [7200, 0, 42, 8192, 899, 118, -61, 1],
+                ],
+            },
+        },
+    )
+    assert response.status_code == 200
+
+    device = str(DEVICE.id)
+    assert _sample("lifelog_device_telemetry_samples_total", kind="received") - before_received == 2
+    assert _sample("lifelog_device_telemetry_samples_total", kind="dropped") - before_dropped == 3
+    assert _sample("lifelog_device_state", device=device, metric="backlog_count") == 42
+    assert _sample("lifelog_device_state", device=device, metric="backlog_bytes") == 8192 * 1024
+    assert _sample("lifelog_device_state", device=device, metric="wifi_rssi") == -61
@@ -0,0 +1,119 @@
+"""Tests for resumable (staged part) device uploads."""
+
+from types import SimpleNamespace
+from typing import Any
+from uuid import UUID
+
+from fastapi.testclient import TestClient
+
+from app.main import app
+from app.routes import devices as devices_module
+from app.storage import StorageObjectNotFound
+
+
+DEVICE = SimpleNamespace(
+    id=UUID("aaaaaaaa-1111-2222-3333-444444444444"),
+    user_id=UUID("12345678-1234-5678-1234-567812345678"),
+)
+PART = 64 * 1024
+
+
+class PartStorage:
+    """In-memory provider that signs URLs and keeps stored bytes."""
+
+    def __init__(self):
+        self.objects: dict[str, bytes] = {}
+
+    def get_presigned_upload(self, key: str, content_type: str, _expires_s: int) -> dict[str, Any]:
+        return {"url": f"https://storage.example.test/{key}?upload=true", "key": key}
+
+    def fetch(self, key: str) -> bytes:
+        if key not in self.objects:
+            raise StorageObjectNotFound(key)
+        return self.objects[key]
+
+    def store(self, key: str, data: bytes, _content_type: str) -> None:
+        self.objects[key] = data
+
+    def delete(self, key: str) -> None:
+        self.objects.pop(key, None)
+
+
+def _client(monkeypatch, storage: PartStorage) -> TestClient:
+    async def _override():
+        return DEVICE
+
+    app.dependency_overrides[devices_module._get_current_device] = _override
+    monkeypatch.setattr(devices_module, "get_storage_provider", lambda: storage)
+    return TestClient(app)
+
+
+def _part_key(seq: int, part: int) -> str:
+    return f"devices/{DEVICE.id}/parts/{seq}/{part:04d}"
+
+
+def test_upload_parts_signs_remaining_parts(monkeypatch):
+    client = _client(monkeypatch, PartStorage())
+    response = client.post(
+        "/devices/upload-parts",
+        json={"seq": 5, "content_type": "audio/wav", "size_bytes": PART * 2 + 10, "part_size": PART, "first_part": 1},
+    )
+    assert response.status_code == 200
+    payload = response.json()
+    assert payload["part_count"] == 3
+    assert [part["part_number"] for part in payload["parts"]] == [1, 2]
+    assert payload["parts"][0]["upload_path"].startswith(f"/{_part_key(5, 1)}")
+
+
+def test_complete_assembles_parts_and_is_idempotent(monkeypatch):
+    storage = PartStorage()
+    storage.objects[_part_key(9, 0)] = b"a" * PART
+    storage.objects[_part_key(9, 1)] = b"b" * 10
+    client = _client(monkeypatch, storage)
+    body = {
+        "seq": 9,
+        "filename": "clip.wav",
+        "content_type": "audio/wav",
+        "size_bytes": PART + 10,
+        "part_size": PART,
+    }
+
+    response = client.post("/devices/upload-parts/complete", json=body)
+    assert response.status_code == 200
+    object_key = response.json()["object_key"]
+    assert object_key.endswith("/9-clip.wav")
+    assert storage.objects[object_key] == b"a" * PART + b"b" * 10
+    assert _part_key(9, 0) not in storage.objects
+
+    retry = client.post("/devices/upload-parts/complete", json=body)
+    assert retry.status_code == 200
+    assert retry.json()["object_key"] == object_key
+
+
+def test_complete_reports_missing_part(monkeypatch):
+    storage = PartStorage()
+    storage.objects[_part_key(3, 0)] = b"a" * PART
+    client = _client(monkeypatch, storage)
+    response = client.post(
+        "/devices/upload-parts/complete",
+        json={"seq": 3, "filename": "clip.wav", "size_bytes": PART * 2, "part_size": PART},
+    )
+    assert response.status_code == 409
+    assert "part 1" in response.json()["detail"]
+
+
+def test_complete_keeps_parts_on_storage_error(monkeypatch):
+    storage = PartStorage()
+    storage.objects[_part_key(4, 0)] = b"a" * PART
+
+    def flaky_fetch(_key: str) -> bytes:
+        raise ConnectionError("storage timed out")
+
+    monkeypatch.setattr(storage, "fetch", flaky_fetch)
+    client = _client(monkeypatch, storage)
+    response = client.post(
+        "/devices/upload-parts/complete",
+        json={"seq": 4, "filename": "clip.wav", "size_bytes": PART, "part_size": PART},
+    )
+    assert response.status_code == 503
+    assert _part_key(4, 0) in storage.objects
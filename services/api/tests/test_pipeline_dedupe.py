@@ -0,0 +1,71 @@
+"""Tests for the dedupe pipeline step."""
+
+import asyncio
+from datetime import datetime, timezone
+from types import SimpleNamespace
+from uuid import uuid4
+
+from app.pipeline.steps import DedupStep
+from app.pipeline.types import PipelineArtifacts, PipelineConfig
+
+from tests.helpers import FakeResult, FakeSession
+
+
+SETTINGS = SimpleNamespace(
+    pipeline_reprocess_duplicates=False,
+    dedupe_near_window_minutes=10,
+    dedupe_near_hamming_threshold=8,
+)
+EVENT_TIME = datetime(2024, 1, 15, 10, 0, tzinfo=timezone.utc)
+
+
+class RecordingStore:
+    def __init__(self):
+        self.upserts = []
+
+    async def upsert(self, **kwargs):
+        self.upserts.append(kwargs)
+        return None, True
+
+
+def _photo(**overrides):
+    values = {
+        "id": uuid4(),
+        "user_id": uuid4(),
+        "item_type": "photo",
+        "content_hash": "hash-full",
+        "phash": "ffff0000ffff0000",
+        "event_time_utc": EVENT_TIME,
+        "canonical_item_id": None,
+    }
+    values.update(overrides)
+    return SimpleNamespace(**values)
+
+
+def _run(item, candidates, payload):
+    session = FakeSession(results=[FakeResult(scalar=None), FakeResult(scalars=candidates)])
+    config = PipelineConfig(
+        session=session, storage=None, settings=SETTINGS, payload=payload, now=EVENT_TIME
+    )
+    artifacts = PipelineArtifacts(RecordingStore())
+    asyncio.run(DedupStep().run(item, artifacts, config))
+    return artifacts
+
+
+def test_full_frame_after_its_thumbnail_stays_canonical():
+    """A backfilled full frame is not a near duplicate of its own thumbnail."""
+    full = _photo()
+    thumbnail = _photo(content_hash="hash-thumb", canonical_item_id=full.id)
+    artifacts = _run(full, [thumbnail], {"device_tier": "full"})
+    assert full.canonical_item_id == full.id
+    assert artifacts.skip_expensive is False
+    assert artifacts.get("dedupe") is None
+
+
+def test_near_duplicate_of_another_capture_skips_expensive_steps():
+    earlier = _photo(content_hash="hash-earlier")
+    item = _photo(user_id=earlier.user_id)
+    artifacts = _run(item, [earlier], {})
+    assert item.canonical_item_id == earlier.id
+    assert artifacts.skip_expensive is True
+    assert artifacts.get("dedupe")["status"] == "near_duplicate"
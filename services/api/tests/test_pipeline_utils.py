@@ -14,6 +14,7 @@ from app.pipeline.utils import (
     hamming_distance_hex,
     extract_keywords,
     build_vector_text,
+    build_pipeline_timing,
 )
 
 
@@ -370,3 +371,35 @@ def test_build_vector_text_whitespace():
     )
     assert "My Title" in result
     assert "My Summary" in result
+
+
+# ---------------------------------------------------------------------------
+# build_pipeline_timing tests
+# ---------------------------------------------------------------------------
+
+
+def test_build_pipeline_timing_combines_device_and_server_stages():
+    """Device durations and server stages add up to end-to-end."""
+    payload = {
+        "ingested_at": "2024-01-15T10:00:00+00:00",
+        "device_timing": {"queue_ms": 150, "wait_ms": 60000, "upload_ms": 800, "attempts": 2},
+    }
+    started = datetime(2024, 1, 15, 10, 0, 2, tzinfo=timezone.utc)
+    completed = datetime(2024, 1, 15, 10, 0, 5, tzinfo=timezone.utc)
+    result = build_pipeline_timing(payload, started, completed, {"fetch_blob": 120})
+    assert result["stages"] == {
+        "device_queue": 150,
+        "device_wait": 60000,
+        "device_upload": 800,
+        "api_queue": 2000,
+        "processing": 3000,
+    }
+    assert result["end_to_end_ms"] == 65950
+    assert result["steps"] == {"fetch_blob": 120}
+    assert result["attempts"] == 2
+
+
+def test_build_pipeline_timing_requires_ingest_time():
+    """Items not ingested from a device have no timing."""
+    now = datetime(2024, 1, 15, tzinfo=timezone.utc)
+    assert build_pipeline_timing({}, now, now) is None
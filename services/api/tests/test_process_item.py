@@ -1,8 +1,15 @@
 import pytest
 
-from app.tasks.process_item import process_item
+from app.tasks.process_item import process_item, process_items
 
 
 def test_process_item_requires_item_id():
     with pytest.raises(ValueError):
         process_item.run({})
+
+
+def test_process_items_records_failures_per_item():
+    result = process_items.run([{}, {"item_id": "not-a-uuid"}])
+    assert result["processed"] == 0
+    assert result["failed"] == 2
+    assert [item["status"] for item in result["items"]] == ["failed", "failed"]